@@ -8,6 +8,7 @@
 #include <consensus/params.h>
 #include <consensus/validation.h>
 #include <tinyformat.h>
+#include <util/strencodings.h>
 #include <util/system.h>
 #include <validation.h>
 #include <wallet/ismine.h>
@@ -15,7 +16,7 @@
 static const char ASSET_FLAG = 'A';
 
 std::unique_ptr<CAssetsDB> passetsdb;
-CLRUCache<std::string, CAssetData> *passetsCache = nullptr;
+CAssetsCache *passetsCache = nullptr;
 
 CAssetData::CAssetData(const CAsset& _asset, const CTransactionRef& assetTx, const int& nOut, uint32_t _nTime)
 {
@@ -46,6 +47,105 @@ CAssetData::CAssetData()
     this->SetNull();
 }
 
+void CAssetsCache::AddToIndexes(const std::string& key, const CAssetData& data)
+{
+    mapNameIndex[ToLower(data.asset.getAssetName())].insert(key);
+    mapShortNameIndex[ToLower(data.asset.getShortName())].insert(key);
+    mapAssetIndex[data.asset].insert(key);
+}
+
+template <typename K, typename M>
+static void EraseFromIndex(M& mapIndex, const K& indexKey, const std::string& key)
+{
+    auto it = mapIndex.find(indexKey);
+    if (it == mapIndex.end())
+        return;
+    it->second.erase(key);
+    if (it->second.empty())
+        mapIndex.erase(it);
+}
+
+void CAssetsCache::RemoveFromIndexes(const std::string& key, const CAssetData& data)
+{
+    EraseFromIndex(mapNameIndex, ToLower(data.asset.getAssetName()), key);
+    EraseFromIndex(mapShortNameIndex, ToLower(data.asset.getShortName()), key);
+    EraseFromIndex(mapAssetIndex, data.asset, key);
+}
+
+void CAssetsCache::Put(const std::string& key, const CAssetData& value)
+{
+    auto it = GetItemsMap().find(key);
+    if (it != GetItemsMap().end()) {
+        RemoveFromIndexes(key, it->second->second);
+    } else if (Size() > 0 && Size() >= MaxSize()) {
+        // the least recently used asset is about to be evicted
+        const auto& last = GetItemsList().back();
+        RemoveFromIndexes(last.first, last.second);
+    }
+
+    CLRUCache::Put(key, value);
+    if (Exists(key))
+        AddToIndexes(key, value);
+}
+
+void CAssetsCache::Erase(const std::string& key)
+{
+    auto it = GetItemsMap().find(key);
+    if (it != GetItemsMap().end())
+        RemoveFromIndexes(key, it->second->second);
+
+    CLRUCache::Erase(key);
+}
+
+void CAssetsCache::Clear()
+{
+    CLRUCache::Clear();
+    mapNameIndex.clear();
+    mapShortNameIndex.clear();
+    mapAssetIndex.clear();
+}
+
+const CAssetData* CAssetsCache::FindInIndex(const std::unordered_map<std::string, std::set<std::string>>& mapIndex, const std::string& strName) const
+{
+    auto it = mapIndex.find(ToLower(strName));
+    if (it == mapIndex.end())
+        return nullptr;
+
+    return &GetItemsMap().at(*it->second.begin())->second;
+}
+
+const CAssetData* CAssetsCache::FindByName(const std::string& strName) const
+{
+    return FindInIndex(mapNameIndex, strName);
+}
+
+const CAssetData* CAssetsCache::FindByNameOrShortName(const std::string& strName) const
+{
+    const CAssetData* pdata = FindInIndex(mapNameIndex, strName);
+    return pdata ? pdata : FindInIndex(mapShortNameIndex, strName);
+}
+
+const CAssetData* CAssetsCache::FindByAsset(const CAsset& asset) const
+{
+    auto it = mapAssetIndex.find(asset);
+    if (it == mapAssetIndex.end())
+        return nullptr;
+
+    return &GetItemsMap().at(*it->second.begin())->second;
+}
+
+CAmount CAssetsCache::GetInputAmount(const CAsset& asset) const
+{
+    CAmount nAmount = 0;
+    auto it = mapAssetIndex.find(asset);
+    if (it == mapAssetIndex.end())
+        return nAmount;
+
+    for (const std::string& key : it->second)
+        nAmount += GetItemsMap().at(key)->second.inputAmount;
+    return nAmount;
+}
+
 CAssetsDB::CAssetsDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "assets", nCacheSize, fMemory, fWipe) {
 }
 
@@ -181,11 +281,9 @@ bool CAssetsDB::AssetDir(std::vector<CAssetData>& assets)
 CAssetData GetAssetData(const std::string& name){
     
     CAssetData cCheck;
-    for(auto const& x : passetsCache->GetItemsMap()){
-        if(iequals(x.first , name)){
-            cCheck = x.second->second;
-        }
-    }   
+    const CAssetData* pdata = passetsCache->FindByName(name);
+    if (pdata)
+        cCheck = *pdata;
     return cCheck;  
     
 }
@@ -193,11 +291,9 @@ CAssetData GetAssetData(const std::string& name){
 CAsset GetAsset(const std::string& name)
 {
     CAsset cCheck;
-    for(auto const& x : passetsCache->GetItemsMap()){
-        if(iequals(x.first , name)){
-            cCheck = x.second->second.asset;
-        }
-    }   
+    const CAssetData* pdata = passetsCache->FindByName(name);
+    if (pdata)
+        cCheck = pdata->asset;
     return cCheck;
 }
 
@@ -212,30 +308,19 @@ std::vector<CAsset> GetAllAssets(){
 
 bool assetExists(CAsset assetToCheck, uint256 &txhash){
     
-    for(auto const& x : passetsCache->GetItemsMap()){
-        CAsset checkasset = x.second->second.asset;
-        txhash = x.second->second.txhash;
-        
-        if(checkasset == assetToCheck)
-            return true;
-        
-        if(iequals(assetToCheck.getAssetName(), checkasset.getAssetName()) || iequals(assetToCheck.getAssetName(), checkasset.getShortName()))
-            return true;
-    }
-    
-    return false;
+    const CAssetData* pdata = passetsCache->FindByAsset(assetToCheck);
+    if (!pdata)
+        pdata = passetsCache->FindByNameOrShortName(assetToCheck.getAssetName());
+    if (!pdata)
+        return false;
+
+    txhash = pdata->txhash;
+    return true;
 }
 
 bool assetNameExists(std::string assetName){
     
-    for(auto const& x : passetsCache->GetItemsMap()){
-        CAsset checkasset = x.second->second.asset;
-        
-        if(iequals(assetName, checkasset.getAssetName()) || iequals(assetName, checkasset.getShortName()))
-            return true;
-    }
-    
-    return false;
+    return passetsCache->FindByNameOrShortName(assetName) != nullptr;
 }
 
 bool isSubsidy(CAsset assetToCheck){
@@ -11,6 +11,11 @@
 #include <lrucache.h>
 #include <dbwrapper.h>
 
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+
 class CAssetData
 {
 public:
@@ -37,6 +42,40 @@ public:
 };
 
 
+/**
+ * Assets metadata LRU cache keyed by asset name, with indexes on the lower case asset name,
+ * the lower case short name and the asset id so lookups do not scan every registered asset.
+ */
+class CAssetsCache : public CLRUCache<std::string, CAssetData>
+{
+private:
+    // lower case name => cache keys of the assets using it
+    std::unordered_map<std::string, std::set<std::string>> mapNameIndex;
+    std::unordered_map<std::string, std::set<std::string>> mapShortNameIndex;
+    // asset => cache keys of the assets registered with it
+    std::map<CAsset, std::set<std::string>> mapAssetIndex;
+
+    void AddToIndexes(const std::string& key, const CAssetData& data);
+    void RemoveFromIndexes(const std::string& key, const CAssetData& data);
+    const CAssetData* FindInIndex(const std::unordered_map<std::string, std::set<std::string>>& mapIndex, const std::string& strName) const;
+
+public:
+    explicit CAssetsCache(size_t max_size) : CLRUCache(max_size) {}
+
+    void Put(const std::string& key, const CAssetData& value);
+    void Erase(const std::string& key);
+    void Clear();
+
+    //! Find an asset whose name case-insensitively equals strName
+    const CAssetData* FindByName(const std::string& strName) const;
+    //! Find an asset whose name or short name case-insensitively equals strName
+    const CAssetData* FindByNameOrShortName(const std::string& strName) const;
+    //! Find the asset registered with this asset id
+    const CAssetData* FindByAsset(const CAsset& asset) const;
+    //! Sum of the input amounts of every asset registered with this asset id
+    CAmount GetInputAmount(const CAsset& asset) const;
+};
+
 /** Access to the asset database */
 class CAssetsDB : public CDBWrapper
 {
@@ -66,7 +105,7 @@ public:
 extern std::unique_ptr<CAssetsDB> passetsdb;
 
 /** Global variable that point to the assets metadata LRU Cache (protected by cs_main) */
-extern CLRUCache<std::string, CAssetData> *passetsCache;
+extern CAssetsCache *passetsCache;
 
 void DumpAssets();
 
@@ -0,0 +1,63 @@
+// Copyright (c) 2017-2020 The Crown Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <assettable.h>
+
+#include <hash.h>
+
+uint32_t CAssetTable::Intern(const CAsset& asset, bool& fNew)
+{
+    const uint256 hash = SerializeHash(asset);
+
+    LOCK(cs);
+    auto it = mapIndexes.find(hash);
+    if (it != mapIndexes.end()) {
+        fNew = false;
+        return it->second;
+    }
+
+    const uint32_t nIndex = vAssets.size();
+    vAssets.push_back(asset);
+    mapIndexes.emplace(hash, nIndex);
+    fNew = true;
+    return nIndex;
+}
+
+bool CAssetTable::Load(uint32_t nIndex, const CAsset& asset)
+{
+    const uint256 hash = SerializeHash(asset);
+
+    LOCK(cs);
+    if (nIndex != vAssets.size() || mapIndexes.count(hash))
+        return false;
+
+    vAssets.push_back(asset);
+    mapIndexes.emplace(hash, nIndex);
+    return true;
+}
+
+bool CAssetTable::Get(uint32_t nIndex, CAsset& asset) const
+{
+    LOCK(cs);
+    if (nIndex >= vAssets.size())
+        return false;
+
+    asset = vAssets[nIndex];
+    return true;
+}
+
+size_t CAssetTable::Size() const
+{
+    LOCK(cs);
+    return vAssets.size();
+}
+
+void CAssetTable::Truncate(size_t nSize)
+{
+    LOCK(cs);
+    while (vAssets.size() > nSize) {
+        mapIndexes.erase(SerializeHash(vAssets.back()));
+        vAssets.pop_back();
+    }
+}
@@ -0,0 +1,39 @@
+// Copyright (c) 2017-2020 The Crown Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CROWN_ASSETTABLE_H
+#define CROWN_ASSETTABLE_H
+
+#include <primitives/asset.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <map>
+#include <vector>
+
+/**
+ * Interned assets: every distinct asset, metadata included, is stored once
+ * and referred to by its index in the table. Indexes are never reused.
+ */
+class CAssetTable
+{
+private:
+    mutable Mutex cs;
+    std::vector<CAsset> vAssets GUARDED_BY(cs);
+    // hash of the serialized asset => index, assets sharing an id may differ in metadata
+    std::map<uint256, uint32_t> mapIndexes GUARDED_BY(cs);
+
+public:
+    //! Index of asset, appended to the table if it is not there yet, fNew tells whether it was
+    uint32_t Intern(const CAsset& asset, bool& fNew);
+    //! Add an asset read back from disk, the indexes have to be loaded in order
+    bool Load(uint32_t nIndex, const CAsset& asset);
+    //! The asset at nIndex, false if there is none
+    bool Get(uint32_t nIndex, CAsset& asset) const;
+    size_t Size() const;
+    //! Drop the assets from nSize on, interned for a batch that was not written
+    void Truncate(size_t nSize);
+};
+
+#endif // CROWN_ASSETTABLE_H
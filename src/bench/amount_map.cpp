@@ -0,0 +1,72 @@
+// Copyright (c) 2017-2020 The Crown Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <primitives/asset.h>
+
+#include <vector>
+
+static const int BLOCK_TXS = 2000;
+static const int CHAIN_BLOCKS = 1000;
+
+static CAsset MakeAsset(unsigned char n)
+{
+    uint256 id;
+    *id.begin() = n;
+    return CAsset(id);
+}
+
+struct TxAmounts {
+    CAmountMap valueIn;
+    CAmountMap valueOut;
+};
+
+// Transactions of a block, most moving the native asset and every tenth a second asset as well
+static std::vector<TxAmounts> MakeBlockTxs()
+{
+    const CAsset native = MakeAsset(1);
+    const CAsset token = MakeAsset(2);
+    std::vector<TxAmounts> txs(BLOCK_TXS);
+    for (int i = 0; i < BLOCK_TXS; i++) {
+        txs[i].valueIn[native] = 100000 + i;
+        txs[i].valueOut[native] = 99000 + i;
+        if (i % 10 == 0) {
+            txs[i].valueIn[token] = 500;
+            txs[i].valueOut[token] = 500;
+        }
+    }
+    return txs;
+}
+
+// Per transaction fee checks and block fee accumulation as done by ConnectBlock
+static void AmountMapFeeAccumulation(benchmark::Bench& bench)
+{
+    const std::vector<TxAmounts> txs = MakeBlockTxs();
+
+    bench.run([&] {
+        CAmountMap nFees;
+        for (const TxAmounts& tx : txs) {
+            assert(tx.valueIn >= tx.valueOut);
+            nFees += tx.valueIn - tx.valueOut;
+        }
+        assert(valueFor(nFees, MakeAsset(1)) == 1000 * BLOCK_TXS);
+    });
+}
+
+// Money supply carried from block to block: nMoneySupply = pprev->nMoneySupply + results
+static void AmountMapSupplyAccumulation(benchmark::Bench& bench)
+{
+    CAmountMap reward{{MakeAsset(1), 1000}, {MakeAsset(2), 10}};
+    std::vector<CAmountMap> supply(CHAIN_BLOCKS);
+
+    bench.run([&] {
+        for (int i = 1; i < CHAIN_BLOCKS; i++) {
+            supply[i] = supply[i - 1] + reward;
+        }
+        assert(valueFor(supply.back(), MakeAsset(2)) == 10 * (CHAIN_BLOCKS - 1));
+    });
+}
+
+BENCHMARK(AmountMapFeeAccumulation);
+BENCHMARK(AmountMapSupplyAccumulation);
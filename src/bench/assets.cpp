@@ -0,0 +1,84 @@
+// Copyright (c) 2017-2020 The Crown Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <assetdb.h>
+#include <bench/bench.h>
+#include <random.h>
+
+#include <vector>
+
+static const int ASSET_COUNT = 10000;
+static const int BLOCK_OUTPUTS = 2000;
+
+static std::string LetterCode(int n, int nLength)
+{
+    std::string code(nLength, 'A');
+    for (int i = nLength - 1; i >= 0; i--, n /= 26)
+        code[i] += n % 26;
+    return code;
+}
+
+static CAsset MakeAsset(int n)
+{
+    AssetMetadata meta;
+    meta.nVersion = AssetMetadata::CURRENT_VERSION;
+    meta.setName("ASSET" + LetterCode(n, 4));
+    meta.setShortName(LetterCode(n, 4));
+    return CAsset(meta);
+}
+
+// Register ASSET_COUNT assets and build the outputs of a block, a quarter of them issuing new assets
+static void SetupAssets(CAssetsCache& cache, std::vector<CAsset>& vOutputs)
+{
+    for (int i = 0; i < ASSET_COUNT; i++) {
+        CAssetData data;
+        data.asset = MakeAsset(i);
+        cache.Put(data.asset.getAssetName(), data);
+    }
+
+    FastRandomContext rand(true);
+    vOutputs.clear();
+    for (int i = 0; i < BLOCK_OUTPUTS; i++) {
+        vOutputs.emplace_back(MakeAsset(i % 4 == 0 ? ASSET_COUNT + i : rand.randrange(ASSET_COUNT)));
+    }
+}
+
+// Existence checks answered by the case-folded name and short name indexes
+static void AssetConnectNameIndex(benchmark::Bench& bench)
+{
+    CAssetsCache cache(ASSET_COUNT * 2);
+    std::vector<CAsset> vOutputs;
+    SetupAssets(cache, vOutputs);
+
+    bench.run([&] {
+        int nNew = 0;
+        for (const CAsset& out : vOutputs) {
+            bool exists = cache.FindByNameOrShortName(out.getAssetName()) != nullptr;
+            if (!exists && !cache.Exists(out.getAssetName()))
+                nNew++;
+        }
+        assert(nNew == BLOCK_OUTPUTS / 4);
+    });
+}
+
+// Registering the new assets of a block in a full cache, which evicts and reindexes as it goes
+static void AssetCachePutEvict(benchmark::Bench& bench)
+{
+    CAssetsCache cache(ASSET_COUNT);
+    std::vector<CAsset> vOutputs;
+    SetupAssets(cache, vOutputs);
+
+    int nNext = ASSET_COUNT;
+    bench.run([&] {
+        for (int i = 0; i < BLOCK_OUTPUTS; i++) {
+            CAssetData data;
+            data.asset = MakeAsset(nNext++);
+            cache.Put(data.asset.getAssetName(), data);
+        }
+        assert(cache.Size() == ASSET_COUNT);
+    });
+}
+
+BENCHMARK(AssetConnectNameIndex);
+BENCHMARK(AssetCachePutEvict);
@@ -0,0 +1,49 @@
+// Copyright (c) 2014-2020 The Crown developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <masternode/masternode-payments.h>
+#include <random.h>
+#include <script/standard.h>
+
+#include <algorithm>
+#include <vector>
+
+static const int MASTERNODE_COUNT = 5000;
+
+// Fill the payment votes of a synthetic network where every block paid one masternode with six votes
+static void SetupPaymentVotes(CMasternodePayments& payments, std::vector<CScript>& vPayees, int& nTipHeight)
+{
+    FastRandomContext rand(true);
+    vPayees.clear();
+    for (int i = 0; i < MASTERNODE_COUNT; i++) {
+        vPayees.emplace_back(GetScriptForDestination(PKHash(uint160(rand.randbytes(20)))));
+    }
+
+    nTipHeight = MASTERNODE_COUNT * 1.25;
+    for (int nHeight = 1; nHeight <= nTipHeight; nHeight++) {
+        payments.AddPayeeVotes(nHeight, vPayees[rand.randrange(MASTERNODE_COUNT)], 6);
+    }
+}
+
+// Selection using the voted height table maintained as votes are added
+static void MasternodeQueueVotedHeights(benchmark::Bench& bench)
+{
+    CMasternodePayments payments;
+    std::vector<CScript> vPayees;
+    int nTipHeight;
+    SetupPaymentVotes(payments, vPayees, nTipHeight);
+
+    int nMnCount = MASTERNODE_COUNT * 1.25;
+    bench.run([&] {
+        std::vector<std::pair<int64_t, int>> vecLastPaid;
+        for (int i = 0; i < MASTERNODE_COUNT; i++) {
+            int nHeight = payments.GetLastPaidHeight(vPayees[i], nTipHeight);
+            vecLastPaid.emplace_back(nHeight > 0 && nTipHeight - nHeight < nMnCount ? nHeight : 0, i);
+        }
+        std::sort(vecLastPaid.begin(), vecLastPaid.end());
+    });
+}
+
+BENCHMARK(MasternodeQueueVotedHeights);
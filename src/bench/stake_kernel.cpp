@@ -0,0 +1,48 @@
+// Copyright (c) 2014-2020 The Crown developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <pos/kernel.h>
+#include <pos/stakeminer.h>
+#include <random.h>
+
+static const uint64_t KERNEL_AMOUNT = 10000 * COIN;
+static const uint64_t KERNEL_TIME = 1600000000;
+
+// A zero target never gives a valid proof, so every search covers the whole interval
+static Kernel MakeKernel(FastRandomContext& rand)
+{
+    COutPoint outpoint(rand.rand256(), rand.randrange(8));
+    return Kernel(outpoint, KERNEL_AMOUNT, rand.rand256(), KERNEL_TIME - rand.randrange(100000), KERNEL_TIME);
+}
+
+// Search as done before the kernel midstate: serialize and hash the whole kernel for every second
+static void StakeKernelSearchPerSecond(benchmark::Bench& bench)
+{
+    FastRandomContext rand(true);
+    Kernel kernel = MakeKernel(rand);
+    const uint256 nTarget;
+
+    bench.run([&] {
+        for (uint64_t nTime = KERNEL_TIME; nTime <= KERNEL_TIME + STAKE_SEARCH_INTERVAL; nTime++) {
+            kernel.SetStakeTime(nTime);
+            assert(!kernel.IsValidProof(nTarget));
+        }
+    });
+}
+
+// Search reusing the hasher midstate of the constant kernel prefix
+static void StakeKernelSearchMidstate(benchmark::Bench& bench)
+{
+    FastRandomContext rand(true);
+    Kernel kernel = MakeKernel(rand);
+    const uint256 nTarget;
+
+    bench.run([&] {
+        assert(!kernel.SearchValidProof(KERNEL_TIME, KERNEL_TIME + STAKE_SEARCH_INTERVAL, nTarget));
+    });
+}
+
+BENCHMARK(StakeKernelSearchPerSecond);
+BENCHMARK(StakeKernelSearchMidstate);
@@ -4,78 +4,156 @@
 
 #include <crown/cache.h>
 
+#include <future>
+
+// serializes snapshots against each other and against the final dump at shutdown
+static Mutex cs_snapshot;
+static std::map<std::string, CCacheSnapshotStats> mapSnapshotStats GUARDED_BY(cs_snapshot);
+
+// the chunked format is written to <name>2.dat, older versions keep reading and writing <name>.dat
+template<typename T>
+static CFlatDB<T> CacheDB(const std::string& strName, const std::string& strMagicMessage)
+{
+    return CFlatDB<T>(fs::PathFromString(strName + "2.dat"), strMagicMessage, fs::PathFromString(strName + ".dat"));
+}
+
+template<typename T>
+static void SnapshotCache(const std::string& strName, const std::string& strMagicMessage, const T& objToSave) EXCLUSIVE_LOCKS_REQUIRED(cs_snapshot)
+{
+    const std::string strFilename = strName + "2.dat";
+    CCacheSnapshotStats& stats = mapSnapshotStats[strFilename];
+
+    // copy under a short lock of the manager, the copy is then written without blocking message processing
+    int64_t nStart = GetTimeMicros();
+    T snapshot;
+    objToSave.GetSnapshot(snapshot);
+    int64_t nCopied = GetTimeMicros();
+
+    CFlatDB<T> flatdb = CacheDB<T>(strName, strMagicMessage);
+    bool fOk = flatdb.Dump(snapshot);
+    int64_t nWritten = GetTimeMicros();
+
+    stats.nLastTime = GetTime();
+    stats.nLastCopyMicros = nCopied - nStart;
+    stats.nLastWriteMicros = nWritten - nCopied;
+    stats.nMaxCopyMicros = std::max(stats.nMaxCopyMicros, stats.nLastCopyMicros);
+    stats.nMaxWriteMicros = std::max(stats.nMaxWriteMicros, stats.nLastWriteMicros);
+    stats.nCount++;
+    if (!fOk)
+        stats.nFailures++;
+
+    LogPrint(BCLog::MASTERNODE, "%s: %s copied in %dus, written in %dus\n", __func__, strFilename, stats.nLastCopyMicros, stats.nLastWriteMicros);
+}
+
+void SnapshotCaches()
+{
+    LOCK(cs_snapshot);
+    SnapshotCache("mncache", "magicMasternodeCache", mnodeman);
+    SnapshotCache("sncache", "magicSystemnodeCache", snodeman);
+    SnapshotCache("budget", "magicBudgetCache", budget);
+}
+
+std::map<std::string, CCacheSnapshotStats> GetCacheSnapshotStats()
+{
+    LOCK(cs_snapshot);
+    return mapSnapshotStats;
+}
+
 void DumpCaches()
 {
-    CFlatDB<CMasternodeMan> flatdb1(fs::PathFromString("mncache.dat"), "magicMasternodeCache");
+    LOCK(cs_snapshot);
+    CFlatDB<CMasternodeMan> flatdb1 = CacheDB<CMasternodeMan>("mncache", "magicMasternodeCache");
     flatdb1.Dump(mnodeman);
-    CFlatDB<CSystemnodeMan> flatdb2(fs::PathFromString("sncache.dat"), "magicSystemnodeCache");
+    CFlatDB<CSystemnodeMan> flatdb2 = CacheDB<CSystemnodeMan>("sncache", "magicSystemnodeCache");
     flatdb2.Dump(snodeman);
-    CFlatDB<CMasternodePayments> flatdb3(fs::PathFromString("mnpayments.dat"), "magicMasternodePaymentsCache");
+    CFlatDB<CMasternodePayments> flatdb3 = CacheDB<CMasternodePayments>("mnpayments", "magicMasternodePaymentsCache");
     flatdb3.Dump(masternodePayments);
-    CFlatDB<CSystemnodePayments> flatdb4(fs::PathFromString("snpayments.dat"), "magicSystemnodePaymentsCache");
+    CFlatDB<CSystemnodePayments> flatdb4 = CacheDB<CSystemnodePayments>("snpayments", "magicSystemnodePaymentsCache");
     flatdb4.Dump(systemnodePayments);
-    CFlatDB<CBudgetManager> flatdb5(fs::PathFromString("budget.dat"), "magicBudgetCache");
+    CFlatDB<CBudgetManager> flatdb5 = CacheDB<CBudgetManager>("budget", "magicBudgetCache");
     flatdb5.Dump(budget);
-    CFlatDB<CNetFulfilledRequestManager> flatdb6(fs::PathFromString("netfulfilled.dat"), "magicFulfilledCache");
+    CFlatDB<CNetFulfilledRequestManager> flatdb6 = CacheDB<CNetFulfilledRequestManager>("netfulfilled", "magicFulfilledCache");
     flatdb6.Dump(netfulfilledman);
 }
 
 bool LoadCaches()
 {
-    std::string strDBName;
-    fs::path pathDB = GetDataDir();
+    CFlatDB<CMasternodeMan> flatdb1 = CacheDB<CMasternodeMan>("mncache", "magicMasternodeCache");
+    CFlatDB<CSystemnodeMan> flatdb2 = CacheDB<CSystemnodeMan>("sncache", "magicSystemnodeCache");
+    CFlatDB<CMasternodePayments> flatdb3 = CacheDB<CMasternodePayments>("mnpayments", "magicMasternodePaymentsCache");
+    CFlatDB<CSystemnodePayments> flatdb4 = CacheDB<CSystemnodePayments>("snpayments", "magicSystemnodePaymentsCache");
+    CFlatDB<CBudgetManager> flatdb5 = CacheDB<CBudgetManager>("budget", "magicBudgetCache");
+    CFlatDB<CNetFulfilledRequestManager> flatdb6 = CacheDB<CNetFulfilledRequestManager>("netfulfilled", "magicFulfilledCache");
+
+    // Every cache lives in its own file and object, so reading and deserializing them is done
+    // concurrently. Cleaning looks at other managers and the chain, so it runs afterwards in the
+    // original order.
+    uiInterface.InitMessage("Loading masternode and systemnode caches...");
+    auto fMnLoaded = std::async(std::launch::async, [&] { return flatdb1.Load(mnodeman, false); });
+    auto fSnLoaded = std::async(std::launch::async, [&] { return flatdb2.Load(snodeman, false); });
+    auto fBudgetLoaded = std::async(std::launch::async, [&] { return flatdb5.Load(budget, false); });
+    auto fFulfilledLoaded = std::async(std::launch::async, [&] { return flatdb6.Load(netfulfilledman, false); });
+
+    bool fMnOk = fMnLoaded.get();
+    bool fSnOk = fSnLoaded.get();
+    bool fBudgetOk = fBudgetLoaded.get();
+    bool fFulfilledOk = fFulfilledLoaded.get();
 
-    strDBName = "mncache.dat";
-    uiInterface.InitMessage("Loading masternode cache...");
-    CFlatDB<CMasternodeMan> flatdb1(fs::PathFromString(strDBName), "magicMasternodeCache");
-    if (!flatdb1.Load(mnodeman)) {
+    // collaterals are looked up once here and then followed from block events by CCollateralWatcher
+    if (!fMnOk) {
         LogPrintf("Failed to load masternode cache.");
         return false;
     }
+    mnodeman.CheckCollaterals();
+    flatdb1.Clean(mnodeman);
 
-    strDBName = "sncache.dat";
-    uiInterface.InitMessage("Loading systemnode cache...");
-    CFlatDB<CSystemnodeMan> flatdb2(fs::PathFromString(strDBName), "magicSystemnodeCache");
-    if (!flatdb2.Load(snodeman)) {
+    if (!fSnOk) {
         LogPrintf("Failed to load systemnode cache.");
         return false;
     }
+    snodeman.CheckCollaterals();
+    flatdb2.Clean(snodeman);
+
+    // payments are only worth loading once there are nodes to pay
+    uiInterface.InitMessage("Loading payment caches...");
+    bool fLoadMnPayments = mnodeman.size() > 0;
+    bool fLoadSnPayments = snodeman.size() > 0;
+    std::future<bool> fMnPaymentsLoaded, fSnPaymentsLoaded;
+    if (fLoadMnPayments)
+        fMnPaymentsLoaded = std::async(std::launch::async, [&] { return flatdb3.Load(masternodePayments, false); });
+    if (fLoadSnPayments)
+        fSnPaymentsLoaded = std::async(std::launch::async, [&] { return flatdb4.Load(systemnodePayments, false); });
+
+    bool fMnPaymentsOk = !fLoadMnPayments || fMnPaymentsLoaded.get();
+    bool fSnPaymentsOk = !fLoadSnPayments || fSnPaymentsLoaded.get();
 
-    if (mnodeman.size()) {
-        strDBName = "mnpayments.dat";
-        uiInterface.InitMessage("Loading masternode payment cache...");
-        CFlatDB<CMasternodePayments> flatdb3(fs::PathFromString(strDBName), "magicMasternodePaymentsCache");
-        if (!flatdb3.Load(masternodePayments)) {
+    if (fLoadMnPayments) {
+        if (!fMnPaymentsOk) {
             LogPrintf("Failed to load masternode payments cache.");
             return false;
         }
+        flatdb3.Clean(masternodePayments);
     }
 
-    if (snodeman.size()) {
-        strDBName = "snpayments.dat";
-        uiInterface.InitMessage("Loading systemnode payment cache...");
-        CFlatDB<CSystemnodePayments> flatdb4(fs::PathFromString(strDBName), "magicSystemnodePaymentsCache");
-        if (!flatdb4.Load(systemnodePayments)) {
+    if (fLoadSnPayments) {
+        if (!fSnPaymentsOk) {
             LogPrintf("Failed to load systemnode payments cache.");
             return false;
         }
+        flatdb4.Clean(systemnodePayments);
     }
 
-    strDBName = "budget.dat";
-    uiInterface.InitMessage("Loading budget cache...");
-    CFlatDB<CBudgetManager> flatdb5(fs::PathFromString(strDBName), "magicBudgetCache");
-    if (!flatdb5.Load(budget)) {
+    if (!fBudgetOk) {
         LogPrintf("Failed to load budget cache.");
         return false;
     }
+    flatdb5.Clean(budget);
 
-    strDBName = "netfulfilled.dat";
-    uiInterface.InitMessage("Loading fulfilled requests cache...");
-    CFlatDB<CNetFulfilledRequestManager> flatdb6(fs::PathFromString(strDBName), "magicFulfilledCache");
-    if (!flatdb6.Load(netfulfilledman)) {
+    if (!fFulfilledOk) {
         LogPrintf("Failed to load fulfilled requests cache.");
         return false;
     }
+    flatdb6.Clean(netfulfilledman);
 
     return true;
 }
@@ -18,7 +18,27 @@
 #include <util/system.h>
 #include <util/translation.h>
 
+static const int64_t DEFAULT_CACHE_SNAPSHOT_INTERVAL = 15 * 60;
+
+/** Timing of the periodic snapshots of one cache file */
+struct CCacheSnapshotStats {
+    int64_t nLastTime{0};
+    //! time spent copying the manager under its lock
+    int64_t nLastCopyMicros{0};
+    //! time spent serializing and writing the copy
+    int64_t nLastWriteMicros{0};
+    int64_t nMaxCopyMicros{0};
+    int64_t nMaxWriteMicros{0};
+    uint64_t nCount{0};
+    uint64_t nFailures{0};
+};
+
 void DumpCaches();
 bool LoadCaches();
 
+/** Write copies of the masternode, systemnode and budget caches while the node is running */
+void SnapshotCaches();
+/** Snapshot statistics by cache file name */
+std::map<std::string, CCacheSnapshotStats> GetCacheSnapshotStats();
+
 #endif // CROWN_CACHE_H
@@ -0,0 +1,46 @@
+// Copyright (c) 2014-2020 The Crown developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crown/collateralwatcher.h>
+#include <masternode/masternodeman.h>
+#include <primitives/block.h>
+#include <systemnode/systemnodeman.h>
+
+CCollateralWatcher collateralWatcher;
+
+// Outpoints created by the transactions of a block and outpoints spent by its inputs
+static void GetBlockOutpoints(const CBlock& block, std::vector<COutPoint>& vCreated, std::vector<COutPoint>& vSpent)
+{
+    for (const CTransactionRef& tx : block.vtx) {
+        const uint256 txid = tx->GetHash();
+        const uint32_t nOutputs = (tx->nVersion >= TX_ELE_VERSION ? tx->vpout.size() : tx->vout.size());
+        for (uint32_t n = 0; n < nOutputs; n++)
+            vCreated.emplace_back(txid, n);
+
+        if (tx->IsCoinBase())
+            continue;
+        for (const CTxIn& txin : tx->vin)
+            vSpent.emplace_back(txin.prevout);
+    }
+}
+
+void CCollateralWatcher::BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex)
+{
+    std::vector<COutPoint> vCreated, vSpent;
+    GetBlockOutpoints(*block, vCreated, vSpent);
+
+    // outputs created again when a disconnected block is reconnected are restored
+    mnodeman.UpdateCollaterals(vCreated, vSpent);
+    snodeman.UpdateCollaterals(vCreated, vSpent);
+}
+
+void CCollateralWatcher::BlockDisconnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex)
+{
+    std::vector<COutPoint> vCreated, vSpent;
+    GetBlockOutpoints(*block, vCreated, vSpent);
+
+    // the inputs of the block are unspent again and its outputs no longer exist
+    mnodeman.UpdateCollaterals(vSpent, vCreated);
+    snodeman.UpdateCollaterals(vSpent, vCreated);
+}
@@ -0,0 +1,23 @@
+// Copyright (c) 2014-2020 The Crown developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CROWN_COLLATERALWATCHER_H
+#define CROWN_COLLATERALWATCHER_H
+
+#include <validationinterface.h>
+
+/*
+ * Follows the outpoints spent and created by connected and disconnected blocks and hands them
+ * to the masternode and systemnode managers, which flag the nodes whose collateral they hold.
+ * This replaces looking up every collateral in the UTXO set on each periodic node check.
+ */
+class CCollateralWatcher : public CValidationInterface {
+protected:
+    void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex) override;
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex) override;
+};
+
+extern CCollateralWatcher collateralWatcher;
+
+#endif // CROWN_COLLATERALWATCHER_H
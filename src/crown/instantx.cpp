@@ -124,7 +124,7 @@ void CInstantSend::ProcessMessage(CNode* pfrom, const std::string& strCommand, C
         CInv inv(MSG_TXLOCK_VOTE, ctxHash);
         pfrom->AddInventoryKnown(inv);
 
-        if (mapTxLockVote.find(ctx.GetHash()) != mapTxLockVote.end())
+        if (AlreadyHave(ctxHash))
             return;
 
         // Check if transaction is old for lock
@@ -134,7 +134,11 @@ void CInstantSend::ProcessMessage(CNode* pfrom, const std::string& strCommand, C
             return;
         }
 
-        mapTxLockVote.insert(std::pair(ctx.GetHash(), ctx));
+        {
+            LOCK(cs);
+            mapTxLockVote.insert(std::pair(ctx.GetHash(), ctx));
+            ScheduleVoteExpiry(ctx);
+        }
 
         if (ProcessConsensusVote(pfrom, ctx, *connman)) {
             /*
@@ -259,6 +263,7 @@ int64_t CInstantSend::CreateNewLock(const CMutableTransaction& tx)
         newLock.nBlockHeight = nBlockHeight;
         newLock.txHash = txHash;
         mapTxLocks.insert(std::pair(txHash, newLock));
+        ScheduleLockExpiry(newLock);
     } else {
         mapTxLocks[txHash].nBlockHeight = nBlockHeight;
         LogPrintf("CreateNewLock - Transaction Lock Exists %s !\n", txHash.ToString().c_str());
@@ -307,6 +312,7 @@ void CInstantSend::DoConsensusVote(const CMutableTransaction& tx, int64_t nBlock
 
     uint256 ctxHash = ctx.GetHash();
     mapTxLockVote[ctxHash] = ctx;
+    ScheduleVoteExpiry(ctx);
 
     CInv inv(MSG_TXLOCK_VOTE, ctxHash);
     connman.RelayInv(inv);
@@ -319,7 +325,8 @@ bool CInstantSend::ProcessConsensusVote(CNode* pnode, const CConsensusVote& ctx,
     uint256 ctxHash = ctx.GetHash();
     int n = mnodeman.GetMasternodeRank(ctx.vinMasternode, ctx.nBlockHeight, MIN_INSTANTX_PROTO_VERSION);
 
-    CMasternode* pmn = mnodeman.Find(ctx.vinMasternode);
+    std::shared_ptr<const MasternodeListSnapshot> pSnapshot = mnodeman.GetListSnapshot();
+    const CMasternode* pmn = pSnapshot->Find(ctx.vinMasternode.prevout);
     if (pmn)
         LogPrintf("InstantX::ProcessConsensusVote - Masternode ADDR %s %d\n", pmn->addr.ToString().c_str(), n);
 
@@ -349,6 +356,7 @@ bool CInstantSend::ProcessConsensusVote(CNode* pnode, const CConsensusVote& ctx,
         newLock.nBlockHeight = 0;
         newLock.txHash = ctx.txHash;
         mapTxLocks.insert(std::make_pair(ctx.txHash, newLock));
+        ScheduleLockExpiry(newLock);
     } else
         LogPrintf("InstantX::ProcessConsensusVote - Transaction Lock Exists %s !\n", ctx.txHash.ToString().c_str());
 
@@ -406,10 +414,13 @@ bool CInstantSend::CheckForConflictingLocks(const CMutableTransaction& tx)
             if (mapLockedInputs[in.prevout] != txHash) {
                 LogPrintf("InstantX::CheckForConflictingLocks - found two complete conflicting locks - removing both. %s %s",
                     txHash.ToString().c_str(), mapLockedInputs[in.prevout].ToString().c_str());
-                if (mapTxLocks.count(txHash))
-                    mapTxLocks[txHash].m_expiration = GetTime();
-                if (mapTxLocks.count(mapLockedInputs[in.prevout]))
-                    mapTxLocks[mapLockedInputs[in.prevout]].m_expiration = GetTime();
+                for (const uint256& hash : {txHash, mapLockedInputs[in.prevout]}) {
+                    std::map<uint256, CTransactionLock>::iterator it = mapTxLocks.find(hash);
+                    if (it != mapTxLocks.end()) {
+                        it->second.m_expiration = GetTime();
+                        ScheduleLockExpiry(it->second);
+                    }
+                }
                 return true;
             }
         }
@@ -432,48 +443,81 @@ int64_t CInstantSend::GetAverageVoteTime() const
     return total / count;
 }
 
+void CInstantSend::ScheduleLockExpiry(const CTransactionLock& lock)
+{
+    LOCK(cs);
+    m_lockExpiry.emplace(lock.m_expiration, lock.txHash);
+}
+
+void CInstantSend::ScheduleVoteExpiry(const CConsensusVote& vote)
+{
+    LOCK(cs);
+    // votes of transactions older than m_acceptedBlockCount blocks are of no use, whatever expiration the sender chose
+    int64_t nDeadline = std::min<int64_t>(vote.m_expiration, GetTime() + m_numberOfSeconds * m_acceptedBlockCount);
+    m_voteExpiry.emplace(nDeadline, vote.GetHash());
+}
+
+void CInstantSend::RebuildExpiryQueues()
+{
+    LOCK(cs);
+    m_lockExpiry = ExpiryQueue();
+    m_voteExpiry = ExpiryQueue();
+    for (const auto& lock : mapTxLocks)
+        ScheduleLockExpiry(lock.second);
+    for (const auto& vote : mapTxLockVote)
+        ScheduleVoteExpiry(vote.second);
+}
+
 void CInstantSend::CheckAndRemove()
 {
     LOCK(cs);
     if (!::ChainActive().Tip())
         return;
 
-    std::map<uint256, CTransactionLock>::iterator it = mapTxLocks.begin();
+    int64_t nStart = GetTimeMicros();
+    int64_t nNow = GetTime();
 
-    while (it != mapTxLocks.end()) {
-        if (GetTime() > it->second.m_expiration) {
-            LogPrintf("Removing old transaction lock %s\n", it->second.txHash.ToString().c_str());
+    while (!m_lockExpiry.empty() && m_lockExpiry.top().first < nNow) {
+        uint256 txHash = m_lockExpiry.top().second;
+        int64_t nDeadline = m_lockExpiry.top().first;
+        m_lockExpiry.pop();
 
-            // Remove rejected transaction if expired
-            mapTxLockReqRejected.erase(it->second.txHash);
+        std::map<uint256, CTransactionLock>::iterator it = mapTxLocks.find(txHash);
+        // already removed, or rescheduled with a new expiration
+        if (it == mapTxLocks.end() || it->second.m_expiration != nDeadline)
+            continue;
 
-            std::map<uint256, CMutableTransaction>::iterator itLock = mapTxLockReq.find(it->second.txHash);
-            if (itLock != mapTxLockReq.end()) {
-                CMutableTransaction& tx = itLock->second;
+        LogPrintf("Removing old transaction lock %s\n", txHash.ToString().c_str());
 
-                for (const auto& in : tx.vin)
-                    mapLockedInputs.erase(in.prevout);
+        // Remove rejected transaction if expired
+        mapTxLockReqRejected.erase(txHash);
 
-                mapTxLockReq.erase(it->second.txHash);
+        std::map<uint256, CMutableTransaction>::iterator itLock = mapTxLockReq.find(txHash);
+        if (itLock != mapTxLockReq.end()) {
+            CMutableTransaction& tx = itLock->second;
 
-                for (const auto& v : it->second.vecConsensusVotes)
-                    mapTxLockVote.erase(v.GetHash());
-            }
-            mapTxLocks.erase(it++);
-        } else {
-            it++;
+            for (const auto& in : tx.vin)
+                mapLockedInputs.erase(in.prevout);
+
+            mapTxLockReq.erase(itLock);
+
+            for (const auto& v : it->second.vecConsensusVotes)
+                mapTxLockVote.erase(v.GetHash());
         }
+        mapTxLocks.erase(it);
+        m_stats.nExpiredLocks++;
     }
 
-    std::map<uint256, CConsensusVote>::iterator itVote = mapTxLockVote.begin();
-    while (itVote != mapTxLockVote.end()) {
-        if (GetTime() > it->second.m_expiration || GetTransactionAge(it->second.txHash) > CInstantSend::nCompleteTXLocks) {
-            // Remove transaction vote if it is expired or belongs to old transaction
-            mapTxLockVote.erase(itVote++);
-        } else {
-            ++itVote;
-        }
+    // Remove transaction votes that are expired or belong to old transactions
+    while (!m_voteExpiry.empty() && m_voteExpiry.top().first < nNow) {
+        if (mapTxLockVote.erase(m_voteExpiry.top().second))
+            m_stats.nExpiredVotes++;
+        m_voteExpiry.pop();
     }
+
+    m_stats.nLastCleanupMicros = GetTimeMicros() - nStart;
+    m_stats.nMaxCleanupMicros = std::max(m_stats.nMaxCleanupMicros, m_stats.nLastCleanupMicros);
+    m_stats.nCleanups++;
 }
 
 int CInstantSend::GetSignaturesCount(uint256 txHash) const
@@ -501,6 +545,7 @@ bool CInstantSend::TxLockRequested(uint256 txHash) const
 
 bool CInstantSend::AlreadyHave(uint256 txHash) const
 {
+    LOCK(cs);
     return mapTxLockVote.find(txHash) != mapTxLockVote.end();
 }
 
@@ -522,6 +567,19 @@ void CInstantSend::Clear()
     mapTxLocks.clear();
     mapUnknownVotes.clear();
     mapTxLockReqRejected.clear();
+    m_lockExpiry = ExpiryQueue();
+    m_voteExpiry = ExpiryQueue();
+}
+
+CInstantSendStats CInstantSend::GetStats() const
+{
+    LOCK(cs);
+    CInstantSendStats stats = m_stats;
+    stats.nLockRequests = mapTxLockReq.size();
+    stats.nLocks = mapTxLocks.size();
+    stats.nLockedInputs = mapLockedInputs.size();
+    stats.nVotes = mapTxLockVote.size();
+    return stats;
 }
 
 int CInstantSend::GetCompleteLocksCount() const
@@ -534,13 +592,19 @@ uint256 CConsensusVote::GetHash() const
     return ArithToUint256(UintToArith256(vinMasternode.prevout.hash) + vinMasternode.prevout.n + UintToArith256(txHash));
 }
 
+std::string CConsensusVote::GetSignatureMessage() const
+{
+    return txHash.ToString().c_str() + boost::lexical_cast<std::string>(nBlockHeight);
+}
+
 bool CConsensusVote::SignatureValid() const
 {
     std::string errorMessage;
-    std::string strMessage = txHash.ToString().c_str() + boost::lexical_cast<std::string>(nBlockHeight);
+    std::string strMessage = GetSignatureMessage();
     //LogPrintf("verify strMessage %s \n", strMessage.c_str());
 
-    CMasternode* pmn = mnodeman.Find(vinMasternode);
+    std::shared_ptr<const MasternodeListSnapshot> pSnapshot = mnodeman.GetListSnapshot();
+    const CMasternode* pmn = pSnapshot->Find(vinMasternode.prevout);
 
     if (!pmn) {
         LogPrintf("InstantX::CConsensusVote::SignatureValid() - Unknown Masternode\n");
@@ -561,7 +625,7 @@ bool CConsensusVote::Sign()
 
     CKey key2;
     CPubKey pubkey2;
-    std::string strMessage = txHash.ToString().c_str() + boost::lexical_cast<std::string>(nBlockHeight);
+    std::string strMessage = GetSignatureMessage();
     //LogPrintf("signing strMessage %s \n", strMessage.c_str());
     //LogPrintf("signing privkey %s \n", strMasterNodePrivKey.c_str());
 
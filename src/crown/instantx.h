@@ -13,6 +13,9 @@
 #include <sync.h>
 #include <util/system.h>
 
+#include <functional>
+#include <queue>
+
 /*
     At 15 signatures, 1/2 of the masternode network can be owned by
     one party without comprimising the security of InstantX
@@ -33,6 +36,19 @@ static const int MIN_INSTANTX_PROTO_VERSION = 70040;
 
 extern CInstantSend instantSend;
 
+/** Sizes of the InstantSend maps and cost of CInstantSend::CheckAndRemove since startup */
+struct CInstantSendStats {
+    size_t nLockRequests{0};
+    size_t nLocks{0};
+    size_t nLockedInputs{0};
+    size_t nVotes{0};
+    uint64_t nCleanups{0};
+    uint64_t nExpiredLocks{0};
+    uint64_t nExpiredVotes{0};
+    int64_t nLastCleanupMicros{0};
+    int64_t nMaxCleanupMicros{0};
+};
+
 class CInstantSend {
 public:
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman);
@@ -45,6 +61,7 @@ public:
     bool TxLockRequested(uint256 txHash) const;
     bool AlreadyHave(uint256 txHash) const;
     std::string ToString() const;
+    CInstantSendStats GetStats() const;
 
     SERIALIZE_METHODS(CInstantSend, obj)
     {
@@ -55,6 +72,7 @@ public:
         READWRITE(obj.mapUnknownVotes);
         READWRITE(obj.mapTxLockReqRejected);
         READWRITE(obj.nCompleteTXLocks);
+        SER_READ(obj, obj.RebuildExpiryQueues());
     }
 
 public:
@@ -67,8 +85,14 @@ private:
     bool ProcessConsensusVote(CNode* pnode, const CConsensusVote& ctx, CConnman& connman);
     bool CheckForConflictingLocks(const CMutableTransaction& tx);
     int64_t GetAverageVoteTime() const;
+    void ScheduleLockExpiry(const CTransactionLock& lock);
+    void ScheduleVoteExpiry(const CConsensusVote& vote);
+    void RebuildExpiryQueues();
 
 private:
+    //! (deadline, hash) min-heap, the earliest deadline on top
+    typedef std::priority_queue<std::pair<int64_t, uint256>, std::vector<std::pair<int64_t, uint256>>, std::greater<std::pair<int64_t, uint256>>> ExpiryQueue;
+
     // critical section to protect the inner data structures
     mutable RecursiveMutex cs;
 
@@ -78,6 +102,13 @@ private:
     std::map<uint256, CMutableTransaction> mapTxLockReqRejected;
     int nCompleteTXLocks;
 
+    // Expiry deadlines of mapTxLocks and mapTxLockVote so CheckAndRemove only visits expired entries.
+    // Entries are not removed when their lock or vote goes away or the lock expiration changes,
+    // they are skipped once they reach the top.
+    ExpiryQueue m_lockExpiry;
+    ExpiryQueue m_voteExpiry;
+    CInstantSendStats m_stats;
+
 public:
     // TODO: test how warm this is, these should be private w/LOCK
     std::map<uint256, CConsensusVote> mapTxLockVote;
@@ -91,6 +122,8 @@ public:
     {
     }
     uint256 GetHash() const;
+    //! The message covered by the signature, see CLegacySigner::GetMessageHash
+    std::string GetSignatureMessage() const;
     bool SignatureValid() const;
     bool Sign();
 
@@ -0,0 +1,113 @@
+// Copyright (c) 2014-2020 The Crown developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crown/legacysigcache.h>
+
+#include <crypto/sha256.h>
+#include <random.h>
+#include <script/sigcache.h>
+#include <util/system.h>
+
+#include <cuckoocache.h>
+
+#include <algorithm>
+#include <atomic>
+#include <shared_mutex>
+
+namespace {
+/**
+ * Cache of the keys recovered from masternode, systemnode, budget, spork and instantsend message
+ * signatures, so a message that is seen again does not repeat the compact key recovery.
+ */
+class CLegacySignatureCache
+{
+private:
+    //! Entries are SHA256(nonce || 'L' || 31 zero bytes || message hash || key id || signature)
+    CSHA256 m_salted_hasher;
+    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
+    map_type setValid;
+    std::shared_mutex cs_sigcache;
+    size_t nMaxElements{0};
+
+public:
+    std::atomic<uint64_t> nHits{0};
+    std::atomic<uint64_t> nMisses{0};
+
+    CLegacySignatureCache()
+    {
+        uint256 nonce = GetRandHash();
+        static constexpr unsigned char PADDING_LEGACY[32] = {'L'};
+        m_salted_hasher.Write(nonce.begin(), 32);
+        m_salted_hasher.Write(PADDING_LEGACY, 32);
+    }
+
+    void ComputeEntry(uint256& entry, const uint256& hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyID) const
+    {
+        CSHA256 hasher = m_salted_hasher;
+        hasher.Write(hash.begin(), 32).Write(keyID.begin(), keyID.size()).Write(vchSig.data(), vchSig.size()).Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry)
+    {
+        std::shared_lock<std::shared_mutex> lock(cs_sigcache);
+        return setValid.contains(entry, false);
+    }
+
+    void Set(uint256& entry)
+    {
+        std::unique_lock<std::shared_mutex> lock(cs_sigcache);
+        setValid.insert(entry);
+    }
+
+    uint32_t setup_bytes(size_t n)
+    {
+        std::unique_lock<std::shared_mutex> lock(cs_sigcache);
+        nMaxElements = setValid.setup_bytes(n);
+        return nMaxElements;
+    }
+
+    size_t size() const
+    {
+        return nMaxElements;
+    }
+};
+
+static CLegacySignatureCache legacySignatureCache;
+} // namespace
+
+void InitLegacySignatureCache()
+{
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxlegacysigcachesize", DEFAULT_MAX_LEGACY_SIG_CACHE_SIZE)), MAX_MAX_LEGACY_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
+    size_t nElems = legacySignatureCache.setup_bytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for legacy signature cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, nMaxCacheSize>>20, nElems);
+}
+
+bool IsCachedLegacySignature(const uint256& hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyID)
+{
+    uint256 entry;
+    legacySignatureCache.ComputeEntry(entry, hash, vchSig, keyID);
+    if (legacySignatureCache.Get(entry)) {
+        legacySignatureCache.nHits++;
+        return true;
+    }
+    legacySignatureCache.nMisses++;
+    return false;
+}
+
+void AddCachedLegacySignature(const uint256& hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyID)
+{
+    uint256 entry;
+    legacySignatureCache.ComputeEntry(entry, hash, vchSig, keyID);
+    legacySignatureCache.Set(entry);
+}
+
+CLegacySigCacheStats GetLegacySignatureCacheStats()
+{
+    CLegacySigCacheStats stats;
+    stats.nHits = legacySignatureCache.nHits;
+    stats.nMisses = legacySignatureCache.nMisses;
+    stats.nMaxElements = legacySignatureCache.size();
+    return stats;
+}
@@ -0,0 +1,36 @@
+// Copyright (c) 2014-2020 The Crown developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CROWN_LEGACYSIGCACHE_H
+#define CROWN_LEGACYSIGCACHE_H
+
+#include <pubkey.h>
+#include <uint256.h>
+
+#include <stdint.h>
+#include <vector>
+
+// The same broadcasts arrive from many peers and budget votes are re-checked on every clean,
+// 8MB holds the signatures of a few large lists
+static const unsigned int DEFAULT_MAX_LEGACY_SIG_CACHE_SIZE = 8;
+// Maximum sig cache size allowed
+static const int64_t MAX_MAX_LEGACY_SIG_CACHE_SIZE = 1024;
+
+/** Usage of the legacy signature cache since startup */
+struct CLegacySigCacheStats {
+    uint64_t nHits{0};
+    uint64_t nMisses{0};
+    size_t nMaxElements{0};
+};
+
+void InitLegacySignatureCache();
+
+/** Whether the compact signature vchSig of hash is known to recover the key keyID */
+bool IsCachedLegacySignature(const uint256& hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyID);
+/** Remember the key recovered from the compact signature vchSig of hash */
+void AddCachedLegacySignature(const uint256& hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyID);
+
+CLegacySigCacheStats GetLegacySignatureCacheStats();
+
+#endif // CROWN_LEGACYSIGCACHE_H
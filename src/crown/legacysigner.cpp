@@ -5,7 +5,9 @@
 
 #include <crown/legacysigner.h>
 
+#include <checkqueue.h>
 #include <crown/instantx.h>
+#include <crown/legacysigcache.h>
 #include <index/txindex.h>
 #include <init.h>
 #include <util/system.h>
@@ -21,6 +23,8 @@
 #include <boost/lexical_cast.hpp>
 
 #include <algorithm>
+#include <deque>
+#include <map>
 #include <boost/assign/list_of.hpp>
 
 
@@ -89,13 +93,18 @@ bool CLegacySigner::SetKey(std::string strSecret, CKey& key, CPubKey& pubkey)
     return true;
 }
 
-bool CLegacySigner::SignMessage(const std::string& strMessage, std::vector<unsigned char>& vchSigRet, const CKey& key)
+uint256 CLegacySigner::GetMessageHash(const std::string& strMessage)
 {
     CHashWriter ss(SER_GETHASH, 0);
     ss << MESSAGE_MAGIC;
     ss << strMessage;
 
-    return CHashSigner::SignHash(ss.GetHash(), key, vchSigRet);
+    return ss.GetHash();
+}
+
+bool CLegacySigner::SignMessage(const std::string& strMessage, std::vector<unsigned char>& vchSigRet, const CKey& key)
+{
+    return CHashSigner::SignHash(GetMessageHash(strMessage), key, vchSigRet);
 }
 
 bool CLegacySigner::VerifyMessage(const CPubKey& pubkey, const std::vector<unsigned char>& vchSig, const std::string& strMessage, std::string& strErrorRet)
@@ -104,12 +113,121 @@ bool CLegacySigner::VerifyMessage(const CPubKey& pubkey, const std::vector<unsig
 }
 
 bool CLegacySigner::VerifyMessage(const CKeyID& keyID, const std::vector<unsigned char>& vchSig, const std::string& strMessage, std::string& strErrorRet)
+{
+    return CHashSigner::VerifyHash(GetMessageHash(strMessage), keyID, vchSig, strErrorRet);
+}
+
+//! Most outcomes kept for pairs that have not been verified by a handler yet
+static const size_t MAX_PREVERIFIED_SIGNATURES = 20000;
+
+/**
+ * Compact signature recovery of one (hash, signature) pair. The recovered key ID, null if the
+ * recovery failed, is written to its slot instead of being returned, so a bad signature does not
+ * stop the rest of the batch.
+ */
+class CLegacySigCheck
+{
+private:
+    uint256 hash;
+    std::vector<unsigned char> vchSig;
+    CKeyID* pkeyID{nullptr};
+
+public:
+    CLegacySigCheck() {}
+    CLegacySigCheck(const uint256& hashIn, const std::vector<unsigned char>& vchSigIn, CKeyID* pkeyIDIn) : hash(hashIn), vchSig(vchSigIn), pkeyID(pkeyIDIn) {}
+
+    bool operator()()
+    {
+        CPubKey pubkeyFromSig;
+        if (pubkeyFromSig.RecoverCompact(hash, vchSig)) {
+            *pkeyID = pubkeyFromSig.GetID();
+            AddCachedLegacySignature(hash, vchSig, *pkeyID);
+        }
+        return true;
+    }
+
+    void swap(CLegacySigCheck& check)
+    {
+        std::swap(hash, check.hash);
+        vchSig.swap(check.vchSig);
+        std::swap(pkeyID, check.pkeyID);
+    }
+};
+
+static CCheckQueue<CLegacySigCheck> legacysigcheckqueue(128);
+
+static Mutex cs_preverified;
+//! Hash(hash, signature) => recovered key ID (null if the recovery failed), and the keys in insertion order to evict the oldest first
+static std::map<uint256, CKeyID> mapPreverified GUARDED_BY(cs_preverified);
+static std::deque<uint256> dequePreverified GUARDED_BY(cs_preverified);
+
+static uint256 GetPreverifiedKey(const uint256& hash, const std::vector<unsigned char>& vchSig)
 {
     CHashWriter ss(SER_GETHASH, 0);
-    ss << MESSAGE_MAGIC;
-    ss << strMessage;
+    ss << hash << vchSig;
+    return ss.GetHash();
+}
+
+static bool ConsumePreverifiedSignature(const uint256& hash, const std::vector<unsigned char>& vchSig, CKeyID& keyIDRet)
+{
+    LOCK(cs_preverified);
+    if (mapPreverified.empty())
+        return false;
+
+    auto it = mapPreverified.find(GetPreverifiedKey(hash, vchSig));
+    if (it == mapPreverified.end())
+        return false;
+
+    keyIDRet = it->second;
+    mapPreverified.erase(it);
+    return true;
+}
+
+bool IsLegacySignaturePreverified(const uint256& hash, const std::vector<unsigned char>& vchSig)
+{
+    LOCK(cs_preverified);
+    return mapPreverified.count(GetPreverifiedKey(hash, vchSig));
+}
+
+void PreverifyLegacySignatures(const std::vector<std::pair<uint256, std::vector<unsigned char>>>& vSignatures)
+{
+    if (vSignatures.empty())
+        return;
+
+    std::vector<CKeyID> vKeyIDs(vSignatures.size());
+    std::vector<CLegacySigCheck> vChecks;
+    vChecks.reserve(vSignatures.size());
+    for (size_t i = 0; i < vSignatures.size(); i++) {
+        vChecks.emplace_back(vSignatures[i].first, vSignatures[i].second, &vKeyIDs[i]);
+    }
 
-    return CHashSigner::VerifyHash(ss.GetHash(), keyID, vchSig, strErrorRet);
+    {
+        CCheckQueueControl<CLegacySigCheck> control(&legacysigcheckqueue);
+        control.Add(vChecks);
+        control.Wait();
+    }
+
+    LOCK(cs_preverified);
+    for (size_t i = 0; i < vSignatures.size(); i++) {
+        uint256 key = GetPreverifiedKey(vSignatures[i].first, vSignatures[i].second);
+        if (mapPreverified.emplace(key, vKeyIDs[i]).second)
+            dequePreverified.push_back(key);
+    }
+    // consumed entries leave their key behind, so the deque bounds the map as well
+    while (dequePreverified.size() > MAX_PREVERIFIED_SIGNATURES) {
+        mapPreverified.erase(dequePreverified.front());
+        dequePreverified.pop_front();
+    }
+}
+
+void StartLegacySigCheckWorkerThreads(int threads_num)
+{
+    legacysigcheckqueue.StartWorkerThreads(threads_num);
+}
+
+void StopLegacySigCheckWorkerThreads()
+{
+    legacysigcheckqueue.StopWorkerThreads();
 }
 
 bool CHashSigner::SignHash(const uint256& hash, const CKey& key, std::vector<unsigned char>& vchSigRet)
@@ -124,8 +242,21 @@ bool CHashSigner::VerifyHash(const uint256& hash, const CPubKey& pubkey, const s
 
 bool CHashSigner::VerifyHash(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig, std::string& strErrorRet)
 {
-    CPubKey pubkeyFromSig;
-    if (!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
+    if (IsCachedLegacySignature(hash, vchSig, keyID))
+        return true;
+
+    // a batch outcome only answers for the key it recovered, other keys are checked as before
+    CKeyID keyIDPreverified;
+    bool fValid;
+    if (ConsumePreverifiedSignature(hash, vchSig, keyIDPreverified) && (keyIDPreverified.IsNull() || keyIDPreverified == keyID)) {
+        fValid = !keyIDPreverified.IsNull();
+    } else {
+        CPubKey pubkeyFromSig;
+        fValid = pubkeyFromSig.RecoverCompact(hash, vchSig);
+        if (fValid)
+            AddCachedLegacySignature(hash, vchSig, pubkeyFromSig.GetID());
+    }
+    if (!fValid) {
         strErrorRet = "Error recovering public key.";
         return false;
     }
@@ -43,6 +43,8 @@ public:
     bool SetCollateralAddress(std::string strAddress);
     /// Set the private/public key values, returns true if successful
     bool SetKey(std::string strSecret, CKey& key, CPubKey& pubkey);
+    /// Hash of the message as it is signed, prefixed by the message magic
+    static uint256 GetMessageHash(const std::string& strMessage);
     /// Sign the message, returns true if successful
     static bool SignMessage(const std::string& strMessage, std::vector<unsigned char>& vchSigRet, const CKey& key);
     /// Verify the message signature, returns true if succcessful
@@ -68,4 +70,18 @@ public:
     static bool VerifyHash(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig, std::string& strErrorRet);
 };
 
+/**
+ * Recover the signatures of a batch of (hash, signature) pairs on the legacy signature check threads.
+ * The outcomes are kept until CHashSigner::VerifyHash is called for the same pair, so handlers that
+ * verify the messages one by one afterwards no longer recover their keys on the message handler thread.
+ */
+void PreverifyLegacySignatures(const std::vector<std::pair<uint256, std::vector<unsigned char>>>& vSignatures);
+/** Whether the outcome for this pair is waiting to be consumed by CHashSigner::VerifyHash */
+bool IsLegacySignaturePreverified(const uint256& hash, const std::vector<unsigned char>& vchSig);
+
+/** Run instances of the legacy signature check worker threads */
+void StartLegacySigCheckWorkerThreads(int threads_num);
+/** Stop all of the legacy signature check worker threads */
+void StopLegacySigCheckWorkerThreads();
+
 #endif
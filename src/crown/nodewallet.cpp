@@ -181,7 +181,6 @@ void NodeMinter(const CChainParams& chainparams, CConnman& connman)
     return;
 }
 
-#define STAKE_SEARCH_INTERVAL 30
 bool NodeWallet::CreateCoinStake(const int nHeight, const uint32_t& nBits, const uint32_t& nTime, CMutableTransaction& txCoinStake, uint32_t& nTxNewTime, StakePointer& stakePointer)
 {
     CTxIn* pvinActiveNode;
@@ -282,58 +281,103 @@ bool NodeWallet::CreateCoinStake(const int nHeight, const uint32_t& nBits, const
     return false;
 }
 
+static StakePointer MakeStakePointer(const uint256& hashBlock, const uint256& txid, unsigned int nPos, const CPubKey& pubkey)
+{
+    StakePointer stakePointer;
+    stakePointer.hashBlock = hashBlock;
+    stakePointer.txid = txid;
+    stakePointer.nPos = nPos;
+    stakePointer.pubKeyProofOfStake = pubkey;
+    return stakePointer;
+}
+
 template <typename stakingnode>
-bool GetPointers(stakingnode* pstaker, std::vector<StakePointer>& vStakePointers, int nPaymentSlot)
+bool NodeWallet::GetPointers(stakingnode* pstaker, std::vector<StakePointer>& vStakePointers, unsigned int nPaymentSlot)
 {
-    bool found = false;
-    // get block index of last mn payment
-    std::vector<const CBlockIndex*> vBlocksLastPaid;
-    if (!pstaker->GetRecentPaymentBlocks(vBlocksLastPaid, false)) {
+    LOCK(cs_pointers);
+
+    CScript payee = GetScriptForDestination(PKHash(pstaker->pubkey));
+    if (fPointersStale || payee != scriptPointerPayee || nPaymentSlot != nPointerSlot) {
+        // collect the candidates again from the payment index
+        mapStakePointers.clear();
+        scriptPointerPayee = payee;
+        nPointerSlot = nPaymentSlot;
+        pubKeyPointers = pstaker->pubkey;
+        fPointersStale = false;
+
+        std::vector<NodePayment> vPayments;
+        pstaker->GetRecentPayments(vPayments, false);
+        for (const auto& payment : vPayments) {
+            mapStakePointers.emplace(payment.nHeight, MakeStakePointer(payment.hashBlock, payment.txid, nPaymentSlot, pubKeyPointers));
+        }
+    }
+
+    int nBestHeight = ::ChainActive().Height();
+    mapStakePointers.erase(mapStakePointers.begin(), mapStakePointers.lower_bound(stakingnode::GetPaymentWindowStart(nBestHeight)));
+    if (mapStakePointers.empty()) {
         LogPrintf("GetRecentStakePointer -- Couldn't find last paid block\n");
         return false;
     }
 
-    int nBestHeight = ::ChainActive().Height();
-    for (auto pindex : vBlocksLastPaid) {
-        if (budget.IsBudgetPaymentBlock(pindex->nHeight))
+    bool found = false;
+    for (const auto& pointer : mapStakePointers) {
+        if (budget.IsBudgetPaymentBlock(pointer.first))
             continue;
 
         // Pointer has to be at least deeper than the max reorg depth
         const int nMaxReorganizationDepth = 100;
-        if (nBestHeight - pindex->nHeight < nMaxReorganizationDepth)
+        if (nBestHeight - pointer.first < nMaxReorganizationDepth)
+            break;
+
+        // notifications trail validation, so make sure the pointer is still usable on the active chain
+        const CBlockIndex* pindex = ::ChainActive()[pointer.first];
+        if (!pindex || pindex->GetBlockHash() != pointer.second.hashBlock)
+            continue;
+        if (mapUsedStakePointers.count(COutPoint(pointer.second.txid, nPaymentSlot).GetHash()))
             continue;
 
-        CBlock blockLastPaid;
-        if (!ReadBlockFromDisk(blockLastPaid, pindex, Params().GetConsensus())) {
-            LogPrintf("GetRecentStakePointer -- Failed reading block from disk\n");
-            return false;
-        }
+        vStakePointers.emplace_back(pointer.second);
+        found = true;
+    }
+
+    return found;
+}
+
+void NodeWallet::BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex)
+{
+    if (block->vtx.empty() || !block->vtx[0]->IsCoinBase())
+        return;
 
-        CScript scriptMNPubKey;
-        scriptMNPubKey = GetScriptForDestination(PKHash(pstaker->pubkey));
-        for (auto& tx : blockLastPaid.vtx) {
-            auto stakeSource = COutPoint(tx->GetHash(), nPaymentSlot);
-            uint256 hashPointer = stakeSource.GetHash();
-            if (mapUsedStakePointers.count(hashPointer))
-                continue;
-
-            if (tx->IsCoinBase()) {
-                CTxOutAsset mout = (tx->nVersion >= TX_ELE_VERSION ? tx->vpout[nPaymentSlot] : tx->vout[nPaymentSlot]);
-                if(mout.scriptPubKey == scriptMNPubKey){
-                    StakePointer stakePointer;
-                    stakePointer.hashBlock = pindex->GetBlockHash();
-                    stakePointer.txid = tx->GetHash();
-                    stakePointer.nPos = nPaymentSlot;
-                    stakePointer.pubKeyProofOfStake = pstaker->pubkey;
-                    vStakePointers.emplace_back(stakePointer);
-                    found = true;
-                    continue;
-                }
+    LOCK(cs_pointers);
+    if (fPointersStale)
+        return;
+
+    // a new payment to the active node
+    const CTransactionRef& tx = block->vtx[0];
+    const bool fAssetOutputs = tx->nVersion >= TX_ELE_VERSION;
+    if (nPointerSlot < (fAssetOutputs ? tx->vpout.size() : tx->vout.size())) {
+        const CScript& payee = fAssetOutputs ? tx->vpout[nPointerSlot].scriptPubKey : tx->vout[nPointerSlot].scriptPubKey;
+        if (payee == scriptPointerPayee)
+            mapStakePointers[pindex->nHeight] = MakeStakePointer(pindex->GetBlockHash(), tx->GetHash(), nPointerSlot, pubKeyPointers);
+    }
+
+    // the pointer this block staked with can not be used again
+    if (block->IsProofOfStake()) {
+        for (auto it = mapStakePointers.begin(); it != mapStakePointers.end(); ++it) {
+            if (it->second.txid == block->stakePointer.txid && it->second.nPos == block->stakePointer.nPos) {
+                mapStakePointers.erase(it);
+                break;
             }
         }
     }
+}
 
-    return found;
+void NodeWallet::BlockDisconnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex)
+{
+    LOCK(cs_pointers);
+    mapStakePointers.erase(pindex->nHeight);
+    if (block->IsProofOfStake())
+        fPointersStale = true;
 }
 
 bool NodeWallet::GetRecentStakePointers(std::vector<StakePointer>& vStakePointers)
@@ -21,10 +21,29 @@
 #include <pos/kernel.h>
 #include <pos/stakeminer.h>
 #include <util/translation.h>
+#include <validationinterface.h>
 #include <wallet/coincontrol.h>
 #include <wallet/wallet.h>
 
-class NodeWallet {
+class NodeWallet : public CValidationInterface {
+private:
+    mutable Mutex cs_pointers;
+    // stake pointer candidates of the active node by height of the paying block
+    std::map<int, StakePointer> mapStakePointers GUARDED_BY(cs_pointers);
+    // payee and coinbase slot the candidates were collected for
+    CScript scriptPointerPayee GUARDED_BY(cs_pointers);
+    unsigned int nPointerSlot GUARDED_BY(cs_pointers) {0};
+    CPubKey pubKeyPointers GUARDED_BY(cs_pointers);
+    // set when a reorg may have released a used pointer, the candidates are then collected again
+    bool fPointersStale GUARDED_BY(cs_pointers) {true};
+
+    template <typename stakingnode>
+    bool GetPointers(stakingnode* pstaker, std::vector<StakePointer>& vStakePointers, unsigned int nPaymentSlot);
+
+protected:
+    void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex) override;
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex) override;
+
 public:
     bool GetMasternodeVinAndKeys(CTxIn& txinRet, CPubKey& pubKeyRet, CKey& keyRet, std::shared_ptr<CWallet> pwallet = GetMainWallet());
     bool GetSystemnodeVinAndKeys(CTxIn& txinRet, CPubKey& pubKeyRet, CKey& keyRet, std::shared_ptr<CWallet> pwallet = GetMainWallet());
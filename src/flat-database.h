@@ -12,11 +12,165 @@
 #include <streams.h>
 #include <util/system.h>
 
+#include <stdexcept>
+
 /**
 *   Generic Dumping and Loading
 *   ---------------------------
+*
+*   Files start with FLATDB_SIGNATURE and a format version, followed by the serialized
+*   object split into chunks of at most FLATDB_CHUNK_SIZE bytes. Every chunk is stored as
+*   [uint32 size][data][uint256 Hash(data)] and an empty chunk terminates the file, so the
+*   object is written and read as a stream and corruption is detected at the chunk it hits.
+*   Files written before the signature was introduced are still read in the legacy layout
+*   (magic message, network magic, object, hash of everything before it). Older versions
+*   cannot read the chunked layout, so it is written under a new filename and the legacy
+*   file is only read, as long as no file with the new name exists.
 */
 
+static const unsigned char FLATDB_SIGNATURE[8] = {'C', 'R', 'W', 'N', 'F', 'L', 'A', 'T'};
+static const uint32_t FLATDB_FORMAT_VERSION = 2;
+static const uint32_t FLATDB_CHUNK_SIZE = 1 << 20;
+
+/** Thrown when a chunk does not match its stored checksum */
+class flatdb_checksum_error : public std::runtime_error
+{
+public:
+    explicit flatdb_checksum_error(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+/** Stream that buffers serialized data and writes it to a file in checksummed chunks */
+class CFlatDBChunkWriter
+{
+private:
+    CAutoFile& fileout;
+    std::vector<unsigned char> vchChunk;
+
+    void FlushChunk()
+    {
+        if (vchChunk.empty())
+            return;
+        fileout << (uint32_t)vchChunk.size();
+        fileout.write((const char*)vchChunk.data(), vchChunk.size());
+        fileout << Hash(vchChunk);
+        vchChunk.clear();
+    }
+
+public:
+    explicit CFlatDBChunkWriter(CAutoFile& fileoutIn) : fileout(fileoutIn)
+    {
+        vchChunk.reserve(FLATDB_CHUNK_SIZE);
+    }
+
+    int GetType() const          { return fileout.GetType(); }
+    int GetVersion() const       { return fileout.GetVersion(); }
+
+    void write(const char* pch, size_t nSize)
+    {
+        while (nSize > 0) {
+            size_t nNow = std::min<size_t>(nSize, FLATDB_CHUNK_SIZE - vchChunk.size());
+            vchChunk.insert(vchChunk.end(), (const unsigned char*)pch, (const unsigned char*)pch + nNow);
+            pch += nNow;
+            nSize -= nNow;
+            if (vchChunk.size() == FLATDB_CHUNK_SIZE)
+                FlushChunk();
+        }
+    }
+
+    //! Write the pending chunk and the terminating empty chunk
+    void Finalize()
+    {
+        FlushChunk();
+        fileout << (uint32_t)0;
+    }
+
+    template<typename T>
+    CFlatDBChunkWriter& operator<<(const T& obj)
+    {
+        ::Serialize(*this, obj);
+        return (*this);
+    }
+};
+
+/** Stream that reads checksummed chunks from a file, verifying each chunk before it is consumed */
+class CFlatDBChunkReader
+{
+private:
+    CAutoFile& filein;
+    std::vector<unsigned char> vchChunk;
+    size_t nReadPos{0};
+    bool fEnd{false};
+
+    //! Read the next chunk, returns false on the terminating empty chunk
+    bool ReadChunk()
+    {
+        if (fEnd)
+            return false;
+
+        uint32_t nSize;
+        filein >> nSize;
+        if (nSize == 0) {
+            fEnd = true;
+            return false;
+        }
+        if (nSize > FLATDB_CHUNK_SIZE)
+            throw std::ios_base::failure("CFlatDBChunkReader::ReadChunk: chunk size too large");
+
+        vchChunk.resize(nSize);
+        filein.read((char*)vchChunk.data(), nSize);
+        uint256 hashIn;
+        filein >> hashIn;
+        if (hashIn != Hash(vchChunk))
+            throw flatdb_checksum_error("CFlatDBChunkReader::ReadChunk: checksum mismatch, data corrupted");
+
+        nReadPos = 0;
+        return true;
+    }
+
+public:
+    explicit CFlatDBChunkReader(CAutoFile& fileinIn) : filein(fileinIn) {}
+
+    int GetType() const          { return filein.GetType(); }
+    int GetVersion() const       { return filein.GetVersion(); }
+
+    void read(char* pch, size_t nSize)
+    {
+        while (nSize > 0) {
+            if (nReadPos == vchChunk.size() && !ReadChunk())
+                throw std::ios_base::failure("CFlatDBChunkReader::read: end of data");
+            size_t nNow = std::min(nSize, vchChunk.size() - nReadPos);
+            memcpy(pch, vchChunk.data() + nReadPos, nNow);
+            nReadPos += nNow;
+            pch += nNow;
+            nSize -= nNow;
+        }
+    }
+
+    void ignore(size_t nSize)
+    {
+        while (nSize > 0) {
+            if (nReadPos == vchChunk.size() && !ReadChunk())
+                throw std::ios_base::failure("CFlatDBChunkReader::ignore: end of data");
+            size_t nNow = std::min(nSize, vchChunk.size() - nReadPos);
+            nReadPos += nNow;
+            nSize -= nNow;
+        }
+    }
+
+    //! Check that all data was consumed and the terminating chunk follows
+    bool IsComplete()
+    {
+        return nReadPos == vchChunk.size() && !ReadChunk();
+    }
+
+    template<typename T>
+    CFlatDBChunkReader& operator>>(T&& obj)
+    {
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+};
+
 template<typename T>
 class CFlatDB
 {
@@ -33,6 +187,7 @@ private:
     };
 
     fs::path pathDB;
+    fs::path pathLegacyDB;
     std::string strFilename;
     std::string strMagicMessage;
 
@@ -42,51 +197,128 @@ private:
 
         int64_t nStart = GetTimeMillis();
 
-        // serialize, checksum data up to that point, then append checksum
-        CDataStream ssObj(SER_DISK, CLIENT_VERSION);
-        ssObj << strMagicMessage; // specific magic message for this type of object
-        ssObj << Params().MessageStart(); // network specific magic number
-        ssObj << objToSave;
-        uint256 hash = Hash(ssObj);
-        ssObj << hash;
+        // write to a temporary file first so a crash never leaves a truncated cache behind
+        fs::path pathTmp = pathDB;
+        pathTmp += ".new";
 
         // open output file, and associate with CAutoFile
-        FILE *file = fopen(fs::PathToString(pathDB).c_str(), "wb");
+        FILE *file = fsbridge::fopen(pathTmp, "wb");
         CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
         if (fileout.IsNull())
-            return error("%s: Failed to open file %s", __func__, fs::PathToString(pathDB));
+            return error("%s: Failed to open file %s", __func__, fs::PathToString(pathTmp));
 
-        // Write and commit header, data
+        // Write header, then stream the data in checksummed chunks
         try {
-            fileout << ssObj;
+            fileout.write((const char*)FLATDB_SIGNATURE, sizeof(FLATDB_SIGNATURE));
+            fileout << FLATDB_FORMAT_VERSION;
+
+            CFlatDBChunkWriter writer(fileout);
+            writer << strMagicMessage; // specific magic message for this type of object
+            writer << Params().MessageStart(); // network specific magic number
+            writer << objToSave;
+            writer.Finalize();
         }
         catch (std::exception &e) {
+            fileout.fclose();
+            fs::remove(pathTmp);
             return error("%s: Serialize or I/O error - %s", __func__, e.what());
         }
+        if (!FileCommit(fileout.Get())) {
+            fileout.fclose();
+            fs::remove(pathTmp);
+            return error("%s: Failed to commit file %s", __func__, fs::PathToString(pathTmp));
+        }
         fileout.fclose();
 
+        if (!RenameOver(pathTmp, pathDB)) {
+            fs::remove(pathTmp);
+            return error("%s: Rename-into-place failed for %s", __func__, strFilename);
+        }
+
         LogPrintf("Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
         LogPrintf("     %s\n", objToSave.ToString());
 
         return true;
     }
 
-    ReadResult Read(T& objToLoad, bool fDryRun = false)
+    template<typename Stream>
+    ReadResult ReadHeader(Stream& s)
     {
-        //LOCK(objToLoad.cs);
+        unsigned char pchMsgTmp[4];
+        std::string strMagicMessageTmp;
 
-        int64_t nStart = GetTimeMillis();
-        // open input file, and associate with CAutoFile
-        FILE *file = fopen(fs::PathToString(pathDB).c_str(), "rb");
-        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
-        if (filein.IsNull())
+        // de-serialize file header (file specific magic message) and ..
+        s >> strMagicMessageTmp;
+
+        // ... verify the message matches predefined one
+        if (strMagicMessage != strMagicMessageTmp)
         {
-            error("%s: Failed to open file %s", __func__, fs::PathToString(pathDB));
-            return FileError;
+            error("%s: Invalid magic message", __func__);
+            return IncorrectMagicMessage;
+        }
+
+        // de-serialize file header (network specific magic number) and ..
+        s >> pchMsgTmp;
+
+        // ... verify the network matches ours
+        if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
+        {
+            error("%s: Invalid network magic number", __func__);
+            return IncorrectMagicNumber;
+        }
+
+        return Ok;
+    }
+
+    ReadResult ReadChunked(CAutoFile& filein, T& objToLoad, bool fHeaderOnly)
+    {
+        try {
+            uint32_t nFormatVersion;
+            filein >> nFormatVersion;
+            if (nFormatVersion != FLATDB_FORMAT_VERSION)
+            {
+                error("%s: Unsupported format version %u", __func__, nFormatVersion);
+                return IncorrectFormat;
+            }
+
+            CFlatDBChunkReader reader(filein);
+            ReadResult result = ReadHeader(reader);
+            if (result != Ok || fHeaderOnly)
+                return result;
+
+            // de-serialize data into T object
+            reader >> objToLoad;
+            if (!reader.IsComplete())
+                throw std::ios_base::failure("unexpected data after object");
+        }
+        catch (const flatdb_checksum_error& e) {
+            objToLoad.Clear();
+            error("%s: %s", __func__, e.what());
+            return IncorrectHash;
+        }
+        catch (std::exception &e) {
+            objToLoad.Clear();
+            error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            return IncorrectFormat;
+        }
+
+        return Ok;
+    }
+
+    ReadResult ReadLegacy(CAutoFile& filein, const fs::path& pathRead, T& objToLoad, bool fHeaderOnly)
+    {
+        if (fHeaderOnly) {
+            try {
+                return ReadHeader(filein);
+            }
+            catch (std::exception &e) {
+                error("%s: Deserialize or I/O error - %s", __func__, e.what());
+                return IncorrectFormat;
+            }
         }
 
         // use file size to size memory buffer
-        int fileSize = fs::file_size(pathDB);
+        int fileSize = fs::file_size(pathRead);
         int dataSize = fileSize - sizeof(uint256);
         // Don't try to resize to a negative number if file is small
         if (dataSize < 0)
@@ -104,7 +336,6 @@ private:
             error("%s: Deserialize or I/O error - %s", __func__, e.what());
             return HashReadError;
         }
-        filein.fclose();
 
         CDataStream ssObj(vchData, SER_DISK, CLIENT_VERSION);
 
@@ -116,30 +347,10 @@ private:
             return IncorrectHash;
         }
 
-
-        unsigned char pchMsgTmp[4];
-        std::string strMagicMessageTmp;
         try {
-            // de-serialize file header (file specific magic message) and ..
-            ssObj >> strMagicMessageTmp;
-
-            // ... verify the message matches predefined one
-            if (strMagicMessage != strMagicMessageTmp)
-            {
-                error("%s: Invalid magic message", __func__);
-                return IncorrectMagicMessage;
-            }
-
-
-            // de-serialize file header (network specific magic number) and ..
-            ssObj >> pchMsgTmp;
-
-            // ... verify the network matches ours
-            if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
-            {
-                error("%s: Invalid network magic number", __func__);
-                return IncorrectMagicNumber;
-            }
+            ReadResult result = ReadHeader(ssObj);
+            if (result != Ok)
+                return result;
 
             // de-serialize data into T object
             ssObj >> objToLoad;
@@ -150,27 +361,70 @@ private:
             return IncorrectFormat;
         }
 
-        LogPrintf("Loaded info from %s  %dms\n", strFilename, GetTimeMillis() - nStart);
-        LogPrintf("     %s\n", objToLoad.ToString());
-        if(!fDryRun) {
-            LogPrintf("%s: Cleaning....\n", __func__);
-            objToLoad.CheckAndRemove();
-            LogPrintf("     %s\n", objToLoad.ToString());
+        return Ok;
+    }
+
+    ReadResult Read(T& objToLoad, bool fHeaderOnly = false)
+    {
+        //LOCK(objToLoad.cs);
+
+        int64_t nStart = GetTimeMillis();
+        // fall back to the file of an older version, the header check before a dump only looks at our own file
+        fs::path pathRead = pathDB;
+        if (!fHeaderOnly && !pathLegacyDB.empty() && !fs::exists(pathDB) && fs::exists(pathLegacyDB))
+            pathRead = pathLegacyDB;
+
+        // open input file, and associate with CAutoFile
+        FILE *file = fsbridge::fopen(pathRead, "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+        {
+            error("%s: Failed to open file %s", __func__, fs::PathToString(pathRead));
+            return FileError;
         }
 
+        ReadResult result;
+        unsigned char pchSignature[sizeof(FLATDB_SIGNATURE)];
+        if (fread(pchSignature, 1, sizeof(pchSignature), filein.Get()) == sizeof(pchSignature) &&
+            memcmp(pchSignature, FLATDB_SIGNATURE, sizeof(pchSignature)) == 0) {
+            result = ReadChunked(filein, objToLoad, fHeaderOnly);
+        } else {
+            // no signature, the file predates the chunked format
+            if (fseek(filein.Get(), 0, SEEK_SET)) {
+                error("%s: Failed to seek file %s", __func__, fs::PathToString(pathRead));
+                return FileError;
+            }
+            result = ReadLegacy(filein, pathRead, objToLoad, fHeaderOnly);
+        }
+        filein.fclose();
+
+        if (result != Ok || fHeaderOnly)
+            return result;
+
+        LogPrintf("Loaded info from %s  %dms\n", fs::PathToString(pathRead.filename()), GetTimeMillis() - nStart);
+        LogPrintf("     %s\n", objToLoad.ToString());
+
         return Ok;
     }
 
 
 public:
-    CFlatDB(fs::path strFilenameIn, std::string strMagicMessageIn)
+    /** strLegacyFilenameIn names the file older versions wrote, it is read while strFilenameIn does not exist yet */
+    CFlatDB(fs::path strFilenameIn, std::string strMagicMessageIn, fs::path strLegacyFilenameIn = fs::path())
     {
         pathDB = GetDataDir() / strFilenameIn;
+        if (!strLegacyFilenameIn.empty())
+            pathLegacyDB = GetDataDir() / strLegacyFilenameIn;
         strFilename = fs::PathToString(strFilenameIn);
         strMagicMessage = strMagicMessageIn;
     }
 
-    bool Load(T& objToLoad)
+    /**
+     * Load the object from disk. A missing, truncated or corrupted file leaves the object
+     * empty so it is recreated from the network, only a file of another type or network is fatal.
+     * With fClean set to false the caller is responsible for calling Clean() afterwards.
+     */
+    bool Load(T& objToLoad, bool fClean = true)
     {
         LogPrintf("Reading info from %s...\n", strFilename);
         ReadResult readResult = Read(objToLoad);
@@ -179,9 +433,10 @@ public:
         else if (readResult != Ok)
         {
             LogPrintf("Error reading %s: ", strFilename);
-            if(readResult == IncorrectFormat)
+            if(readResult == IncorrectFormat || readResult == IncorrectHash || readResult == HashReadError)
             {
-                LogPrintf("%s: Magic is ok but data has invalid format, will try to recreate\n", __func__);
+                LogPrintf("%s: Magic is ok but data is corrupted or has invalid format, will try to recreate\n", __func__);
+                objToLoad.Clear();
             }
             else {
                 LogPrintf("%s: File format is unknown or invalid, please fix it manually\n", __func__);
@@ -189,9 +444,18 @@ public:
                 return false;
             }
         }
+        else if (fClean)
+            Clean(objToLoad);
         return true;
     }
 
+    void Clean(T& objToLoad)
+    {
+        LogPrintf("%s: Cleaning %s....\n", __func__, strFilename);
+        objToLoad.CheckAndRemove();
+        LogPrintf("     %s\n", objToLoad.ToString());
+    }
+
     bool Dump(T& objToSave)
     {
         int64_t nStart = GetTimeMillis();
@@ -200,13 +464,13 @@ public:
         T tmpObjToLoad;
         ReadResult readResult = Read(tmpObjToLoad, true);
 
-        // there was an error and it was not an error on file opening => do not proceed
+        // only refuse to overwrite a file that belongs to another object type or network
         if (readResult == FileError)
             LogPrintf("Missing file %s, will try to recreate\n", strFilename);
         else if (readResult != Ok)
         {
             LogPrintf("Error reading %s: ", strFilename);
-            if(readResult == IncorrectFormat)
+            if(readResult == IncorrectFormat || readResult == IncorrectHash || readResult == HashReadError)
                 LogPrintf("%s: Magic is ok but data has invalid format, will try to recreate\n", __func__);
             else
             {
@@ -216,7 +480,8 @@ public:
         }
 
         LogPrintf("Writing info to %s...\n", strFilename);
-        Write(objToSave);
+        if (!Write(objToSave))
+            return false;
         LogPrintf("%s dump finished  %dms\n", strFilename, GetTimeMillis() - nStart);
 
         return true;
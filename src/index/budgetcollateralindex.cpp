@@ -0,0 +1,76 @@
+// Copyright (c) 2014-2020 The Crown developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <index/budgetcollateralindex.h>
+#include <masternode/masternode-budget.h>
+#include <util/system.h>
+
+constexpr char DB_BUDGET_COLLATERAL = 'c';
+
+std::unique_ptr<BudgetCollateralIndex> g_budget_collateral_index;
+
+/** Access to the budget collateral index database (indexes/budgetcollateral/) */
+class BudgetCollateralIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Read the budget fee transaction with the given hash. Returns false if it is not indexed.
+    bool ReadCollateral(const uint256& txid, CBudgetCollateral& collateral) const;
+
+    /// Write a batch of budget fee transactions to the DB.
+    bool WriteCollaterals(const std::vector<std::pair<uint256, CBudgetCollateral>>& collaterals);
+};
+
+BudgetCollateralIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "budgetcollateral", n_cache_size, f_memory, f_wipe)
+{}
+
+bool BudgetCollateralIndex::DB::ReadCollateral(const uint256& txid, CBudgetCollateral& collateral) const
+{
+    return Read(std::make_pair(DB_BUDGET_COLLATERAL, txid), collateral);
+}
+
+bool BudgetCollateralIndex::DB::WriteCollaterals(const std::vector<std::pair<uint256, CBudgetCollateral>>& collaterals)
+{
+    CDBBatch batch(*this);
+    for (const auto& entry : collaterals) {
+        batch.Write(std::make_pair(DB_BUDGET_COLLATERAL, entry.first), entry.second);
+    }
+    return WriteBatch(batch);
+}
+
+BudgetCollateralIndex::BudgetCollateralIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(std::make_unique<BudgetCollateralIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+BudgetCollateralIndex::~BudgetCollateralIndex() {}
+
+bool BudgetCollateralIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    std::vector<std::pair<uint256, CBudgetCollateral>> collaterals;
+    for (const auto& tx : block.vtx) {
+        CBudgetCollateral collateral;
+        if (!GetBudgetFeeOutput(*tx, collateral.nAmount, collateral.vchPayload, collateral.fStandardOutputs))
+            continue;
+
+        collateral.blockHash = pindex->GetBlockHash();
+        collateral.nHeight = pindex->nHeight;
+        collaterals.emplace_back(tx->GetHash(), collateral);
+    }
+
+    if (collaterals.empty())
+        return true;
+    // entries of a block disconnected by a reorg are kept; they are overwritten when the
+    // transaction is mined again and callers check that the block is still in the active chain
+    return m_db->WriteCollaterals(collaterals);
+}
+
+BaseIndex::DB& BudgetCollateralIndex::GetDB() const { return *m_db; }
+
+bool BudgetCollateralIndex::FindCollateral(const uint256& tx_hash, CBudgetCollateral& collateral) const
+{
+    return m_db->ReadCollateral(tx_hash, collateral);
+}
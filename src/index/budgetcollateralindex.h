@@ -0,0 +1,69 @@
+// Copyright (c) 2014-2020 The Crown developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CROWN_INDEX_BUDGETCOLLATERALINDEX_H
+#define CROWN_INDEX_BUDGETCOLLATERALINDEX_H
+
+#include <amount.h>
+#include <index/base.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <vector>
+
+static const bool DEFAULT_BUDGETCOLLATERALINDEX = true;
+
+/** A budget fee transaction of the chain, as recorded by BudgetCollateralIndex. */
+struct CBudgetCollateral
+{
+    uint256 blockHash;
+    int nHeight{0};
+    //! value of the OP_RETURN output paying the fee
+    CAmount nAmount{0};
+    //! data pushed after the OP_RETURN of that output
+    std::vector<unsigned char> vchPayload;
+    //! whether every output of the transaction is a normal payment or unspendable script
+    bool fStandardOutputs{false};
+
+    SERIALIZE_METHODS(CBudgetCollateral, obj)
+    {
+        READWRITE(obj.blockHash, obj.nHeight, obj.nAmount, obj.vchPayload, obj.fStandardOutputs);
+    }
+};
+
+/**
+ * BudgetCollateralIndex records the budget fee transactions included in the blockchain, those
+ * with an OP_RETURN output worth at least BUDGET_FEE_TX, by transaction hash. It lets proposal
+ * and budget draft collaterals be checked with one lookup, with or without -txindex.
+ */
+class BudgetCollateralIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "budgetcollateralindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit BudgetCollateralIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~BudgetCollateralIndex() override;
+
+    /// Look up a budget fee transaction by hash. Returns false if the transaction is not indexed.
+    bool FindCollateral(const uint256& tx_hash, CBudgetCollateral& collateral) const;
+};
+
+/// The global budget collateral index, used in IsBudgetCollateralValid. May be null.
+extern std::unique_ptr<BudgetCollateralIndex> g_budget_collateral_index;
+
+#endif // CROWN_INDEX_BUDGETCOLLATERALINDEX_H
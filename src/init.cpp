@@ -15,6 +15,9 @@
 #include <banman.h>
 #include <blockfilter.h>
 #include <crown/cache.h>
+#include <crown/collateralwatcher.h>
+#include <crown/legacysigcache.h>
+#include <crown/legacysigner.h>
 #include <crown/nodewallet.h>
 #include <chain.h>
 #include <chainparams.h>
@@ -27,6 +30,7 @@
 #include <httprpc.h>
 #include <httpserver.h>
 #include <index/blockfilterindex.h>
+#include <index/budgetcollateralindex.h>
 #include <index/txindex.h>
 #include <interfaces/chain.h>
 #include <interfaces/node.h>
@@ -78,9 +82,11 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <platform/platform-db.h>
+#include <platform/nf-token/nf-tokens-manager.h>
 #include <crown/init.h>
 #include <crown/nodesync.h>
 #include <masternode/masternode-sync.h>
+#include <pos/paymentindex.h>
 
 #ifndef WIN32
 #include <attributes.h>
@@ -185,6 +191,9 @@ void Interrupt(NodeContext& node)
     if (g_txindex) {
         g_txindex->Interrupt();
     }
+    if (g_budget_collateral_index) {
+        g_budget_collateral_index->Interrupt();
+    }
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Interrupt(); });
 }
 
@@ -239,6 +248,7 @@ void Shutdown(NodeContext& node)
     if (node.scheduler) node.scheduler->stop();
     if (g_load_block.joinable()) g_load_block.join();
     StopScriptCheckWorkerThreads();
+    StopLegacySigCheckWorkerThreads();
 
     // After the threads that potentially access these pointers have been stopped,
     // destruct and reset all to nullptr.
@@ -283,6 +293,10 @@ void Shutdown(NodeContext& node)
         g_txindex->Stop();
         g_txindex.reset();
     }
+    if (g_budget_collateral_index) {
+        g_budget_collateral_index->Stop();
+        g_budget_collateral_index.reset();
+    }
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Stop(); });
     DestroyAllBlockFilterIndexes();
 
@@ -391,15 +405,9 @@ static void OnRPCStopped()
 }
 
 void checkAndAddDefaultAsset(){
-	bool exists = false, dummy = false;
 	CAsset asset = Params().GetConsensus().subsidy_asset;
-	for(auto const& x : passetsCache->GetItemsMap()){
-		CAsset checkasset = x.second->second.asset;
-		if(iequals(asset.getAssetName(), checkasset.getAssetName()) || iequals(asset.getAssetName(), checkasset.getShortName()))
-			exists = true;
-		if(iequals("", checkasset.getAssetName()) || iequals("", checkasset.getShortName()))
-		    dummy = true;
-	}
+	bool exists = passetsCache->FindByNameOrShortName(asset.getAssetName()) != nullptr;
+	bool dummy = passetsCache->FindByNameOrShortName("") != nullptr;
 	if (!exists && !passetsCache->Exists(asset.getAssetName())){
 		passetsCache->Put(asset.getAssetName(), CAssetData(asset, Params().GenesisBlock().vtx[0], 0, Params().GenesisBlock().nTime));
 	}
@@ -460,6 +468,8 @@ void SetupServerArgs(NodeContext& node)
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", CROWN_PID_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-platformnftcache=<n>", strprintf("Memory budget of the NFT index with -platformopttiered in MiB (default: %u)", Platform::NfTokensManager::DEFAULT_INDEX_MEMORY_BUDGET), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-platformopttiered", "Keep only the recently used NFTs in memory and read the others from the platform database (default: 0)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-prune=<n>", strprintf("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >=%u = automatically prune block files to stay under the specified target size in MiB)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -475,6 +485,7 @@ void SetupServerArgs(NodeContext& node)
     hidden_args.emplace_back("-sysperms");
 #endif
     argsman.AddArg("-txindex", strprintf("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)", DEFAULT_TXINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-budgetcollateralindex", strprintf("Maintain an index of budget fee transactions, used to check proposal and budget collaterals (default: %u)", DEFAULT_BUDGETCOLLATERALINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-blockfilterindex=<type>",
                  strprintf("Maintain an index of compact filters by block (default: %s, values: %s).", DEFAULT_BLOCKFILTERINDEX, ListBlockFilterTypes()) +
                  " If <type> is not supplied or if <type> = 1, indexes for all known types are enabled.",
@@ -588,6 +599,7 @@ void SetupServerArgs(NodeContext& node)
     argsman.AddArg("-logtimemicros", strprintf("Add microsecond precision to debug timestamps (default: %u)", DEFAULT_LOGTIMEMICROS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-mocktime=<n>", "Replace actual time with " + UNIX_EPOCH_TIME + " (default: 0)", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-maxsigcachesize=<n>", strprintf("Limit sum of signature cache and script execution cache sizes to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    argsman.AddArg("-maxlegacysigcachesize=<n>", strprintf("Limit the cache of masternode, systemnode, budget, spork and instantsend message signatures to <n> MiB (default: %u)", DEFAULT_MAX_LEGACY_SIG_CACHE_SIZE), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-printpriority", strprintf("Log transaction fee per kB when mining blocks (default: %u)", DEFAULT_PRINTPRIORITY), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-printtoconsole", "Send trace/debug info to console (default: 1 when no -daemon. To disable logging to file, set -nodebuglogfile)", ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
@@ -633,6 +645,7 @@ void SetupServerArgs(NodeContext& node)
     argsman.AddArg("-systemnode", "Run as systemnode", false, OptionsCategory::RPC);
     argsman.AddArg("-systemnodeprivkey", "Systemnode private key", false, OptionsCategory::RPC);
     argsman.AddArg("-systemnodeaddr", strprintf(_("Set external address:port to get to this systemnode (example: %s)").translated, "1.2.3.4:12345"), false, OptionsCategory::RPC);
+    argsman.AddArg("-cachesnapshotinterval=<n>", strprintf("Write the masternode, systemnode and budget caches to disk every <n> seconds, 0 to only write them at shutdown (default: %u)", DEFAULT_CACHE_SNAPSHOT_INTERVAL), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     argsman.AddArg("-sporkkey", strprintf(_("Set spork key  (example: %s)").translated, "xxxxxxxxxxxxxxxxxxxxxx"), false, OptionsCategory::RPC);
 
 #if HAVE_DECL_DAEMON
@@ -1384,6 +1397,7 @@ bool AppInitMain(const util::Ref& context, NodeContext& node, interfaces::BlockA
     }
 
     InitSignatureCache();
+    InitLegacySignatureCache();
     InitScriptExecutionCache();
 
     int script_threads = args.GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
@@ -1403,6 +1417,7 @@ bool AppInitMain(const util::Ref& context, NodeContext& node, interfaces::BlockA
     if (script_threads >= 1) {
         g_parallel_script_checks = true;
         StartScriptCheckWorkerThreads(script_threads);
+        StartLegacySigCheckWorkerThreads(script_threads);
     }
 
     assert(!node.scheduler);
@@ -1616,6 +1631,11 @@ bool AppInitMain(const util::Ref& context, NodeContext& node, interfaces::BlockA
 
     bool platformOptRam = args.GetBoolArg("-platformoptram", false);
     Platform::PlatformOpt opt = platformOptRam ? Platform::PlatformOpt::OptRam : Platform::PlatformOpt::OptSpeed;
+    if (args.GetBoolArg("-platformopttiered", false)) {
+        opt = Platform::PlatformOpt::OptTiered;
+        int64_t nNftCache = std::max<int64_t>(args.GetArg("-platformnftcache", Platform::NfTokensManager::DEFAULT_INDEX_MEMORY_BUDGET), 0);
+        Platform::NfTokensManager::SetIndexMemoryBudget(nNftCache << 20);
+    }
 
     // cache size calculations
     int64_t nTotalCache = (args.GetArg("-dbcache", nDefaultDbCache) << 20);
@@ -1636,6 +1656,8 @@ bool AppInitMain(const util::Ref& context, NodeContext& node, interfaces::BlockA
     nTotalCache -= nBlockTreeDBCache;
     int64_t nTxIndexCache = std::min(nTotalCache / 8, args.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxTxIndexCache << 20 : 0);
     nTotalCache -= nTxIndexCache;
+    int64_t budget_collateral_index_cache = std::min(nTotalCache / 8, args.GetBoolArg("-budgetcollateralindex", DEFAULT_BUDGETCOLLATERALINDEX) ? max_budget_collateral_index_cache << 20 : 0);
+    nTotalCache -= budget_collateral_index_cache;
     int64_t filter_index_cache = 0;
     if (!g_enabled_filter_types.empty()) {
         size_t n_indexes = g_enabled_filter_types.size();
@@ -1654,6 +1676,9 @@ bool AppInitMain(const util::Ref& context, NodeContext& node, interfaces::BlockA
     if (args.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
         LogPrintf("* Using %.1f MiB for transaction index database\n", nTxIndexCache * (1.0 / 1024 / 1024));
     }
+    if (args.GetBoolArg("-budgetcollateralindex", DEFAULT_BUDGETCOLLATERALINDEX)) {
+        LogPrintf("* Using %.1f MiB for budget collateral index database\n", budget_collateral_index_cache * (1.0 / 1024 / 1024));
+    }
     for (BlockFilterType filter_type : g_enabled_filter_types) {
         LogPrintf("* Using %.1f MiB for %s block filter index database\n",
                   filter_index_cache * (1.0 / 1024 / 1024), BlockFilterTypeName(filter_type));
@@ -1692,7 +1717,7 @@ bool AppInitMain(const util::Ref& context, NodeContext& node, interfaces::BlockA
                 passetsdb.reset();
                 passetsdb.reset(new CAssetsDB(nBlockTreeDBCache, false, fReset));
                 delete passetsCache;
-                passetsCache = new CLRUCache<std::string, CAssetData>(2500);
+                passetsCache = new CAssetsCache(2500);
 
                 // Read for fAssetIndex to make sure that we only load asset address balances if it if true
                 //pblocktree->ReadFlag("assetindex", fAssetIndex);
@@ -1953,6 +1978,11 @@ bool AppInitMain(const util::Ref& context, NodeContext& node, interfaces::BlockA
         g_txindex->Start();
     }
 
+    if (args.GetBoolArg("-budgetcollateralindex", DEFAULT_BUDGETCOLLATERALINDEX)) {
+        g_budget_collateral_index = std::make_unique<BudgetCollateralIndex>(budget_collateral_index_cache, false, fReindex);
+        g_budget_collateral_index->Start();
+    }
+
     for (const auto& filter_type : g_enabled_filter_types) {
         InitBlockFilterIndex(filter_type, filter_index_cache, false, fReindex);
         GetBlockFilterIndex(filter_type)->Start();
@@ -1993,6 +2023,13 @@ bool AppInitMain(const util::Ref& context, NodeContext& node, interfaces::BlockA
         InitError(strprintf(_("Error: Failed to correctly read caches")));
         return false;
     }
+    RegisterValidationInterface(&collateralWatcher);
+
+    // keep the caches on disk reasonably fresh so a crash does not force a full resync
+    int64_t nCacheSnapshotInterval = args.GetArg("-cachesnapshotinterval", DEFAULT_CACHE_SNAPSHOT_INTERVAL);
+    if (nCacheSnapshotInterval > 0) {
+        node.scheduler->scheduleEvery(SnapshotCaches, std::chrono::seconds{nCacheSnapshotInterval});
+    }
 
     // ********************************************************* Step 11: import blocks
 
@@ -2061,6 +2098,16 @@ bool AppInitMain(const util::Ref& context, NodeContext& node, interfaces::BlockA
         return false;
     }
 
+    // Only staking nodes query recent payments, everyone else just follows new blocks
+    if (fMasterNode || fSystemNode) {
+        LOCK(cs_main);
+        if (!g_paymentIndex.Rebuild(chainman.ActiveChain())) {
+            return InitError(_("Failed to build the node payment index"));
+        }
+        // keep the stake pointer candidates of the active node current
+        RegisterValidationInterface(&currentNode);
+    }
+
     {
         LOCK(cs_main);
         LogPrintf("block tree size = %u\n", chainman.BlockIndex().size());
@@ -198,8 +198,7 @@ private:
             return key < b2->key;
         }
         virtual void Erase(CLevelDBBatch &batch) {
-            // TODO fix
-            //batch.Erase(key);
+            batch.Erase(key);
         }
         K key;
     };
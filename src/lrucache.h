@@ -105,12 +105,12 @@ public:
         maxSize = size;
     }
 
-   const std::unordered_map<cache_key_t, list_iterator_t>& GetItemsMap()
+    const std::unordered_map<cache_key_t, list_iterator_t>& GetItemsMap() const
     {
         return cacheItemsMap;
     };
 
-    const std::list<key_value_pair_t>& GetItemsList()
+    const std::list<key_value_pair_t>& GetItemsList() const
     {
         return cacheItemsList;
     };
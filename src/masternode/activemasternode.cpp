@@ -216,6 +216,7 @@ bool CActiveMasternode::SendMasternodePing(std::string& errorMessage, CConnman&
         }
 
         pmn->lastPing = mnp;
+        mnodeman.NotifyMasternodePing();
         mnodeman.mapSeenMasternodePing.insert(std::make_pair(mnp.GetHash(), mnp));
 
         //mnodeman.mapSeenMasternodeBroadcast.lastPing is probably outdated, so we'll update it
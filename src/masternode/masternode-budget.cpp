@@ -15,6 +15,7 @@
 #include <crown/legacysigner.h>
 #include <crown/nodewallet.h>
 #include <fstream>
+#include <index/budgetcollateralindex.h>
 #include <index/txindex.h>
 #include <key_io.h>
 #include <masternode/masternode-budget.h>
@@ -109,41 +110,71 @@ int GetNextSuperblock(int height)
     return height - height % GetBudgetPaymentCycleBlocks() + GetBudgetPaymentCycleBlocks();
 }
 
-bool IsBudgetCollateralValid(uint256 nTxCollateralHash, uint256 nExpectedHash, std::string& strError, int64_t& nTime, int& nConf)
+bool GetBudgetFeeOutput(const CTransaction& tx, CAmount& nAmount, std::vector<unsigned char>& vchPayload, bool& fStandardOutputs)
 {
-    uint256 nBlockHash;
-    CBlockIndex* blockindex = nullptr;
+    bool foundOpReturn = false;
+    fStandardOutputs = true;
+    for (unsigned int k = 0; k < (tx.nVersion >= TX_ELE_VERSION ? tx.vpout.size() : tx.vout.size()); k++) {
+        const CTxOut& o = (tx.nVersion >= TX_ELE_VERSION ? tx.vpout[k] : tx.vout[k]);
+        if (!o.scriptPubKey.IsNormalPaymentScript() && !o.scriptPubKey.IsUnspendable())
+            fStandardOutputs = false;
 
-    CTransactionRef txCollateral = GetTransaction(blockindex, nullptr, nTxCollateralHash, Params().GetConsensus(), nBlockHash);
+        if (foundOpReturn || o.scriptPubKey.empty() || o.scriptPubKey[0] != OP_RETURN || o.nValue < BUDGET_FEE_TX)
+            continue;
 
-    if(!txCollateral){
-        strError = strprintf("Can't find collateral tx %s", nTxCollateralHash.ToString());
-        LogPrintf ("CBudgetProposalBroadcast::IsBudgetCollateralValid - %s\n", strError);
-        return false;
+        foundOpReturn = true;
+        nAmount = o.nValue;
+        vchPayload.clear();
+        opcodetype opcode;
+        CScript::const_iterator pc = o.scriptPubKey.begin() + 1;
+        o.scriptPubKey.GetOp(pc, opcode, vchPayload);
     }
+    return foundOpReturn;
+}
 
-    CScript findScript;
-    findScript << OP_RETURN << ToByteVector(nExpectedHash);
-
+bool IsBudgetCollateralValid(uint256 nTxCollateralHash, uint256 nExpectedHash, std::string& strError, int64_t& nTime, int& nConf)
+{
+    uint256 nBlockHash;
+    CAmount nAmount = 0;
+    std::vector<unsigned char> vchPayload;
+    bool fStandardOutputs = false;
     bool foundOpReturn = false;
-    for (unsigned int k = 0; k <  (txCollateral->nVersion >= TX_ELE_VERSION ? txCollateral->vpout.size() : txCollateral->vout.size()) ; k++){
-        CTxOutAsset o = (txCollateral->nVersion >= TX_ELE_VERSION ? txCollateral->vpout[k] : txCollateral->vout[k]);
-        if(!o.scriptPubKey.IsNormalPaymentScript() && !o.scriptPubKey.IsUnspendable()){
-            strError = strprintf("Invalid Script %s", txCollateral->ToString());
+
+    CBudgetCollateral collateral;
+    if (g_budget_collateral_index && g_budget_collateral_index->FindCollateral(nTxCollateralHash, collateral)) {
+        nBlockHash = collateral.blockHash;
+        nAmount = collateral.nAmount;
+        vchPayload = collateral.vchPayload;
+        fStandardOutputs = collateral.fStandardOutputs;
+        foundOpReturn = true;
+    } else {
+        // not mined yet, mined before the index caught up, or not a budget fee transaction
+        CBlockIndex* blockindex = nullptr;
+        CTransactionRef txCollateral = GetTransaction(blockindex, nullptr, nTxCollateralHash, Params().GetConsensus(), nBlockHash);
+        if (!txCollateral) {
+            strError = strprintf("Can't find collateral tx %s", nTxCollateralHash.ToString());
             LogPrint(BCLog::MASTERNODE, "CBudgetProposalBroadcast::IsBudgetCollateralValid - %s\n", strError);
             return false;
         }
+        foundOpReturn = GetBudgetFeeOutput(*txCollateral, nAmount, vchPayload, fStandardOutputs);
+    }
 
-        if(o.scriptPubKey[0] == OP_RETURN && o.nValue >= BUDGET_FEE_TX) foundOpReturn = true;
-
-        LogPrintf ("%s : %s vs %s\n", __func__, o.scriptPubKey.ToString(), findScript.ToString());
+    if (!fStandardOutputs) {
+        strError = strprintf("Invalid Script in collateral tx %s", nTxCollateralHash.ToString());
+        LogPrint(BCLog::MASTERNODE, "CBudgetProposalBroadcast::IsBudgetCollateralValid - %s\n", strError);
+        return false;
     }
+
     if (!foundOpReturn) {
-        strError = strprintf("Couldn't find opReturn %s in %s", nExpectedHash.ToString(), txCollateral->ToString());
+        strError = strprintf("Couldn't find opReturn %s in %s", nExpectedHash.ToString(), nTxCollateralHash.ToString());
         LogPrint(BCLog::MASTERNODE, "CBudgetProposalBroadcast::IsBudgetCollateralValid - %s\n", strError);
         return false;
     }
 
+    if (vchPayload != ToByteVector(nExpectedHash))
+        LogPrint(BCLog::MASTERNODE, "CBudgetProposalBroadcast::IsBudgetCollateralValid - collateral %s pays %d to opReturn %s, expected %s\n",
+            nTxCollateralHash.ToString(), nAmount, HexStr(vchPayload), nExpectedHash.ToString());
+
     // RETRIEVE CONFIRMATIONS AND NTIME
     /*
         - nTime starts as zero and is passed-by-reference out of this function and stored in the external proposal
@@ -375,6 +406,7 @@ bool CBudgetManager::AddProposal(const CBudgetProposal& budgetProposal, bool che
     }
 
     mapProposals.insert(std::make_pair(budgetProposal.GetHash(), budgetProposal));
+    mapProposalsByName.insert(std::make_pair(budgetProposal.strProposalName, budgetProposal.GetHash()));
     mapSeenMasternodeBudgetProposals.insert(std::make_pair(budgetProposal.GetHash(), budgetProposal));
     return true;
 }
@@ -490,26 +522,62 @@ CBudgetProposal* CBudgetManager::FindProposal(const std::string& strProposalName
 {
     LOCK(m_cs);
 
-    //find the prop with the highest yes count
+    //find the prop with the highest yes count, the lowest hash wins a tie
 
-    int nYesCount = -99999;
     CBudgetProposal* pbudgetProposal = nullptr;
 
-    std::map<uint256, CBudgetProposal>::iterator it = mapProposals.begin();
-    while (it != mapProposals.end()) {
-        if ((*it).second.strProposalName == strProposalName && (*it).second.GetYeas() > nYesCount) {
-            pbudgetProposal = &((*it).second);
-            nYesCount = pbudgetProposal->GetYeas();
+    auto range = mapProposalsByName.equal_range(strProposalName);
+    for (auto it = range.first; it != range.second; ++it) {
+        std::map<uint256, CBudgetProposal>::iterator found = mapProposals.find(it->second);
+        if (found == mapProposals.end())
+            continue;
+
+        CBudgetProposal* candidate = &found->second;
+        if (pbudgetProposal == nullptr || candidate->GetYeas() > pbudgetProposal->GetYeas() ||
+            (candidate->GetYeas() == pbudgetProposal->GetYeas() && found->first < pbudgetProposal->GetHash())) {
+            pbudgetProposal = candidate;
         }
-        ++it;
     }
 
-    if (nYesCount == -99999)
-        return nullptr;
-
     return pbudgetProposal;
 }
 
+void CBudgetManager::UpdateMasternodeVotes()
+{
+    LOCK(m_cs);
+
+    std::set<COutPoint> setChanged;
+    bool fReset = false;
+    mnodeman.TakeMasternodeChanges(setChanged, fReset);
+
+    if (fReset || fMasternodeVotesDirty) {
+        fMasternodeVotesDirty = false;
+        for (auto& proposal : mapProposals)
+            proposal.second.CleanAndRemove(false);
+        for (auto& budgetDraft : mapBudgetDrafts)
+            budgetDraft.second.CleanAndRemove(false);
+        return;
+    }
+
+    // only the votes of these masternodes can have changed their validity
+    for (const COutPoint& outpoint : setChanged) {
+        const bool fValid = mnodeman.Find(CTxIn(outpoint)) != nullptr;
+        for (auto& proposal : mapProposals)
+            proposal.second.SetMasternodeVoteValid(outpoint, fValid);
+        for (auto& budgetDraft : mapBudgetDrafts)
+            budgetDraft.second.SetMasternodeVoteValid(outpoint, fValid);
+    }
+}
+
+void CBudgetManager::RebuildProposalNameIndex()
+{
+    LOCK(m_cs);
+
+    mapProposalsByName.clear();
+    for (const auto& proposal : mapProposals)
+        mapProposalsByName.insert(std::make_pair(proposal.second.strProposalName, proposal.first));
+}
+
 CBudgetProposal* CBudgetManager::FindProposal(uint256 nHash)
 {
     LOCK(m_cs);
@@ -565,10 +633,10 @@ std::vector<CBudgetProposal*> CBudgetManager::GetAllProposals()
 
     std::vector<CBudgetProposal*> vBudgetProposalRet;
 
+    UpdateMasternodeVotes();
+
     std::map<uint256, CBudgetProposal>::iterator it = mapProposals.begin();
     while (it != mapProposals.end()) {
-        (*it).second.CleanAndRemove(false);
-
         CBudgetProposal* pbudgetProposal = &((*it).second);
         vBudgetProposalRet.push_back(pbudgetProposal);
 
@@ -600,9 +668,10 @@ std::vector<CBudgetProposal*> CBudgetManager::GetBudget()
 
     std::vector<std::pair<CBudgetProposal*, int>> vBudgetPorposalsSort;
 
+    UpdateMasternodeVotes();
+
     std::map<uint256, CBudgetProposal>::iterator it = mapProposals.begin();
     while (it != mapProposals.end()) {
-        (*it).second.CleanAndRemove(false);
         vBudgetPorposalsSort.push_back(std::make_pair(&((*it).second), (*it).second.GetYeas() - (*it).second.GetNays()));
         ++it;
     }
@@ -621,13 +690,14 @@ std::vector<CBudgetProposal*> CBudgetManager::GetBudget()
     const int blockStart = GetNextSuperblock(pindexPrev->nHeight);
     const int blockEnd = blockStart + GetBudgetPaymentCycleBlocks() - 1;
     CAmount totalBudget = GetTotalBudget(blockStart);
+    const int nMinNetVotes = mnodeman.CountEnabled(MIN_BUDGET_PEER_PROTO_VERSION) / 10;
 
     std::vector<std::pair<CBudgetProposal*, int>>::iterator it2 = vBudgetPorposalsSort.begin();
     while (it2 != vBudgetPorposalsSort.end()) {
         CBudgetProposal* pbudgetProposal = (*it2).first;
 
         //prop start/end should be inside this period
-        if (pbudgetProposal->fValid && pbudgetProposal->nBlockStart <= blockStart && pbudgetProposal->nBlockEnd >= blockEnd && pbudgetProposal->GetYeas() - pbudgetProposal->GetNays() > mnodeman.CountEnabled(MIN_BUDGET_PEER_PROTO_VERSION) / 10 && pbudgetProposal->IsEstablished()) {
+        if (pbudgetProposal->fValid && pbudgetProposal->nBlockStart <= blockStart && pbudgetProposal->nBlockEnd >= blockEnd && (*it2).second > nMinNetVotes && pbudgetProposal->IsEstablished()) {
             if (pbudgetProposal->GetAmount() + nBudgetAllocated <= totalBudget) {
                 pbudgetProposal->SetAllotted(pbudgetProposal->GetAmount());
                 nBudgetAllocated += pbudgetProposal->GetAmount();
@@ -756,7 +826,7 @@ void CBudgetManager::NewBlock(CConnman& connman)
 
     CheckAndRemove();
 
-    //remove invalid votes once in a while (we have to check the signatures and validity of every vote, somewhat CPU intensive)
+    //revalidate the votes of the masternodes that joined or left the list, the other votes keep their validity
 
     LogPrint(BCLog::MASTERNODE, "CBudgetManager::NewBlock - askedForSourceProposalOrBudget cleanup - size: %d\n", askedForSourceProposalOrBudget.size());
     std::map<uint256, int64_t>::iterator it = askedForSourceProposalOrBudget.begin();
@@ -768,19 +838,8 @@ void CBudgetManager::NewBlock(CConnman& connman)
         }
     }
 
-    LogPrint(BCLog::MASTERNODE, "CBudgetManager::NewBlock - mapProposals cleanup - size: %d\n", mapProposals.size());
-    std::map<uint256, CBudgetProposal>::iterator it2 = mapProposals.begin();
-    while (it2 != mapProposals.end()) {
-        (*it2).second.CleanAndRemove(false);
-        ++it2;
-    }
-
-    LogPrint(BCLog::MASTERNODE, "CBudgetManager::NewBlock - mapBudgetDrafts cleanup - size: %d\n", mapBudgetDrafts.size());
-    std::map<uint256, BudgetDraft>::iterator it3 = mapBudgetDrafts.begin();
-    while (it3 != mapBudgetDrafts.end()) {
-        (*it3).second.CleanAndRemove(false);
-        ++it3;
-    }
+    LogPrint(BCLog::MASTERNODE, "CBudgetManager::NewBlock - votes cleanup - proposals: %d, budget drafts: %d\n", mapProposals.size(), mapBudgetDrafts.size());
+    UpdateMasternodeVotes();
 
     LogPrint(BCLog::MASTERNODE, "CBudgetManager::NewBlock - vecImmatureBudgetProposals cleanup - size: %d\n", vecImmatureBudgetProposals.size());
     std::vector<CBudgetProposalBroadcast>::iterator it4 = vecImmatureBudgetProposals.begin();
@@ -1349,6 +1408,9 @@ CBudgetProposal::CBudgetProposal()
     nAmount = 0;
     nTime = 0;
     fValid = true;
+    nYeas = 0;
+    nNays = 0;
+    nAbstains = 0;
 }
 
 CBudgetProposal::CBudgetProposal(std::string strProposalNameIn, std::string strURLIn, int nBlockStartIn, int nBlockEndIn, CScript addressIn, CAmount nAmountIn, uint256 nFeeTXHashIn)
@@ -1361,6 +1423,9 @@ CBudgetProposal::CBudgetProposal(std::string strProposalNameIn, std::string strU
     nAmount = nAmountIn;
     nFeeTXHash = nFeeTXHashIn;
     fValid = true;
+    nYeas = 0;
+    nNays = 0;
+    nAbstains = 0;
 }
 
 CBudgetProposal::CBudgetProposal(const CBudgetProposal& other)
@@ -1375,6 +1440,9 @@ CBudgetProposal::CBudgetProposal(const CBudgetProposal& other)
     nFeeTXHash = other.nFeeTXHash;
     mapVotes = other.mapVotes;
     fValid = true;
+    nYeas = other.nYeas;
+    nNays = other.nNays;
+    nAbstains = other.nAbstains;
 }
 
 bool CBudgetProposal::IsValid(std::string& strError, bool fCheckCollateral) const
@@ -1472,7 +1540,14 @@ bool CBudgetProposal::AddOrUpdateVote(const CBudgetVote& vote, std::string& strE
         return false;
     }
 
-    mapVotes[hash] = vote;
+    std::map<uint256, CBudgetVote>::iterator found = mapVotes.find(hash);
+    if (found != mapVotes.end()) {
+        CountVote(found->second, -1);
+        found->second = vote;
+    } else {
+        found = mapVotes.insert(std::make_pair(hash, vote)).first;
+    }
+    CountVote(found->second, 1);
     return true;
 }
 
@@ -1482,11 +1557,59 @@ void CBudgetProposal::CleanAndRemove(bool fSignatureCheck)
     std::map<uint256, CBudgetVote>::iterator it = mapVotes.begin();
 
     while (it != mapVotes.end()) {
-        (*it).second.fValid = (*it).second.SignatureValid(fSignatureCheck);
+        bool fValid = (*it).second.SignatureValid(fSignatureCheck);
+        if (fValid != (*it).second.fValid) {
+            CountVote((*it).second, -1);
+            (*it).second.fValid = fValid;
+            CountVote((*it).second, 1);
+        }
         ++it;
     }
 }
 
+void CBudgetProposal::SetMasternodeVoteValid(const COutPoint& outpoint, bool fValid)
+{
+    LOCK(m_cs);
+
+    std::map<uint256, CBudgetVote>::iterator found = mapVotes.find(outpoint.GetHash());
+    if (found == mapVotes.end() || found->second.vin.prevout != outpoint || found->second.fValid == fValid)
+        return;
+
+    CountVote(found->second, -1);
+    found->second.fValid = fValid;
+    CountVote(found->second, 1);
+}
+
+void CBudgetProposal::CountVote(const CBudgetVote& vote, int nDelta)
+{
+    if (!vote.fValid)
+        return;
+
+    if (vote.nVote == VOTE_YES)
+        nYeas += nDelta;
+    else if (vote.nVote == VOTE_NO)
+        nNays += nDelta;
+    else if (vote.nVote == VOTE_ABSTAIN)
+        nAbstains += nDelta;
+}
+
+void CBudgetProposal::RecountVotes()
+{
+    nYeas = 0;
+    nNays = 0;
+    nAbstains = 0;
+    for (const auto& vote : mapVotes)
+        CountVote(vote.second, 1);
+}
+
+void CBudgetProposal::SwapVotes(CBudgetProposal& other)
+{
+    mapVotes.swap(other.mapVotes);
+    std::swap(nYeas, other.nYeas);
+    std::swap(nNays, other.nNays);
+    std::swap(nAbstains, other.nAbstains);
+}
+
 double CBudgetProposal::GetRatio() const
 {
     int yeas = 0;
@@ -1507,38 +1630,17 @@ double CBudgetProposal::GetRatio() const
 
 int CBudgetProposal::GetYeas() const
 {
-    int ret = 0;
-
-    for (std::map<uint256, CBudgetVote>::const_iterator i = mapVotes.begin(); i != mapVotes.end(); ++i) {
-        if (i->second.nVote == VOTE_YES && i->second.fValid)
-            ++ret;
-    }
-
-    return ret;
+    return nYeas;
 }
 
 int CBudgetProposal::GetNays() const
 {
-    int ret = 0;
-
-    for (std::map<uint256, CBudgetVote>::const_iterator i = mapVotes.begin(); i != mapVotes.end(); ++i) {
-        if (i->second.nVote == VOTE_NO && i->second.fValid)
-            ++ret;
-    }
-
-    return ret;
+    return nNays;
 }
 
 int CBudgetProposal::GetAbstains() const
 {
-    int ret = 0;
-
-    for (std::map<uint256, CBudgetVote>::const_iterator i = mapVotes.begin(); i != mapVotes.end(); ++i) {
-        if (i->second.nVote == VOTE_ABSTAIN && i->second.fValid)
-            ++ret;
-    }
-
-    return ret;
+    return nAbstains;
 }
 
 int CBudgetProposal::GetBlockStartCycle() const
@@ -1630,6 +1732,11 @@ void CBudgetVote::Relay(CConnman& connman)
     connman.RelayInv(inv);
 }
 
+std::string CBudgetVote::GetSignatureMessage() const
+{
+    return vin.prevout.ToStringShort() + nProposalHash.ToString() + boost::lexical_cast<std::string>(nVote) + boost::lexical_cast<std::string>(nTime);
+}
+
 bool CBudgetVote::Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode)
 {
     // Choose coins to use
@@ -1637,7 +1744,7 @@ bool CBudgetVote::Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode)
     CKey keyCollateralAddress;
 
     std::string errorMessage;
-    std::string strMessage = vin.prevout.ToStringShort() + nProposalHash.ToString() + boost::lexical_cast<std::string>(nVote) + boost::lexical_cast<std::string>(nTime);
+    std::string strMessage = GetSignatureMessage();
 
     if (!legacySigner.SignMessage(strMessage, vchSig, keyMasternode)) {
         LogPrint(BCLog::MASTERNODE, "CBudgetVote::Sign - Error upon calling SignMessage");
@@ -1655,7 +1762,7 @@ bool CBudgetVote::Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode)
 bool CBudgetVote::SignatureValid(bool fSignatureCheck) const
 {
     std::string errorMessage;
-    std::string strMessage = vin.prevout.ToStringShort() + nProposalHash.ToString() + boost::lexical_cast<std::string>(nVote) + boost::lexical_cast<std::string>(nTime);
+    std::string strMessage = GetSignatureMessage();
 
     CMasternode* pmn = mnodeman.Find(vin);
 
@@ -1896,6 +2003,15 @@ void BudgetDraft::CleanAndRemove(bool fSignatureCheck)
     }
 }
 
+void BudgetDraft::SetMasternodeVoteValid(const COutPoint& outpoint, bool fValid)
+{
+    LOCK(m_cs);
+
+    std::map<uint256, BudgetDraftVote>::iterator found = m_votes.find(outpoint.GetHash());
+    if (found != m_votes.end() && found->second.vin.prevout == outpoint)
+        found->second.fValid = fValid;
+}
+
 CAmount BudgetDraft::GetTotalPayout() const
 {
     LOCK(m_cs);
@@ -2314,6 +2430,11 @@ uint256 BudgetDraftVote::GetHash() const
     return ss.GetHash();
 }
 
+std::string BudgetDraftVote::GetSignatureMessage() const
+{
+    return vin.prevout.ToStringShort() + nBudgetHash.ToString() + boost::lexical_cast<std::string>(nTime);
+}
+
 bool BudgetDraftVote::Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode)
 {
     // Choose coins to use
@@ -2321,7 +2442,7 @@ bool BudgetDraftVote::Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode)
     CKey keyCollateralAddress;
 
     std::string errorMessage;
-    std::string strMessage = vin.prevout.ToStringShort() + nBudgetHash.ToString() + boost::lexical_cast<std::string>(nTime);
+    std::string strMessage = GetSignatureMessage();
 
     if (!legacySigner.SignMessage(strMessage, vchSig, keyMasternode)) {
         LogPrint(BCLog::MASTERNODE, "BudgetDraftVote::Sign - Error upon calling SignMessage");
@@ -2340,7 +2461,7 @@ bool BudgetDraftVote::SignatureValid(bool fSignatureCheck)
 {
     std::string errorMessage;
 
-    std::string strMessage = vin.prevout.ToStringShort() + nBudgetHash.ToString() + boost::lexical_cast<std::string>(nTime);
+    std::string strMessage = GetSignatureMessage();
 
     CMasternode* pmn = mnodeman.Find(vin);
 
@@ -2360,6 +2481,20 @@ bool BudgetDraftVote::SignatureValid(bool fSignatureCheck)
     return true;
 }
 
+void CBudgetManager::GetSnapshot(CBudgetManager& snapshot) const
+{
+    LOCK2(m_cs, snapshot.m_cs);
+    snapshot.mapSeenMasternodeBudgetProposals = mapSeenMasternodeBudgetProposals;
+    snapshot.mapSeenMasternodeBudgetVotes = mapSeenMasternodeBudgetVotes;
+    snapshot.mapSeenBudgetDrafts = mapSeenBudgetDrafts;
+    snapshot.mapSeenBudgetDraftVotes = mapSeenBudgetDraftVotes;
+    snapshot.mapOrphanMasternodeBudgetVotes = mapOrphanMasternodeBudgetVotes;
+    snapshot.mapOrphanBudgetDraftVotes = mapOrphanBudgetDraftVotes;
+    snapshot.mapProposals = mapProposals;
+    snapshot.mapProposalsByName = mapProposalsByName;
+    snapshot.mapBudgetDrafts = mapBudgetDrafts;
+}
+
 std::string CBudgetManager::ToString() const
 {
     LOCK(m_cs);
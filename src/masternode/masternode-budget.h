@@ -49,6 +49,9 @@ CAmount GetVotingThreshold();
 //Check the collateral transaction for the budget proposal/finalized budget
 bool IsBudgetCollateralValid(uint256 nTxCollateralHash, uint256 nExpectedHash, std::string& strError, int64_t& nTime, int& nConf);
 
+//Find the OP_RETURN output paying at least BUDGET_FEE_TX in a collateral transaction, and whether all its outputs are standard
+bool GetBudgetFeeOutput(const CTransaction& tx, CAmount& nAmount, std::vector<unsigned char>& vchPayload, bool& fStandardOutputs);
+
 //
 // CBudgetVote - Allow a masternode node to vote and broadcast throughout the network
 //
@@ -66,6 +69,8 @@ public:
     CBudgetVote();
     CBudgetVote(CTxIn vin, uint256 nProposalHash, int nVoteIn);
 
+    //! The message covered by the signature, see CLegacySigner::GetMessageHash
+    std::string GetSignatureMessage() const;
     bool Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode);
     bool SignatureValid(bool fSignatureCheck) const;
     void Relay(CConnman& connman);
@@ -114,6 +119,7 @@ private:
 
     // keep track of the scanning errors I've seen
     std::map<uint256, CBudgetProposal> mapProposals;
+    std::multimap<std::string, uint256> mapProposalsByName; // several proposals may share a name
     std::map<uint256, BudgetDraft> mapBudgetDrafts;
 
     std::map<uint256, CBudgetProposalBroadcast> mapSeenMasternodeBudgetProposals;
@@ -123,10 +129,14 @@ private:
     std::map<uint256, BudgetDraftVote> mapSeenBudgetDraftVotes;
     std::map<uint256, BudgetDraftVote> mapOrphanBudgetDraftVotes;
 
+    // set when the votes were loaded or cleared, every vote is revalidated on the next UpdateMasternodeVotes
+    bool fMasternodeVotesDirty{true};
+
 public:
     CBudgetManager()
     {
         mapProposals.clear();
+        mapProposalsByName.clear();
         mapBudgetDrafts.clear();
     }
 
@@ -196,6 +206,7 @@ public:
 
         LogPrint(BCLog::MASTERNODE, "Budget object cleared\n");
         mapProposals.clear();
+        mapProposalsByName.clear();
         mapBudgetDrafts.clear();
         mapSeenMasternodeBudgetProposals.clear();
         mapSeenMasternodeBudgetVotes.clear();
@@ -203,8 +214,12 @@ public:
         mapSeenBudgetDraftVotes.clear();
         mapOrphanMasternodeBudgetVotes.clear();
         mapOrphanBudgetDraftVotes.clear();
+        fMasternodeVotesDirty = true;
     }
 
+    /// Copy the state stored in budget.dat into an empty manager, so it can be written without holding m_cs
+    void GetSnapshot(CBudgetManager& snapshot) const;
+
     SERIALIZE_METHODS(CBudgetManager, obj)
     {
         READWRITE(obj.mapSeenMasternodeBudgetProposals);
@@ -215,10 +230,15 @@ public:
         READWRITE(obj.mapOrphanBudgetDraftVotes);
         READWRITE(obj.mapProposals);
         READWRITE(obj.mapBudgetDrafts);
+        SER_READ(obj, obj.RebuildProposalNameIndex());
+        SER_READ(obj, obj.fMasternodeVotesDirty = true);
     }
 
 private:
     const BudgetDraft* GetMostVotedBudget(int height) const;
+    void RebuildProposalNameIndex();
+    // revalidate the votes of the masternodes added or removed since the last call
+    void UpdateMasternodeVotes();
 };
 
 class CTxBudgetPayment {
@@ -278,6 +298,7 @@ public:
     );
 
     void CleanAndRemove(bool fSignatureCheck);
+    void SetMasternodeVoteValid(const COutPoint& outpoint, bool fValid);
     bool AddOrUpdateVote(bool isOldVote, const BudgetDraftVote& vote, std::string& strError);
 
     bool IsValid(std::string& strError, bool fCheckCollateral = true) const;
@@ -447,6 +468,8 @@ public:
     BudgetDraftVote();
     BudgetDraftVote(CTxIn vinIn, uint256 nBudgetHashIn);
 
+    //! The message covered by the signature, see CLegacySigner::GetMessageHash
+    std::string GetSignatureMessage() const;
     bool Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode);
     bool SignatureValid(bool fSignatureCheck);
     void Relay(CConnman& connman);
@@ -472,6 +495,17 @@ private:
     mutable RecursiveMutex m_cs;
     CAmount nAlloted;
 
+    // Valid votes per outcome, kept in step with mapVotes by AddOrUpdateVote, CleanAndRemove and SetMasternodeVoteValid
+    int nYeas;
+    int nNays;
+    int nAbstains;
+
+    void CountVote(const CBudgetVote& vote, int nDelta);
+    void RecountVotes();
+
+protected:
+    void SwapVotes(CBudgetProposal& other);
+
 public:
     bool fValid;
     std::string strProposalName;
@@ -488,8 +522,8 @@ public:
     mutable int64_t nTime;
     uint256 nFeeTXHash;
 
+    // only add or revalidate votes through AddOrUpdateVote and CleanAndRemove, which keep the tallies
     std::map<uint256, CBudgetVote> mapVotes;
-    //cache object
 
     CBudgetProposal();
     CBudgetProposal(const CBudgetProposal& other);
@@ -530,6 +564,8 @@ public:
     CAmount GetAllotted() const { return nAlloted; }
 
     void CleanAndRemove(bool fSignatureCheck);
+    // mark the vote of the masternode with this collateral, if any, as valid or not
+    void SetMasternodeVoteValid(const COutPoint& outpoint, bool fValid);
 
     uint256 GetHash() const
     {
@@ -557,6 +593,7 @@ public:
         READWRITE(obj.nTime);
         READWRITE(obj.nFeeTXHash);
         READWRITE(obj.mapVotes);
+        SER_READ(obj, obj.RecountVotes());
     }
 };
 
@@ -592,7 +629,7 @@ public:
         swap(first.address, second.address);
         swap(first.nTime, second.nTime);
         swap(first.nFeeTXHash, second.nFeeTXHash);
-        first.mapVotes.swap(second.mapVotes);
+        first.SwapVotes(second);
     }
 
     CBudgetProposalBroadcast& operator=(CBudgetProposalBroadcast from)
@@ -301,12 +301,17 @@ void CMasternodePayments::ProcessMessageMasternodePayments(CNode* pfrom, const s
     }
 }
 
+std::string CMasternodePaymentWinner::GetSignatureMessage() const
+{
+    return vinMasternode.prevout.ToStringShort() + boost::lexical_cast<std::string>(nBlockHeight) + payee.ToString();
+}
+
 bool CMasternodePaymentWinner::Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode)
 {
     std::string errorMessage;
     std::string strMasterNodeSignMessage;
 
-    std::string strMessage = vinMasternode.prevout.ToStringShort() + boost::lexical_cast<std::string>(nBlockHeight) + payee.ToString();
+    std::string strMessage = GetSignatureMessage();
 
     if (!legacySigner.SignMessage(strMessage, vchSig, keyMasternode)) {
         LogPrint(BCLog::MASTERNODE, "CMasternodePing::Sign() - Error: %s\n", errorMessage.c_str());
@@ -363,6 +368,31 @@ bool CMasternodePayments::IsScheduled(CMasternode& mn, int nNotBlockHeight)
     return false;
 }
 
+void CMasternodePayments::GetScheduledPayees(int nNotBlockHeight, std::set<CScript>& setPayees)
+{
+    LOCK(cs_mapMasternodeBlocks);
+
+    setPayees.clear();
+
+    int nHeight;
+    {
+        TRY_LOCK(cs_main, locked);
+        if (!locked || ::ChainActive().Tip() == nullptr)
+            return;
+        nHeight = ::ChainActive().Tip()->nHeight;
+    }
+
+    CScript payee;
+    for (int64_t h = nHeight; h <= nHeight + 8; h++) {
+        if (h == nNotBlockHeight)
+            continue;
+        if (mapMasternodeBlocks.count(h)) {
+            if (mapMasternodeBlocks[h].GetPayee(payee))
+                setPayees.insert(payee);
+        }
+    }
+}
+
 bool CMasternodePayments::AddWinningMasternode(CMasternodePaymentWinner& winnerIn)
 {
     uint256 blockHash = uint256();
@@ -388,11 +418,54 @@ bool CMasternodePayments::AddWinningMasternode(CMasternodePaymentWinner& winnerI
     int n = 1;
     if (IsReferenceNode(winnerIn.vinMasternode))
         n = 100;
-    mapMasternodeBlocks[winnerIn.nBlockHeight].AddPayee(winnerIn.payee, n);
+    AddPayeeVotes(winnerIn.nBlockHeight, winnerIn.payee, n);
 
     return true;
 }
 
+void CMasternodePayments::AddPayeeVotes(int nBlockHeight, const CScript& payee, int nVotes)
+{
+    LOCK(cs_mapMasternodeBlocks);
+
+    if (!mapMasternodeBlocks.count(nBlockHeight)) {
+        CMasternodeBlockPayees blockPayees(nBlockHeight);
+        mapMasternodeBlocks[nBlockHeight] = blockPayees;
+    }
+
+    mapMasternodeBlocks[nBlockHeight].AddPayee(payee, nVotes);
+    if (mapMasternodeBlocks[nBlockHeight].HasPayeeWithVotes(payee, 2))
+        mapPayeeVotedHeights[payee].insert(nBlockHeight);
+}
+
+// Most recent height not above nMaxHeight where payee had at least two votes, 0 if there is none
+int CMasternodePayments::GetLastPaidHeight(const CScript& payee, int nMaxHeight)
+{
+    LOCK(cs_mapMasternodeBlocks);
+
+    auto it = mapPayeeVotedHeights.find(payee);
+    if (it == mapPayeeVotedHeights.end())
+        return 0;
+
+    auto itHeight = it->second.upper_bound(nMaxHeight);
+    if (itHeight == it->second.begin())
+        return 0;
+
+    return *std::prev(itHeight);
+}
+
+void CMasternodePayments::RebuildPayeeVotedHeights()
+{
+    LOCK(cs_mapMasternodeBlocks);
+
+    mapPayeeVotedHeights.clear();
+    for (auto& blockPayees : mapMasternodeBlocks) {
+        for (const auto& payee : blockPayees.second.vecPayments) {
+            if (payee.nVotes >= 2)
+                mapPayeeVotedHeights[payee.scriptPubKey].insert(blockPayees.first);
+        }
+    }
+}
+
 bool CMasternodeBlockPayees::IsTransactionValid(const CTransaction& txNew, const CAmount& nValueCreated)
 {
     LOCK(cs_vecPayments);
@@ -515,6 +588,16 @@ void CMasternodePayments::CheckAndRemove()
             LogPrint(BCLog::MASTERNODE, "CMasternodePayments::CleanPaymentList - Removing old Masternode payment - block %d\n", winner.nBlockHeight);
             masternodeSync.mapSeenSyncMNW.erase((*it).first);
             mapMasternodePayeeVotes.erase(it++);
+            if (mapMasternodeBlocks.count(winner.nBlockHeight)) {
+                for (const auto& payee : mapMasternodeBlocks[winner.nBlockHeight].vecPayments) {
+                    auto itVoted = mapPayeeVotedHeights.find(payee.scriptPubKey);
+                    if (itVoted == mapPayeeVotedHeights.end())
+                        continue;
+                    itVoted->second.erase(winner.nBlockHeight);
+                    if (itVoted->second.empty())
+                        mapPayeeVotedHeights.erase(itVoted);
+                }
+            }
             mapMasternodeBlocks.erase(winner.nBlockHeight);
         } else {
             ++it;
@@ -537,7 +620,8 @@ bool CMasternodePaymentWinner::IsValid(CNode* pnode, std::string& strError, CCon
     if (IsReferenceNode(vinMasternode))
         return true;
 
-    CMasternode* pmn = mnodeman.Find(vinMasternode);
+    std::shared_ptr<const MasternodeListSnapshot> pSnapshot = mnodeman.GetListSnapshot();
+    const CMasternode* pmn = pSnapshot->Find(vinMasternode.prevout);
 
     if (!pmn) {
         strError = strprintf("Unknown Masternode %s", vinMasternode.prevout.ToStringShort());
@@ -650,10 +734,11 @@ void CMasternodePaymentWinner::Relay(CConnman& connman)
 bool CMasternodePaymentWinner::SignatureValid()
 {
 
-    CMasternode* pmn = mnodeman.Find(vinMasternode);
+    std::shared_ptr<const MasternodeListSnapshot> pSnapshot = mnodeman.GetListSnapshot();
+    const CMasternode* pmn = pSnapshot->Find(vinMasternode.prevout);
 
     if (pmn) {
-        std::string strMessage = vinMasternode.prevout.ToStringShort() + boost::lexical_cast<std::string>(nBlockHeight) + payee.ToString();
+        std::string strMessage = GetSignatureMessage();
 
         std::string errorMessage = "";
         if (!legacySigner.VerifyMessage(pmn->pubkey2, vchSig, strMessage, errorMessage)) {
@@ -158,6 +158,8 @@ public:
         return ss.GetHash();
     }
 
+    //! The message covered by the signature, see CLegacySigner::GetMessageHash
+    std::string GetSignatureMessage() const;
     bool Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode);
     bool IsValid(CNode* pnode, std::string& strError, CConnman& connman);
     bool SignatureValid();
@@ -196,6 +198,8 @@ class CMasternodePayments {
 private:
     int nSyncedFromPeer;
     int nLastBlockHeight;
+    // payee => heights at which the payee had at least two votes, lets GetLastPaid skip walking the chain
+    std::map<CScript, std::set<int>> mapPayeeVotedHeights;
 
 public:
     std::map<uint256, CMasternodePaymentWinner> mapMasternodePayeeVotes;
@@ -213,6 +217,13 @@ public:
         LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePayeeVotes);
         mapMasternodeBlocks.clear();
         mapMasternodePayeeVotes.clear();
+        mapPayeeVotedHeights.clear();
+    }
+
+    bool HasPayeeVote(const uint256& hash) const
+    {
+        LOCK(cs_mapMasternodePayeeVotes);
+        return mapMasternodePayeeVotes.count(hash);
     }
 
     bool AddWinningMasternode(CMasternodePaymentWinner& winner);
@@ -225,6 +236,11 @@ public:
     bool GetBlockPayee(int nBlockHeight, CScript& payee);
     bool IsTransactionValid(const CAmount& nValueCreated, const CTransaction& txNew, int nBlockHeight);
     bool IsScheduled(CMasternode& mn, int nNotBlockHeight);
+    void GetScheduledPayees(int nNotBlockHeight, std::set<CScript>& setPayees);
+
+    void AddPayeeVotes(int nBlockHeight, const CScript& payee, int nVotes);
+    int GetLastPaidHeight(const CScript& payee, int nMaxHeight);
+    void RebuildPayeeVotedHeights();
 
     bool CanVote(COutPoint outMasternode, int nBlockHeight);
 
@@ -240,6 +256,7 @@ public:
     {
         READWRITE(obj.mapMasternodePayeeVotes);
         READWRITE(obj.mapMasternodeBlocks);
+        SER_READ(obj, obj.RebuildPayeeVotedHeights());
     }
 };
 
@@ -24,52 +24,31 @@
 
 // keep track of the scanning errors I've seen
 std::map<uint256, int> mapSeenMasternodeScanningErrors;
-// cache block hashes as we calculate them
-std::map<int64_t, uint256> mapCacheBlockHashes;
 
-//Get the last hash that matches the modulus given. Processed in reverse order
+// Return the hash of the block before nBlockHeight, or the tip for the next height and for negative heights
 bool GetBlockHash(uint256& hash, int nBlockHeight)
 {
-    if (::ChainActive().Tip() == nullptr)
+    LOCK(cs_main);
+
+    const CChain& chain = ::ChainActive();
+    if (chain.Tip() == nullptr || chain.Height() == 0)
         return false;
 
     if (nBlockHeight == 0)
-        nBlockHeight = ::ChainActive().Tip()->nHeight;
-
-    if (mapCacheBlockHashes.count(nBlockHeight)) {
-        hash = mapCacheBlockHashes[nBlockHeight];
-        return true;
-    }
+        nBlockHeight = chain.Height();
 
-    const CBlockIndex* BlockLastSolved = ::ChainActive().Tip();
-    const CBlockIndex* BlockReading = ::ChainActive().Tip();
-
-    if (BlockLastSolved == nullptr || BlockLastSolved->nHeight == 0 || ::ChainActive().Tip()->nHeight + 1 < nBlockHeight)
+    if (nBlockHeight > chain.Height() + 1)
         return false;
 
-    int nBlocksAgo = 0;
-    if (nBlockHeight > 0)
-        nBlocksAgo = (::ChainActive().Tip()->nHeight + 1) - nBlockHeight;
-    assert(nBlocksAgo >= 0);
-
-    int n = 0;
-    for (unsigned int i = 1; BlockReading && BlockReading->nHeight > 0; i++) {
-        if (n >= nBlocksAgo) {
-            hash = BlockReading->GetBlockHash();
-            mapCacheBlockHashes[nBlockHeight] = hash;
-            return true;
-        }
-        n++;
-
-        if (BlockReading->pprev == nullptr) {
-            assert(BlockReading);
-            break;
-        }
-        BlockReading = BlockReading->pprev;
-    }
+    // the genesis block is never used as a score source
+    int nHeight = nBlockHeight > 0 ? nBlockHeight - 1 : chain.Height();
+    if (nHeight < 1)
+        return false;
 
-    return false;
+    hash = chain[nHeight]->GetBlockHash();
+    return true;
 }
+
 void vecHash(uint256& hash, std::vector<uint256> vPrevBlockHash)
 {
     bool firstHash = true;
@@ -126,6 +105,9 @@ CMasternode::CMasternode(const CMasternode& other)
     nLastDsq = other.nLastDsq;
     nScanningErrorCount = other.nScanningErrorCount;
     nLastScanningErrorBlockHeight = other.nLastScanningErrorBlockHeight;
+    fCollateralSpent = other.fCollateralSpent;
+    hashBroadcast = other.hashBroadcast;
+    nBroadcastHashSigTime = other.nBroadcastHashSigTime;
     lastTimeChecked = 0;
 }
 
@@ -152,6 +134,19 @@ CMasternode::CMasternode(const CMasternodeBroadcast& mnb)
     lastTimeChecked = 0;
 }
 
+uint256 CMasternode::GetBroadcastHash() const
+{
+    // same as CMasternodeBroadcast::GetHash, without copying the entry into a broadcast
+    if (nBroadcastHashSigTime != sigTime) {
+        CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+        ss << sigTime;
+        ss << pubkey;
+        hashBroadcast = ss.GetHash();
+        nBroadcastHashSigTime = sigTime;
+    }
+    return hashBroadcast;
+}
+
 //
 // When a new masternode broadcast is sent, update our information
 //
@@ -164,6 +159,7 @@ bool CMasternode::UpdateFromNewBroadcast(CMasternodeBroadcast& mnb, CConnman& co
         protocolVersion = mnb.protocolVersion;
         addr = mnb.addr;
         lastTimeChecked = 0;
+        mnodeman.NotifyMasternodeUpdates(true);
         int nDoS = 0;
         if (mnb.lastPing == CMasternodePing() || (mnb.lastPing != CMasternodePing() && mnb.lastPing.CheckAndUpdate(nDoS, connman, false))) {
             lastPing = mnb.lastPing;
@@ -239,9 +235,19 @@ void CMasternode::Check(bool forceCheck)
         return;
     lastTimeChecked = GetTime();
 
-    //once spent, stop doing the checks
-    if (activeState == MASTERNODE_VIN_SPENT)
+    int nActiveStatePrev = activeState;
+    CheckState();
+    if (activeState != nActiveStatePrev)
+        mnodeman.NotifyMasternodeUpdates();
+}
+
+void CMasternode::CheckState()
+{
+    // the collateral is followed from block events by the manager, see CMasternodeMan::UpdateCollaterals
+    if (fCollateralSpent && !unitTest) {
+        activeState = MASTERNODE_VIN_SPENT;
         return;
+    }
 
     if (!IsPingedWithin(MASTERNODE_REMOVAL_SECONDS)) {
         activeState = MASTERNODE_REMOVE;
@@ -253,18 +259,6 @@ void CMasternode::Check(bool forceCheck)
         return;
     }
 
-    //test if the collateral is still good
-    if (!unitTest) {
-        TRY_LOCK(cs_main, lockMain);
-        if(!lockMain) return;
-        CollateralStatus err = CheckCollateral(vin.prevout);
-        if (err == COLLATERAL_UTXO_NOT_FOUND) {
-            activeState = MASTERNODE_VIN_SPENT;
-            LogPrint(BCLog::MASTERNODE, "CMasternode::Check -- Failed to find Masternode UTXO, masternode=%s\n", vin.prevout.ToString());
-            return;
-        }
-    }
-
     activeState = MASTERNODE_ENABLED; // OK
 }
 
@@ -277,12 +271,12 @@ bool CMasternode::IsValidNetAddr() const
     return (addr.IsIPv4() && addr.IsRoutable());
 }
 
-int64_t CMasternode::SecondsSincePayment() const
+int64_t CMasternode::SecondsSincePayment(int nEnabledCount) const
 {
     CScript pubkeyScript;
     pubkeyScript = GetScriptForDestination(PKHash(pubkey));
 
-    int64_t sec = (GetAdjustedTime() - GetLastPaid());
+    int64_t sec = (GetAdjustedTime() - GetLastPaid(nEnabledCount));
     int64_t month = 60 * 60 * 24 * 30;
     if (sec < month)
         return sec; //if it's less than 30 days, give seconds
@@ -296,11 +290,11 @@ int64_t CMasternode::SecondsSincePayment() const
     return month + UintToArith256(hash).GetCompact(false);
 }
 
-int64_t CMasternode::GetLastPaid() const
+int64_t CMasternode::GetLastPaid(int nEnabledCount) const
 {
-    CBlockIndex* pindexPrev = ::ChainActive().Tip();
-    if (pindexPrev == nullptr)
-        return false;
+    const CBlockIndex* pindexTip = ::ChainActive().Tip();
+    if (pindexTip == nullptr)
+        return 0;
 
     CScript mnpayee;
     mnpayee = GetScriptForDestination(PKHash(pubkey));
@@ -313,74 +307,67 @@ int64_t CMasternode::GetLastPaid() const
     // use a deterministic offset to break a tie -- 2.5 minutes
     int64_t nOffset = UintToArith256(hash).GetCompact(false) % 150;
 
-    if (::ChainActive().Tip() == nullptr)
-        return false;
+    if (nEnabledCount < 0)
+        nEnabledCount = mnodeman.CountEnabled();
+    int nMnCount = nEnabledCount * 1.25;
 
-    const CBlockIndex* BlockReading = ::ChainActive().Tip();
+    /*
+        Search for this payee, with at least 2 votes, within the last nMnCount blocks. This will aid in consensus
+        allowing the network to converge on the same payees quickly, then keep the same schedule.
+    */
+    int nPaidHeight = masternodePayments.GetLastPaidHeight(mnpayee, pindexTip->nHeight);
+    if (nPaidHeight <= 0 || pindexTip->nHeight - nPaidHeight >= nMnCount)
+        return 0;
 
-    int nMnCount = mnodeman.CountEnabled() * 1.25;
-    int n = 0;
-    for (unsigned int i = 1; BlockReading && BlockReading->nHeight > 0; i++) {
-        if (n >= nMnCount) {
-            return 0;
-        }
-        n++;
-
-        if (masternodePayments.mapMasternodeBlocks.count(BlockReading->nHeight)) {
-            /*
-                Search for this payee, with at least 2 votes. This will aid in consensus allowing the network 
-                to converge on the same payees quickly, then keep the same schedule.
-            */
-            if (masternodePayments.mapMasternodeBlocks[BlockReading->nHeight].HasPayeeWithVotes(mnpayee, 2)) {
-                return BlockReading->nTime + nOffset;
-            }
-        }
+    return ::ChainActive()[nPaidHeight]->nTime + nOffset;
+}
 
-        if (BlockReading->pprev == nullptr) {
-            assert(BlockReading);
-            break;
-        }
-        BlockReading = BlockReading->pprev;
+// First height of the stake pointer window for a chain ending at nTipHeight
+int CMasternode::GetPaymentWindowStart(int nTipHeight)
+{
+    return std::max(1, nTipHeight - Params().ValidStakePointerDuration() + 1);
+}
+
+// Find all payments the MN received within defined block depth
+// Used for generating stakepointers
+bool CMasternode::GetRecentPayments(std::vector<NodePayment>& vPayments, bool limitMostRecent) const
+{
+    int nMinimumValidBlockHeight = GetPaymentWindowStart(::ChainActive().Height());
+
+    CScript mnpayee;
+    mnpayee = GetScriptForDestination(PKHash(pubkey));
+
+    std::vector<NodePayment> vIndexed;
+    g_paymentIndex.GetPayments(mnpayee, MN_PMT_SLOT, nMinimumValidBlockHeight, ::ChainActive().Height() - 1, vIndexed);
+
+    // the index follows ConnectBlock/DisconnectBlock, make sure every entry is still on the active chain
+    vPayments.clear();
+    for (const auto& payment : vIndexed) {
+        const CBlockIndex* pindex = ::ChainActive()[payment.nHeight];
+        if (pindex && pindex->GetBlockHash() == payment.hashBlock)
+            vPayments.emplace_back(payment);
     }
 
-    return 0;
+    // as the block scan this replaced, limitMostRecent keeps the first payment of the window
+    if (limitMostRecent && vPayments.size() > 1)
+        vPayments.resize(1);
+
+    return !vPayments.empty();
 }
 
 // Find all blocks where MN received reward within defined block depth
-// Used for generating stakepointers
 bool CMasternode::GetRecentPaymentBlocks(std::vector<const CBlockIndex*>& vPaymentBlocks, bool limitMostRecent) const
 {
     vPaymentBlocks.clear();
-    int nMinimumValidBlockHeight = ::ChainActive().Height() - Params().ValidStakePointerDuration() + 1;
-    if (nMinimumValidBlockHeight < 1)
-        nMinimumValidBlockHeight = 1;
 
-    CBlockIndex* pindex = ::ChainActive()[nMinimumValidBlockHeight];
-
-    CScript mnpayee;
-    mnpayee = GetScriptForDestination(PKHash(pubkey));
+    std::vector<NodePayment> vPayments;
+    if (!GetRecentPayments(vPayments, limitMostRecent))
+        return false;
 
-    bool fBlockFound = false;
-    while (::ChainActive().Next(pindex)) {
-        CBlock block;
-        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus()))
-            continue;
-
-        int m = (block.vtx[0]->nVersion >= TX_ELE_VERSION ? block.vtx[0]->vpout.size() : block.vtx[0]->vout.size());
-
-        if (m > 1) {
-            CTxOutAsset out = (block.vtx[0]->nVersion >= TX_ELE_VERSION ? block.vtx[0]->vpout[1] : block.vtx[0]->vout[1]);
-            if (out.scriptPubKey == mnpayee){
-                vPaymentBlocks.emplace_back(pindex);
-                fBlockFound = true;
-                if (limitMostRecent)
-                    return fBlockFound;
-            }
-        }
-        pindex = ::ChainActive().Next(pindex);
-    }
+    for (const auto& payment : vPayments)
+        vPaymentBlocks.emplace_back(::ChainActive()[payment.nHeight]);
 
-    return fBlockFound;
+    return true;
 }
 
 CMasternodeBroadcast::CMasternodeBroadcast()
@@ -742,16 +729,21 @@ void CMasternodeBroadcast::Relay(CConnman& connman) const
     connman.RelayInv(inv);
 }
 
-bool CMasternodeBroadcast::Sign(const CKey& keyCollateralAddress)
+std::string CMasternodeBroadcast::GetSignatureMessage() const
 {
-    std::string errorMessage;
-
     std::string vchPubKey(pubkey.begin(), pubkey.end());
     std::string vchPubKey2(pubkey2.begin(), pubkey2.end());
 
+    return addr.ToString() + boost::lexical_cast<std::string>(sigTime) + vchPubKey + vchPubKey2 + boost::lexical_cast<std::string>(protocolVersion);
+}
+
+bool CMasternodeBroadcast::Sign(const CKey& keyCollateralAddress)
+{
+    std::string errorMessage;
+
     sigTime = GetAdjustedTime();
 
-    std::string strMessage = addr.ToString() + boost::lexical_cast<std::string>(sigTime) + vchPubKey + vchPubKey2 + boost::lexical_cast<std::string>(protocolVersion);
+    std::string strMessage = GetSignatureMessage();
 
     if (!legacySigner.SignMessage(strMessage, sig, keyCollateralAddress)) {
         LogPrint(BCLog::MASTERNODE, "CMasternodeBroadcast::Sign() - Error: %s\n", errorMessage);
@@ -765,10 +757,7 @@ bool CMasternodeBroadcast::VerifySignature() const
 {
     std::string errorMessage;
 
-    std::string vchPubKey(pubkey.begin(), pubkey.end());
-    std::string vchPubKey2(pubkey2.begin(), pubkey2.end());
-
-    std::string strMessage = addr.ToString() + boost::lexical_cast<std::string>(sigTime) + vchPubKey + vchPubKey2 + boost::lexical_cast<std::string>(protocolVersion);
+    std::string strMessage = GetSignatureMessage();
 
     if (!legacySigner.VerifyMessage(pubkey, sig, strMessage, errorMessage)) {
         LogPrint(BCLog::MASTERNODE, "CMasternodeBroadcast::VerifySignature() - Error: %s\n", errorMessage);
@@ -806,13 +795,18 @@ CMasternodePing::CMasternodePing(const CTxIn& newVin)
     nVersion = 2;
 }
 
+std::string CMasternodePing::GetSignatureMessage() const
+{
+    return vin.ToString() + blockHash.ToString() + boost::lexical_cast<std::string>(sigTime);
+}
+
 bool CMasternodePing::Sign(const CKey& keyMasternode, const CPubKey& pubKeyMasternode)
 {
     std::string errorMessage;
     std::string strMasterNodeSignMessage;
 
     sigTime = GetAdjustedTime();
-    std::string strMessage = vin.ToString() + blockHash.ToString() + boost::lexical_cast<std::string>(sigTime);
+    std::string strMessage = GetSignatureMessage();
 
     if (!legacySigner.SignMessage(strMessage, vchSig, keyMasternode)) {
         LogPrint(BCLog::MASTERNODE, "CMasternodePing::Sign() - Error: %s\n", errorMessage);
@@ -841,7 +835,7 @@ bool CMasternodePing::Sign(const CKey& keyMasternode, const CPubKey& pubKeyMaste
 
 bool CMasternodePing::VerifySignature(const CPubKey& pubKeyMasternode, int &nDos) const
 {
-    std::string strMessage = vin.ToString() + blockHash.ToString() + boost::lexical_cast<std::string>(sigTime);
+    std::string strMessage = GetSignatureMessage();
     std::string errorMessage = "";
 
     if(!legacySigner.VerifyMessage(pubKeyMasternode, vchSig, strMessage, errorMessage))
@@ -921,6 +915,7 @@ bool CMasternodePing::CheckAndUpdate(int& nDos, CConnman& connman, bool fRequire
             }
 
             pmn->lastPing = *this;
+            mnodeman.NotifyMasternodePing();
 
             //mnodeman.mapSeenMasternodeBroadcast.lastPing is probably outdated, so we'll update it
             CMasternodeBroadcast mnb(*pmn);
@@ -11,6 +11,7 @@
 #include <crown/legacycalls.h>
 #include <key.h>
 #include <net.h>
+#include <pos/paymentindex.h>
 #include <sync.h>
 #include <timedata.h>
 #include <util/system.h>
@@ -28,7 +29,6 @@
 class CMasternode;
 class CMasternodeBroadcast;
 class CMasternodePing;
-extern std::map<int64_t, uint256> mapCacheBlockHashes;
 
 
 //
@@ -68,6 +68,8 @@ public:
     }
 
     bool CheckAndUpdate(int& nDos, CConnman& connman, bool fRequireEnabled = true, bool fCheckSigTimeOnly = false);
+    //! The message covered by the signature, see CLegacySigner::GetMessageHash
+    std::string GetSignatureMessage() const;
     bool Sign(const CKey& keyMasternode, const CPubKey& pubKeyMasternode);
     bool VerifySignature(const CPubKey& pubKeyMasternode, int& nDos) const;
     void Relay(CConnman& connman);
@@ -117,6 +119,11 @@ private:
     // critical section to protect the inner data structures
     mutable RecursiveMutex cs;
     int64_t lastTimeChecked;
+    // hash of the broadcast of this entry and the sigTime it was computed for
+    mutable uint256 hashBroadcast;
+    mutable int64_t nBroadcastHashSigTime{-1};
+
+    void CheckState();
 
 public:
     enum state {
@@ -150,6 +157,8 @@ public:
     int nLastScanningErrorBlockHeight;
     CMasternodePing lastPing;
     std::vector<unsigned char> vchSignover;
+    // set by the manager from connected and disconnected blocks, not serialized
+    bool fCollateralSpent{false};
 
     CMasternode();
     CMasternode(const CMasternode& other);
@@ -179,6 +188,9 @@ public:
         swap(first.nScanningErrorCount, second.nScanningErrorCount);
         swap(first.nLastScanningErrorBlockHeight, second.nLastScanningErrorBlockHeight);
         swap(first.vchSignover, second.vchSignover);
+        swap(first.fCollateralSpent, second.fCollateralSpent);
+        swap(first.hashBroadcast, second.hashBroadcast);
+        swap(first.nBroadcastHashSigTime, second.nBroadcastHashSigTime);
     }
 
     CMasternode& operator=(CMasternode from)
@@ -223,7 +235,7 @@ public:
     static CollateralStatus CheckCollateral(const COutPoint& outpoint);
     static CollateralStatus CheckCollateral(const COutPoint& outpoint, int& nHeightRet);
 
-    int64_t SecondsSincePayment() const;
+    int64_t SecondsSincePayment(int nEnabledCount = -1) const;
     bool UpdateFromNewBroadcast(CMasternodeBroadcast& mnb, CConnman& connman);
     void Check(bool forceCheck = false);
 
@@ -247,6 +259,9 @@ public:
         lastPing = CMasternodePing();
     }
 
+    /// Hash of CMasternodeBroadcast(*this), recomputed only after sigTime changed
+    uint256 GetBroadcastHash() const;
+
     bool IsEnabled() const
     {
         return activeState == MASTERNODE_ENABLED;
@@ -285,8 +300,11 @@ public:
         return strStatus;
     }
 
-    int64_t GetLastPaid() const;
+    int64_t GetLastPaid(int nEnabledCount = -1) const;
 
+    //! Lowest height at which a payment can still be used as a stake pointer
+    static int GetPaymentWindowStart(int nTipHeight);
+    bool GetRecentPayments(std::vector<NodePayment>& vPayments, bool limitMostRecent = false) const;
     bool GetRecentPaymentBlocks(std::vector<const CBlockIndex*>& vPaymentBlocks, bool limitMostRecent = false) const;
 };
 
@@ -306,6 +324,8 @@ public:
 
     bool CheckAndUpdate(int& nDoS, CConnman& connman);
     bool CheckInputsAndAdd(int& nDos, CConnman& connman);
+    //! The message covered by the signature, see CLegacySigner::GetMessageHash
+    std::string GetSignatureMessage() const;
     bool Sign(const CKey& keyCollateralAddress);
     bool VerifySignature() const;
     void Relay(CConnman& connman) const;
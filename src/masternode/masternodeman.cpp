@@ -22,28 +22,36 @@
 CMasternodeMan mnodeman;
 
 struct CompareLastPaid {
-    bool operator()(const std::pair<int64_t, CTxIn>& t1,
-        const std::pair<int64_t, CTxIn>& t2) const
+    bool operator()(const std::pair<int64_t, CMasternode*>& t1,
+        const std::pair<int64_t, CMasternode*>& t2) const
     {
         return t1.first < t2.first;
     }
 };
 
-struct CompareScoreTxIn {
-    bool operator()(const std::pair<int64_t, CTxIn>& t1,
-        const std::pair<int64_t, CTxIn>& t2) const
+struct CompareScoreOutPoint {
+    bool operator()(const std::pair<int64_t, COutPoint>& t1,
+        const std::pair<int64_t, COutPoint>& t2) const
     {
         return t1.first < t2.first;
     }
 };
 
-struct CompareScoreMN {
-    bool operator()(const std::pair<int64_t, CMasternode>& t1,
-        const std::pair<int64_t, CMasternode>& t2) const
-    {
-        return t1.first < t2.first;
-    }
-};
+// byte keys for the lookup indexes
+static std::vector<unsigned char> IndexKey(const CPubKey& pubkey)
+{
+    return std::vector<unsigned char>(pubkey.begin(), pubkey.end());
+}
+
+static std::vector<unsigned char> IndexKey(const CScript& script)
+{
+    return std::vector<unsigned char>(script.begin(), script.end());
+}
+
+static std::vector<unsigned char> IndexKey(const CService& addr)
+{
+    return addr.GetKey();
+}
 
 CMasternodeMan::CMasternodeMan()
 {
@@ -85,7 +93,7 @@ void CMasternodeMan::AskForMN(CNode* pnode, const CTxIn& vin, CConnman& connman)
 
 void CMasternodeMan::Check()
 {
-    LOCK(cs);
+    LOCK2(cs_main, cs);
 
     for (auto& mn : vMasternodes) {
         mn.Check();
@@ -176,38 +184,55 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
             }
         }
 
-        int nInvCount = 0;
-        for (const auto& mn : vMasternodes) {
-            if (mn.IsEnabled()) {
-                LogPrint(BCLog::MASTERNODE, "dseg - Sending Masternode entry - %s \n", mn.addr.ToString());
-                if (vin == CTxIn() || vin == mn.vin) {
-                    CMasternodeBroadcast mnb = CMasternodeBroadcast(mn);
-                    uint256 hash = mnb.GetHash();
-                    pfrom->PushInventory(CInv(MSG_MASTERNODE_ANNOUNCE, hash));
-                    nInvCount++;
-                    if (!mapSeenMasternodeBroadcast.count(hash)) {
-                        mapSeenMasternodeBroadcast.insert(std::make_pair(hash, mnb));
-                    }
-                    if (vin == mn.vin) {
-                        LogPrint(BCLog::MASTERNODE, "dseg - Sent 1 Masternode entries to %s\n", pfrom->addr.ToString());
-                        return;
-                    }
-                }
+        LOCK(cs);
+        if (vin == CTxIn()) {
+            UpdateDsegInventory();
+            for (const auto& inv : vecDsegInventory) {
+                pfrom->PushInventory(CInv(MSG_MASTERNODE_ANNOUNCE, inv.first));
+                if (!mapSeenMasternodeBroadcast.count(inv.first))
+                    mapSeenMasternodeBroadcast.insert(std::make_pair(inv.first, CMasternodeBroadcast(vMasternodes[inv.second])));
             }
-        }
 
-        if (vin == CTxIn()) {
+            int nInvCount = vecDsegInventory.size();
             const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MNSYNCSTATUS, MASTERNODE_SYNC_LIST, nInvCount));
             LogPrint(BCLog::MASTERNODE, "dseg - Sent %d Masternode entries to %s\n", nInvCount, pfrom->addr.ToString());
+        } else {
+            CMasternode* pmn = Find(vin);
+            if (pmn && pmn->IsEnabled()) {
+                uint256 hash = pmn->GetBroadcastHash();
+                pfrom->PushInventory(CInv(MSG_MASTERNODE_ANNOUNCE, hash));
+                if (!mapSeenMasternodeBroadcast.count(hash))
+                    mapSeenMasternodeBroadcast.insert(std::make_pair(hash, CMasternodeBroadcast(*pmn)));
+                LogPrint(BCLog::MASTERNODE, "dseg - Sent 1 Masternode entries to %s\n", pfrom->addr.ToString());
+            }
         }
     }
 }
 
+void CMasternodeMan::UpdateDsegInventory()
+{
+    AssertLockHeld(cs);
+
+    int64_t nVersion = nListVersion;
+    if (nDsegInventoryVersion == nVersion)
+        return;
+
+    vecDsegInventory.clear();
+    for (size_t i = 0; i < vMasternodes.size(); i++) {
+        if (vMasternodes[i].IsEnabled())
+            vecDsegInventory.emplace_back(vMasternodes[i].GetBroadcastHash(), i);
+    }
+    nDsegInventoryVersion = nVersion;
+}
+
 void CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
 {
     Check();
 
+    if (fPingsUnpublished.exchange(false))
+        ++nPingVersion;
+
     LOCK(cs);
 
     //remove inactive and outdated
@@ -240,7 +265,9 @@ void CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
                 }
             }
 
+            setMasternodesChanged.insert((*it).vin.prevout);
             it = vMasternodes.erase(it);
+            NotifyMasternodeUpdates(true);
         } else {
             ++it;
         }
@@ -299,10 +326,22 @@ void CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
     }
 }
 
+void CMasternodeMan::TakeMasternodeChanges(std::set<COutPoint>& setChanged, bool& fReset)
+{
+    LOCK(cs);
+    setChanged.clear();
+    setChanged.swap(setMasternodesChanged);
+    fReset = fMasternodesReset;
+    fMasternodesReset = false;
+}
+
 void CMasternodeMan::Clear()
 {
     LOCK(cs);
     vMasternodes.clear();
+    NotifyMasternodeUpdates(true);
+    setMasternodesChanged.clear();
+    fMasternodesReset = true;
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
@@ -311,6 +350,71 @@ void CMasternodeMan::Clear()
     nDsqCount = 0;
 }
 
+void CMasternodeMan::GetSnapshot(CMasternodeMan& snapshot) const
+{
+    LOCK2(cs, snapshot.cs);
+    snapshot.vMasternodes = vMasternodes;
+    snapshot.mAskedUsForMasternodeList = mAskedUsForMasternodeList;
+    snapshot.mWeAskedForMasternodeList = mWeAskedForMasternodeList;
+    snapshot.mWeAskedForMasternodeListEntry = mWeAskedForMasternodeListEntry;
+    snapshot.nDsqCount = nDsqCount;
+    snapshot.mapSeenMasternodeBroadcast = mapSeenMasternodeBroadcast;
+    snapshot.mapSeenMasternodePing = mapSeenMasternodePing;
+}
+
+void CMasternodeMan::CheckCollaterals()
+{
+    LOCK2(cs_main, cs);
+    for (auto& mn : vMasternodes) {
+        mn.fCollateralSpent = CMasternode::CheckCollateral(mn.vin.prevout) == CMasternode::COLLATERAL_UTXO_NOT_FOUND;
+        if (mn.fCollateralSpent)
+            LogPrint(BCLog::MASTERNODE, "CMasternodeMan::CheckCollaterals -- Failed to find Masternode UTXO, masternode=%s\n", mn.vin.prevout.ToString());
+    }
+}
+
+void CMasternodeMan::UpdateCollaterals(const std::vector<COutPoint>& vRestored, const std::vector<COutPoint>& vSpent)
+{
+    LOCK(cs);
+    if (fIndexesDirty)
+        RebuildIndexes();
+
+    auto update = [this](const COutPoint& outpoint, bool fSpent) {
+        auto it = mapIndexByOutpoint.find(outpoint);
+        if (it == mapIndexByOutpoint.end())
+            return;
+        CMasternode& mn = vMasternodes[it->second];
+        if (mn.fCollateralSpent == fSpent)
+            return;
+        mn.fCollateralSpent = fSpent;
+        LogPrint(BCLog::MASTERNODE, "CMasternodeMan::UpdateCollaterals -- Masternode UTXO %s, masternode=%s\n", fSpent ? "spent" : "restored", outpoint.ToString());
+        mn.Check(true);
+    };
+
+    // an output created and spent within the same block ends up spent
+    for (const COutPoint& outpoint : vRestored)
+        update(outpoint, false);
+    for (const COutPoint& outpoint : vSpent)
+        update(outpoint, true);
+}
+
+std::shared_ptr<const MasternodeListSnapshot> CMasternodeMan::GetListSnapshot()
+{
+    if (nListSnapshotVersion != GetListVersion()) {
+        LOCK(cs);
+        int64_t nVersion = GetListVersion();
+        if (nListSnapshotVersion != nVersion) {
+            auto pSnapshot = std::make_shared<MasternodeListSnapshot>();
+            pSnapshot->nVersion = nVersion;
+            pSnapshot->vMasternodes = vMasternodes;
+            for (size_t i = 0; i < pSnapshot->vMasternodes.size(); i++)
+                pSnapshot->mapIndexByOutpoint.emplace(pSnapshot->vMasternodes[i].vin.prevout, i);
+            std::atomic_store(&pListSnapshot, std::shared_ptr<const MasternodeListSnapshot>(std::move(pSnapshot)));
+            nListSnapshotVersion = nVersion;
+        }
+    }
+    return std::atomic_load(&pListSnapshot);
+}
+
 int CMasternodeMan::CountEnabled(int protocolVersion)
 {
     int i = 0;
@@ -349,47 +453,66 @@ void CMasternodeMan::DsegUpdate(CNode* pnode, CConnman& connman)
 CMasternode* CMasternodeMan::Find(const CScript& payee)
 {
     LOCK(cs);
-    CScript payee2;
+    if (fIndexesDirty)
+        RebuildIndexes();
 
-    for (CMasternode& mn : vMasternodes) {
-        payee2 = GetScriptForDestination(PKHash(mn.pubkey));
-        if (payee2 == payee)
-            return &mn;
-    }
-    return nullptr;
+    auto it = mapIndexByPayee.find(IndexKey(payee));
+    return it != mapIndexByPayee.end() ? &vMasternodes[it->second] : nullptr;
 }
 
 CMasternode* CMasternodeMan::Find(const CTxIn& vin)
 {
     LOCK(cs);
+    if (fIndexesDirty)
+        RebuildIndexes();
 
-    for (auto& mn : vMasternodes) {
-        if (mn.vin.prevout == vin.prevout)
-            return &mn;
-    }
-    return nullptr;
+    auto it = mapIndexByOutpoint.find(vin.prevout);
+    return it != mapIndexByOutpoint.end() ? &vMasternodes[it->second] : nullptr;
 }
 
 CMasternode* CMasternodeMan::Find(const CPubKey& pubKeyMasternode)
 {
     LOCK(cs);
+    if (fIndexesDirty)
+        RebuildIndexes();
 
-    for (auto& mn : vMasternodes) {
-        if (mn.pubkey2 == pubKeyMasternode)
-            return &mn;
-    }
-    return nullptr;
+    auto it = mapIndexByPubKey.find(IndexKey(pubKeyMasternode));
+    return it != mapIndexByPubKey.end() ? &vMasternodes[it->second] : nullptr;
 }
 
 CMasternode* CMasternodeMan::Find(const CService& addr)
 {
     LOCK(cs);
+    if (fIndexesDirty)
+        RebuildIndexes();
 
-    for (auto& mn : vMasternodes) {
-        if (mn.addr == addr)
-            return &mn;
+    auto it = mapIndexByService.find(IndexKey(addr));
+    return it != mapIndexByService.end() ? &vMasternodes[it->second] : nullptr;
+}
+
+void CMasternodeMan::IndexMasternode(size_t nPos)
+{
+    AssertLockHeld(cs);
+
+    const CMasternode& mn = vMasternodes[nPos];
+    mapIndexByOutpoint.emplace(mn.vin.prevout, nPos);
+    mapIndexByPubKey.emplace(IndexKey(mn.pubkey2), nPos);
+    mapIndexByPayee.emplace(IndexKey(GetScriptForDestination(PKHash(mn.pubkey))), nPos);
+    mapIndexByService.emplace(IndexKey(mn.addr), nPos);
+}
+
+void CMasternodeMan::RebuildIndexes()
+{
+    AssertLockHeld(cs);
+
+    fIndexesDirty = false;
+    mapIndexByOutpoint.clear();
+    mapIndexByPubKey.clear();
+    mapIndexByPayee.clear();
+    mapIndexByService.clear();
+    for (size_t i = 0; i < vMasternodes.size(); i++) {
+        IndexMasternode(i);
     }
-    return nullptr;
 }
 
 //
@@ -397,23 +520,28 @@ CMasternode* CMasternodeMan::Find(const CService& addr)
 //
 CMasternode* CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCount)
 {
-    LOCK(cs);
+    LOCK2(cs_main, cs);
 
     CMasternode* pBestMasternode = nullptr;
-    std::vector<std::pair<int64_t, CTxIn>> vecMasternodeLastPaid;
+    std::vector<std::pair<int64_t, CMasternode*>> vecMasternodeLastPaid;
 
     /*
         Make a vector with all of the last paid times
     */
 
     int nMnCount = CountEnabled();
+
+    // collect everyone scheduled in the next blocks once instead of probing the payment votes per node
+    std::set<CScript> setScheduledPayees;
+    masternodePayments.GetScheduledPayees(nBlockHeight, setScheduledPayees);
+
     for (auto& mn : vMasternodes) {
         mn.Check();
         if (!mn.IsEnabled())
             continue;
 
         //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
-        if (masternodePayments.IsScheduled(mn, nBlockHeight))
+        if (setScheduledPayees.count(GetScriptForDestination(PKHash(mn.pubkey))))
             continue;
 
         // For security reasons and for network stability there is a delay to get the first reward.
@@ -425,7 +553,7 @@ CMasternode* CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight
         if (mn.GetMasternodeInputAge() < nMnCount)
             continue;
 
-        vecMasternodeLastPaid.push_back(std::make_pair(mn.SecondsSincePayment(), mn.vin));
+        vecMasternodeLastPaid.push_back(std::make_pair(mn.SecondsSincePayment(nMnCount), &mn));
     }
 
     nCount = (int)vecMasternodeLastPaid.size();
@@ -441,13 +569,11 @@ CMasternode* CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight
     //  -- This doesn't look at who is being paid in the +8-10 blocks, allowing for double payments very rarely
     //  -- 1/100 payments should be a double payment on mainnet - (1/(3000/10))*2
     //  -- (chance per block * chances before IsScheduled will fire)
-    int nTenthNetwork = CountEnabled() / 10;
+    int nTenthNetwork = nMnCount / 10;
     int nCountTenth = 0;
     arith_uint256 nHigh = 0;
     for (auto& s : vecMasternodeLastPaid) {
-        CMasternode* pmn = Find(s.second);
-        if (!pmn)
-            break;
+        CMasternode* pmn = s.second;
 
         arith_uint256 n = pmn->CalculateScore(nBlockHeight - 100);
         if (n > nHigh) {
@@ -472,6 +598,10 @@ bool CMasternodeMan::Add(const CMasternode& mn)
     if (!pmn) {
         LogPrint(BCLog::MASTERNODE, "CMasternodeMan: Adding new Masternode %s - %i now\n", mn.addr.ToString(), size() + 1);
         vMasternodes.push_back(mn);
+        setMasternodesChanged.insert(mn.vin.prevout);
+        if (!fIndexesDirty)
+            IndexMasternode(vMasternodes.size() - 1);
+        NotifyMasternodeUpdates();
         return true;
     }
 
@@ -480,7 +610,7 @@ bool CMasternodeMan::Add(const CMasternode& mn)
 
 CMasternode* CMasternodeMan::FindRandomNotInVec(std::vector<CTxIn>& vecToExclude, int protocolVersion)
 {
-    LOCK(cs);
+    LOCK2(cs_main, cs);
 
     protocolVersion = protocolVersion == -1 ? masternodePayments.GetMinMasternodePaymentsProto() : protocolVersion;
 
@@ -515,6 +645,8 @@ CMasternode* CMasternodeMan::FindRandomNotInVec(std::vector<CTxIn>& vecToExclude
 
 CMasternode* CMasternodeMan::GetCurrentMasterNode(int mod, int64_t nBlockHeight, int minProtocol)
 {
+    LOCK2(cs_main, cs);
+
     int64_t score = 0;
     CMasternode* winner = nullptr;
 
@@ -538,70 +670,97 @@ CMasternode* CMasternodeMan::GetCurrentMasterNode(int mod, int64_t nBlockHeight,
     return winner;
 }
 
-int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
+const CMasternodeMan::CMasternodeScores* CMasternodeMan::GetScores(int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
 {
-    std::vector<std::pair<int64_t, CTxIn> > vecMasternodeScores;
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs);
 
     //make sure we know about this block
     uint256 hash = uint256();
     if (!GetBlockHash(hash, nBlockHeight))
-        return -1;
+        return nullptr;
 
-    // scan for winner
-    for (auto& mn : vMasternodes) {
-        if (mn.protocolVersion < minProtocol)
-            continue;
-        if (fOnlyActive) {
+    // scores depend on the tip through the collateral age, so the cache only lives for one tip and list version
+    const CBlockIndex* pindexTip = ::ChainActive().Tip();
+    uint256 hashTip = pindexTip ? pindexTip->GetBlockHash() : uint256();
+    if (hashTip != hashRankCacheTip || nListVersion != nRankCacheVersion) {
+        mapRankCache.clear();
+        hashRankCacheTip = hashTip;
+        nRankCacheVersion = nListVersion;
+    }
+
+    const auto key = std::make_tuple(nBlockHeight, minProtocol, fOnlyActive);
+    auto it = mapRankCache.find(key);
+    if (it != mapRankCache.end())
+        return &it->second;
+
+    if (fOnlyActive) {
+        for (auto& mn : vMasternodes)
             mn.Check();
-            if (!mn.IsEnabled())
-                continue;
+        // state changes found by the checks above invalidate what is cached
+        if (nListVersion != nRankCacheVersion) {
+            mapRankCache.clear();
+            nRankCacheVersion = nListVersion;
         }
+    }
+
+    if (mapRankCache.size() >= MASTERNODE_RANK_CACHE_SIZE)
+        mapRankCache.clear();
+
+    CMasternodeScores& scores = mapRankCache[key];
+    scores.vecScores.reserve(vMasternodes.size());
+    for (const auto& mn : vMasternodes) {
+        if (mn.protocolVersion < minProtocol)
+            continue;
+        if (fOnlyActive && !mn.IsEnabled())
+            continue;
         arith_uint256 n = mn.CalculateScore(nBlockHeight);
         int64_t n2 = n.GetCompact(false);
 
-        vecMasternodeScores.push_back(std::make_pair(n2, mn.vin));
+        scores.vecScores.emplace_back(n2, mn.vin.prevout);
     }
 
-    std::sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreTxIn());
+    std::sort(scores.vecScores.rbegin(), scores.vecScores.rend(), CompareScoreOutPoint());
 
+    scores.mapRanks.reserve(scores.vecScores.size());
     int rank = 0;
-    for (const auto& s : vecMasternodeScores) {
-        rank++;
-        if (s.second.prevout == vin.prevout) {
-            return rank;
-        }
+    for (const auto& s : scores.vecScores) {
+        scores.mapRanks.emplace(s.second, ++rank);
     }
 
-    return -1;
+    return &scores;
+}
+
+int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
+{
+    LOCK2(cs_main, cs);
+
+    const CMasternodeScores* pscores = GetScores(nBlockHeight, minProtocol, fOnlyActive);
+    if (!pscores)
+        return -1;
+
+    auto it = pscores->mapRanks.find(vin.prevout);
+    if (it == pscores->mapRanks.end())
+        return -1;
+
+    return it->second;
 }
 
 std::vector<std::pair<int, CMasternode> > CMasternodeMan::GetMasternodeRanks(int64_t nBlockHeight, int minProtocol)
 {
-    std::vector<std::pair<int64_t, CMasternode> > vecMasternodeScores;
     std::vector<std::pair<int, CMasternode> > vecMasternodeRanks;
 
-    //make sure we know about this block
-    uint256 hash = uint256();
-    if (!GetBlockHash(hash, nBlockHeight))
-        return vecMasternodeRanks;
+    LOCK2(cs_main, cs);
 
-    // scan for winner
-    for (auto& mn : vMasternodes) {
-        mn.Check();
-        if (mn.protocolVersion < minProtocol)
-            continue;
-        if (!mn.IsEnabled())
-            continue;
-        arith_uint256 n = mn.CalculateScore(nBlockHeight);
-        int64_t n2 = n.GetCompact(false);
-        vecMasternodeScores.push_back(std::make_pair(n2, mn));
-    }
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
+    const CMasternodeScores* pscores = GetScores(nBlockHeight, minProtocol, true);
+    if (!pscores)
+        return vecMasternodeRanks;
 
-    int rank = 0;
-    for (const auto& s : vecMasternodeScores) {
-        rank++;
-        vecMasternodeRanks.push_back(std::make_pair(rank, s.second));
+    vecMasternodeRanks.resize(pscores->vecScores.size());
+    for (const auto& mn : vMasternodes) {
+        auto it = pscores->mapRanks.find(mn.vin.prevout);
+        if (it != pscores->mapRanks.end())
+            vecMasternodeRanks[it->second - 1] = std::make_pair(it->second, mn);
     }
 
     return vecMasternodeRanks;
@@ -609,35 +768,13 @@ std::vector<std::pair<int, CMasternode> > CMasternodeMan::GetMasternodeRanks(int
 
 CMasternode* CMasternodeMan::GetMasternodeByRank(int nRank, int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
 {
-    std::vector<std::pair<int64_t, CTxIn>> vecMasternodeScores;
+    LOCK2(cs_main, cs);
 
-    // scan for winner
-    for (auto& mn : vMasternodes) {
-        if (mn.protocolVersion < minProtocol)
-            continue;
-        if (fOnlyActive) {
-            mn.Check();
-            if (!mn.IsEnabled())
-                continue;
-        }
-
-        arith_uint256 n = mn.CalculateScore(nBlockHeight);
-        int64_t n2 = n.GetCompact(false);
-
-        vecMasternodeScores.push_back(std::make_pair(n2, mn.vin));
-    }
-
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreTxIn());
-
-    int rank = 0;
-    for (const auto& s : vecMasternodeScores) {
-        rank++;
-        if (rank == nRank) {
-            return Find(s.second);
-        }
-    }
+    const CMasternodeScores* pscores = GetScores(nBlockHeight, minProtocol, fOnlyActive);
+    if (!pscores || nRank < 1 || nRank > (int)pscores->vecScores.size())
+        return nullptr;
 
-    return nullptr;
+    return Find(CTxIn(pscores->vecScores[nRank - 1].second));
 }
 
 void CMasternodeMan::ProcessMasternodeConnections(CConnman& connman)
@@ -661,7 +798,9 @@ void CMasternodeMan::Remove(CTxIn vin)
     while (it != vMasternodes.end()) {
         if ((*it).vin == vin) {
             LogPrint(BCLog::MASTERNODE, "CMasternodeMan: Removing Masternode %s - %i now\n", (*it).addr.ToString(), size() - 1);
+            setMasternodesChanged.insert((*it).vin.prevout);
             vMasternodes.erase(it);
+            NotifyMasternodeUpdates(true);
             break;
         }
         ++it;
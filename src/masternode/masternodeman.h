@@ -11,20 +11,42 @@
 #include <key.h>
 #include <util/system.h>
 #include <base58.h>
+#include <util/bytevectorhash.h>
 #include <validation.h>
 #include <masternode/masternode.h>
 
+#include <atomic>
+#include <memory>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+
 #define MASTERNODES_DUMP_SECONDS (15 * 60)
 #define MASTERNODES_DSEG_SECONDS (3 * 60 * 60)
+#define MASTERNODE_RANK_CACHE_SIZE 64
 
 class CMasternodeMan;
 
+/** Immutable copy of the masternode list handed to readers, replaced as a whole when the list changes */
+struct MasternodeListSnapshot {
+    int64_t nVersion;
+    std::vector<CMasternode> vMasternodes;
+    // positions in vMasternodes by collateral outpoint, the first entry wins on duplicates
+    std::unordered_map<COutPoint, size_t, SaltedOutpointHasher> mapIndexByOutpoint;
+
+    const CMasternode* Find(const COutPoint& outpoint) const
+    {
+        auto it = mapIndexByOutpoint.find(outpoint);
+        return it != mapIndexByOutpoint.end() ? &vMasternodes[it->second] : nullptr;
+    }
+};
+
 extern CMasternodeMan mnodeman;
 void DumpMasternodes();
 
 class CMasternodeMan {
 private:
-    // critical section to protect the inner data structures
+    // critical section to protect the inner data structures, taken after cs_main when both are needed
     mutable RecursiveMutex cs;
 
     // critical section to protect the inner data structures specifically on messaging
@@ -44,11 +66,55 @@ private:
     std::map<uint256, std::vector<CMasternodeBroadcast>> mMnbRecoveryGoodReplies;
     std::list<std::pair<CService, uint256>> listScheduledMnbRequestConnections;
 
-    /// Set when masternodes are added, cleared when CGovernanceManager is notified
-    bool fMasternodesAdded;
+    /// Collaterals of the entries added or removed since the budget manager last took them
+    std::set<COutPoint> setMasternodesChanged;
+
+    /// Set when the whole list was replaced, cleared when the budget manager takes the changes
+    bool fMasternodesReset{true};
+
+    // scores of the masternode list at one height, sorted from the highest to the lowest
+    struct CMasternodeScores {
+        std::vector<std::pair<int64_t, COutPoint>> vecScores;
+        std::unordered_map<COutPoint, int, SaltedOutpointHasher> mapRanks;
+    };
+
+    // (height, min protocol, only active) => scores, valid for hashRankCacheTip and nRankCacheVersion only
+    std::map<std::tuple<int64_t, int, bool>, CMasternodeScores> mapRankCache;
+    uint256 hashRankCacheTip;
+    int64_t nRankCacheVersion{-1};
+
+    /// Bumped whenever an entry is added, removed or changes its state
+    std::atomic<int64_t> nListVersion{0};
+    /// Bumped by CheckAndRemove when entries received pings since its last pass, so the
+    /// snapshot shows recent last-seen times without being copied again for every ping
+    std::atomic<int64_t> nPingVersion{0};
+    std::atomic<bool> fPingsUnpublished{false};
+
+    // list published to readers by GetListSnapshot and the list version it was taken at
+    std::shared_ptr<const MasternodeListSnapshot> pListSnapshot;
+    std::atomic<int64_t> nListSnapshotVersion{-1};
+
+    // positions in vMasternodes by collateral outpoint, pubkey2, payee script and service, the first entry wins on duplicates
+    std::unordered_map<COutPoint, size_t, SaltedOutpointHasher> mapIndexByOutpoint;
+    std::unordered_map<std::vector<unsigned char>, size_t, ByteVectorHash> mapIndexByPubKey;
+    std::unordered_map<std::vector<unsigned char>, size_t, ByteVectorHash> mapIndexByPayee;
+    std::unordered_map<std::vector<unsigned char>, size_t, ByteVectorHash> mapIndexByService;
+    /// Set when entries were removed or their keys changed, the indexes are rebuilt on the next lookup
+    std::atomic<bool> fIndexesDirty{true};
+
+    // broadcast hashes of the enabled entries and their positions in vMasternodes, announced to peers
+    // asking for the whole list, valid for nDsegInventoryVersion only
+    std::vector<std::pair<uint256, size_t>> vecDsegInventory;
+    int64_t nDsegInventoryVersion{-1};
 
-    /// Set when masternodes are removed, cleared when CGovernanceManager is notified
-    bool fMasternodesRemoved;
+    /// Rebuild the list announced to DSEG requests if the list changed since it was built
+    void UpdateDsegInventory();
+
+    void IndexMasternode(size_t nPos);
+    void RebuildIndexes();
+
+    /// Return the cached scores for this height, nullptr if the block is unknown
+    const CMasternodeScores* GetScores(int64_t nBlockHeight, int minProtocol, bool fOnlyActive);
 
 public:
     // Keep track of all broadcasts I've seen
@@ -70,6 +136,8 @@ public:
         READWRITE(obj.nDsqCount);
         READWRITE(obj.mapSeenMasternodeBroadcast);
         READWRITE(obj.mapSeenMasternodePing);
+        SER_READ(obj, obj.NotifyMasternodeUpdates(true));
+        SER_READ(obj, obj.fMasternodesReset = true);
     }
 
     CMasternodeMan();
@@ -90,9 +158,21 @@ public:
     /// Check all Masternodes and remove inactive
     void CheckAndRemove(bool forceExpiredRemoval = false);
 
+    /// Move the collaterals of the entries added or removed since the last call into setChanged,
+    /// fReset tells whether the whole list was replaced since
+    void TakeMasternodeChanges(std::set<COutPoint>& setChanged, bool& fReset);
+
     /// Clear Masternode vector
     void Clear();
 
+    /// Copy the state stored in mncache.dat into an empty manager, so it can be written without holding cs
+    void GetSnapshot(CMasternodeMan& snapshot) const;
+
+    /// Look up every collateral in the UTXO set, done once after the cache is loaded
+    void CheckCollaterals();
+    /// Flag the masternodes whose collateral was restored or spent by a connected or disconnected block
+    void UpdateCollaterals(const std::vector<COutPoint>& vRestored, const std::vector<COutPoint>& vSpent);
+
     int CountEnabled(int protocolVersion = -1);
 
     void DsegUpdate(CNode* pnode, CConnman& connman);
@@ -112,11 +192,8 @@ public:
     /// Get the current winner for this block
     CMasternode* GetCurrentMasterNode(int mod = 1, int64_t nBlockHeight = 0, int minProtocol = 0);
 
-    std::vector<CMasternode> GetFullMasternodeVector()
-    {
-        Check();
-        return vMasternodes;
-    }
+    /// Return the current list without copying it, it is only copied again once the list version changed
+    std::shared_ptr<const MasternodeListSnapshot> GetListSnapshot();
 
     std::vector<std::pair<int, CMasternode>> GetMasternodeRanks(int64_t nBlockHeight, int minProtocol = 0);
     int GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol = 0, bool fOnlyActive = true);
@@ -124,6 +201,24 @@ public:
 
     void ProcessMasternodeConnections(CConnman& connman);
 
+    /// Invalidate the cached ranks after an entry changed its state or protocol, and the lookup indexes if its keys changed
+    void NotifyMasternodeUpdates(bool fKeysChanged = false)
+    {
+        ++nListVersion;
+        if (fKeysChanged)
+            fIndexesDirty = true;
+    }
+
+    /// Record a new ping of an entry, published to the list snapshot on the next CheckAndRemove
+    void NotifyMasternodePing() { fPingsUnpublished = true; }
+
+    /// Changes whenever the list or the state of an entry changed, and at most once per CheckAndRemove for pings
+    int64_t GetListVersion() const { return nListVersion + nPingVersion; }
+
+    /// Whether this broadcast or ping was seen already, safe to call from other threads
+    bool HasSeenBroadcast(const uint256& hash) const { LOCK(cs); return mapSeenMasternodeBroadcast.count(hash); }
+    bool HasSeenPing(const uint256& hash) const { LOCK(cs); return mapSeenMasternodePing.count(hash); }
+
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman);
 
     /// Return the number of (unique) Masternodes
@@ -12,6 +12,7 @@
 #include <util/strencodings.h>
 
 #include <crown/instantx.h>
+#include <crown/legacysigner.h>
 #include <crown/spork.h>
 #include <masternode/masternodeman.h>
 #include <systemnode/systemnodeman.h>
@@ -19,8 +20,11 @@
 #include <masternode/masternode-payments.h>
 #include <systemnode/systemnode-payments.h>
 
+#include <functional>
 #include <memory>
+#include <set>
 #include <typeinfo>
+#include <unordered_map>
 
 #if defined(NDEBUG)
 # error "Crown cannot be compiled without assertions."
@@ -221,17 +225,259 @@ void ProcessGetDataMasternodeTypes(CNode* pfrom, const CChainParams& chainparams
 #define RETURN_ON_CONDITION(condition)  \
         if (condition) { return true; }
 
+typedef std::function<void(CNode* pfrom, const std::string& msg_type, CDataStream& vRecv, CConnman* connman)> MasternodeMessageHandler;
+
+//! Most queued messages of one peer whose signatures are recovered in one batch
+static const size_t MAX_SIGNATURE_LOOKAHEAD = 1000;
+
+static bool IsSignedMessageType(const std::string& msg_type)
+{
+    static const std::set<std::string> setSignedTypes = {
+        NetMsgType::MNBROADCAST, NetMsgType::MNBROADCAST2, NetMsgType::MNPING, NetMsgType::MNPING2,
+        NetMsgType::SNBROADCAST, NetMsgType::SNPING, NetMsgType::MNWINNER, NetMsgType::SNWINNER,
+        NetMsgType::BUDGETVOTE, NetMsgType::FINALBUDGETVOTE, NetMsgType::IXLOCKVOTE};
+    return setSignedTypes.count(msg_type);
+}
+
+// Deserialize a signed message once, returning its hash and the (hash, signature) pairs its handler is going to verify
+static bool GetMessageSignatures(const std::string& msg_type, CDataStream& vRecv, uint256& hashRet, std::vector<std::pair<uint256, std::vector<unsigned char>>>& vSignatures)
+{
+    try {
+        if (msg_type == NetMsgType::MNBROADCAST || msg_type == NetMsgType::MNBROADCAST2) {
+            CMasternodeBroadcast mnb;
+            mnb.lastPing.nVersion = (msg_type == NetMsgType::MNBROADCAST ? 1 : 2);
+            vRecv >> mnb;
+            hashRet = mnb.GetHash();
+            vSignatures.emplace_back(CLegacySigner::GetMessageHash(mnb.GetSignatureMessage()), mnb.sig);
+            if (mnb.lastPing != CMasternodePing())
+                vSignatures.emplace_back(CLegacySigner::GetMessageHash(mnb.lastPing.GetSignatureMessage()), mnb.lastPing.vchSig);
+        } else if (msg_type == NetMsgType::MNPING || msg_type == NetMsgType::MNPING2) {
+            CMasternodePing mnp;
+            if (msg_type == NetMsgType::MNPING)
+                mnp.nVersion = 1;
+            vRecv >> mnp;
+            hashRet = mnp.GetHash();
+            vSignatures.emplace_back(CLegacySigner::GetMessageHash(mnp.GetSignatureMessage()), mnp.vchSig);
+        } else if (msg_type == NetMsgType::SNBROADCAST) {
+            CSystemnodeBroadcast snb;
+            vRecv >> snb;
+            hashRet = snb.GetHash();
+            vSignatures.emplace_back(CLegacySigner::GetMessageHash(snb.GetSignatureMessage()), snb.sig);
+            if (snb.lastPing != CSystemnodePing())
+                vSignatures.emplace_back(CLegacySigner::GetMessageHash(snb.lastPing.GetSignatureMessage()), snb.lastPing.vchSig);
+        } else if (msg_type == NetMsgType::SNPING) {
+            CSystemnodePing snp;
+            vRecv >> snp;
+            hashRet = snp.GetHash();
+            vSignatures.emplace_back(CLegacySigner::GetMessageHash(snp.GetSignatureMessage()), snp.vchSig);
+        } else if (msg_type == NetMsgType::MNWINNER) {
+            CMasternodePaymentWinner winner;
+            vRecv >> winner;
+            hashRet = winner.GetHash();
+            vSignatures.emplace_back(CLegacySigner::GetMessageHash(winner.GetSignatureMessage()), winner.vchSig);
+        } else if (msg_type == NetMsgType::SNWINNER) {
+            CSystemnodePaymentWinner winner;
+            vRecv >> winner;
+            hashRet = winner.GetHash();
+            vSignatures.emplace_back(CLegacySigner::GetMessageHash(winner.GetSignatureMessage()), winner.vchSig);
+        } else if (msg_type == NetMsgType::BUDGETVOTE) {
+            CBudgetVote vote;
+            vRecv >> vote;
+            hashRet = vote.GetHash();
+            vSignatures.emplace_back(CLegacySigner::GetMessageHash(vote.GetSignatureMessage()), vote.vchSig);
+        } else if (msg_type == NetMsgType::FINALBUDGETVOTE) {
+            BudgetDraftVote vote;
+            vRecv >> vote;
+            hashRet = vote.GetHash();
+            vSignatures.emplace_back(CLegacySigner::GetMessageHash(vote.GetSignatureMessage()), vote.vchSig);
+        } else if (msg_type == NetMsgType::IXLOCKVOTE) {
+            CConsensusVote vote;
+            vRecv >> vote;
+            hashRet = vote.GetHash();
+            vSignatures.emplace_back(CLegacySigner::GetMessageHash(vote.GetSignatureMessage()), vote.vchMasterNodeSignature);
+        } else {
+            return false;
+        }
+    } catch (const std::exception&) {
+        // malformed messages are rejected by their handler
+        return false;
+    }
+    return true;
+}
+
+// Whether the handler drops the signed message with this hash before verifying it, as in AlreadyHaveMasternodeTypes
+static bool IsKnownSignedMessage(const std::string& msg_type, const uint256& hash)
+{
+    if (msg_type == NetMsgType::MNBROADCAST || msg_type == NetMsgType::MNBROADCAST2)
+        return mnodeman.HasSeenBroadcast(hash);
+    if (msg_type == NetMsgType::MNPING || msg_type == NetMsgType::MNPING2)
+        return mnodeman.HasSeenPing(hash);
+    if (msg_type == NetMsgType::SNBROADCAST)
+        return snodeman.HasSeenBroadcast(hash);
+    if (msg_type == NetMsgType::SNPING)
+        return snodeman.HasSeenPing(hash);
+    if (msg_type == NetMsgType::MNWINNER)
+        return masternodePayments.HasPayeeVote(hash);
+    if (msg_type == NetMsgType::SNWINNER)
+        return systemnodePayments.HasPayeeVote(hash);
+    if (msg_type == NetMsgType::BUDGETVOTE || msg_type == NetMsgType::FINALBUDGETVOTE)
+        return budget.HasItem(hash);
+    if (msg_type == NetMsgType::IXLOCKVOTE)
+        return instantSend.AlreadyHave(hash);
+    return false;
+}
+
+// Add the signatures of a signed message unless its handler is going to drop it as already known
+static void AddUnknownMessageSignatures(const std::string& msg_type, CDataStream& vRecv, std::vector<std::pair<uint256, std::vector<unsigned char>>>& vSignatures)
+{
+    uint256 hash;
+    std::vector<std::pair<uint256, std::vector<unsigned char>>> vMessageSignatures;
+    if (!GetMessageSignatures(msg_type, vRecv, hash, vMessageSignatures) || IsKnownSignedMessage(msg_type, hash))
+        return;
+    vSignatures.insert(vSignatures.end(), vMessageSignatures.begin(), vMessageSignatures.end());
+}
+
+/*
+ * A list sync delivers thousands of signed messages in a burst. When a signed message arrives that
+ * was not covered by an earlier batch, the signatures of the signed messages still queued for the
+ * peer are recovered together with it on the legacy signature check threads, and the handlers
+ * then pick up the outcomes instead of recovering each key on the message handler thread.
+ * Messages their handler drops as already known are left out of the batch.
+ */
+static void PreverifyQueuedSignatures(CNode* pfrom, const std::string& msg_type, const CDataStream& vRecv)
+{
+    std::vector<std::pair<uint256, std::vector<unsigned char>>> vSignatures;
+    {
+        CDataStream vMessage(vRecv);
+        AddUnknownMessageSignatures(msg_type, vMessage, vSignatures);
+    }
+    if (vSignatures.empty() || IsLegacySignaturePreverified(vSignatures[0].first, vSignatures[0].second))
+        return;
+
+    // Only this thread takes messages off vProcessMsg, the socket thread splices new ones onto its
+    // end, so the queued messages stay in place once the lock is released
+    std::vector<const CNetMessage*> vQueued;
+    {
+        LOCK(pfrom->cs_vProcessMsg);
+        for (const CNetMessage& msg : pfrom->vProcessMsg) {
+            if (vQueued.size() >= MAX_SIGNATURE_LOOKAHEAD)
+                break;
+            if (IsSignedMessageType(msg.m_command))
+                vQueued.push_back(&msg);
+        }
+    }
+
+    for (const CNetMessage* pmsg : vQueued) {
+        CDataStream vMessage(pmsg->m_recv.begin(), pmsg->m_recv.end(), SER_NETWORK, pfrom->GetCommonVersion());
+        AddUnknownMessageSignatures(pmsg->m_command, vMessage, vSignatures);
+    }
+
+    // a lone message is cheaper to verify inline than to hand to the workers
+    if (vSignatures.size() > 1)
+        PreverifyLegacySignatures(vSignatures);
+}
+
+/*
+ * Routes every masternode family message to the one handler registered for its type, so
+ * unrelated handlers no longer compare the type or take their locks, and counts the traffic
+ * and handler latency of each type. The table is fixed once constructed, only the counters change.
+ */
+class CMasternodeMessageDispatcher
+{
+private:
+    struct HandlerEntry {
+        MasternodeMessageHandler handler;
+        std::atomic<uint64_t> nCount{0};
+        std::atomic<uint64_t> nBytes{0};
+        std::atomic<int64_t> nTotalMicros{0};
+        std::array<std::atomic<uint64_t>, MN_MESSAGE_LATENCY_BUCKETS> vLatency{};
+    };
+
+    std::unordered_map<std::string, HandlerEntry> mapHandlers;
+
+    void Register(std::initializer_list<const char*> vMsgTypes, const MasternodeMessageHandler& handler)
+    {
+        for (const char* msg_type : vMsgTypes) {
+            assert(!mapHandlers.count(msg_type));
+            mapHandlers[msg_type].handler = handler;
+        }
+    }
+
+public:
+    CMasternodeMessageDispatcher()
+    {
+        Register({NetMsgType::MNBROADCAST, NetMsgType::MNBROADCAST2, NetMsgType::MNPING, NetMsgType::MNPING2, NetMsgType::DSEG},
+            [](CNode* pfrom, const std::string& msg_type, CDataStream& vRecv, CConnman* connman) { mnodeman.ProcessMessage(pfrom, msg_type, vRecv, connman); });
+        Register({NetMsgType::SNBROADCAST, NetMsgType::SNPING, NetMsgType::SNDSEG},
+            [](CNode* pfrom, const std::string& msg_type, CDataStream& vRecv, CConnman* connman) { snodeman.ProcessMessage(pfrom, msg_type, vRecv, connman); });
+        Register({NetMsgType::BUDGETVOTESYNC, NetMsgType::BUDGETPROPOSAL, NetMsgType::BUDGETVOTE, NetMsgType::FINALBUDGET, NetMsgType::FINALBUDGETVOTE},
+            [](CNode* pfrom, const std::string& msg_type, CDataStream& vRecv, CConnman* connman) { budget.ProcessMessage(pfrom, msg_type, vRecv, connman); });
+        Register({NetMsgType::GETMNWINNERS, NetMsgType::MNWINNER},
+            [](CNode* pfrom, const std::string& msg_type, CDataStream& vRecv, CConnman* connman) { masternodePayments.ProcessMessageMasternodePayments(pfrom, msg_type, vRecv, connman); });
+        Register({NetMsgType::GETSNWINNERS, NetMsgType::SNWINNER},
+            [](CNode* pfrom, const std::string& msg_type, CDataStream& vRecv, CConnman* connman) { systemnodePayments.ProcessMessageSystemnodePayments(pfrom, msg_type, vRecv, connman); });
+        Register({NetMsgType::IX, NetMsgType::IXLOCKVOTE, NetMsgType::IXLOCKLIST},
+            [](CNode* pfrom, const std::string& msg_type, CDataStream& vRecv, CConnman* connman) { instantSend.ProcessMessage(pfrom, msg_type, vRecv, connman); });
+        Register({NetMsgType::SPORK, NetMsgType::GETSPORKS},
+            [](CNode* pfrom, const std::string& msg_type, CDataStream& vRecv, CConnman* connman) { ProcessSpork(pfrom, connman, msg_type, vRecv); });
+        Register({NetMsgType::MNSYNCSTATUS},
+            [](CNode* pfrom, const std::string& msg_type, CDataStream& vRecv, CConnman* connman) { masternodeSync.ProcessMessage(pfrom, msg_type, vRecv, connman); });
+        Register({NetMsgType::SNSYNCSTATUS},
+            [](CNode* pfrom, const std::string& msg_type, CDataStream& vRecv, CConnman* connman) { systemnodeSync.ProcessMessage(pfrom, msg_type, vRecv, connman); });
+    }
+
+    void Dispatch(CNode* pfrom, const std::string& msg_type, CDataStream& vRecv, CConnman* connman)
+    {
+        auto it = mapHandlers.find(msg_type);
+        if (it == mapHandlers.end())
+            return;
+
+        HandlerEntry& entry = it->second;
+        entry.nCount++;
+        entry.nBytes += vRecv.size();
+
+        int64_t nStart = GetTimeMicros();
+        if (IsSignedMessageType(msg_type))
+            PreverifyQueuedSignatures(pfrom, msg_type, vRecv);
+        entry.handler(pfrom, msg_type, vRecv, connman);
+        int64_t nElapsed = GetTimeMicros() - nStart;
+
+        entry.nTotalMicros += nElapsed;
+        int nBucket = 0;
+        for (int64_t nBound = 10; nBucket < MN_MESSAGE_LATENCY_BUCKETS - 1 && nElapsed >= nBound; nBound *= 10)
+            nBucket++;
+        entry.vLatency[nBucket]++;
+    }
+
+    std::map<std::string, CMasternodeMessageStats> GetStats() const
+    {
+        std::map<std::string, CMasternodeMessageStats> mapStats;
+        for (const auto& pair : mapHandlers) {
+            CMasternodeMessageStats& stats = mapStats[pair.first];
+            stats.nCount = pair.second.nCount;
+            stats.nBytes = pair.second.nBytes;
+            stats.nTotalMicros = pair.second.nTotalMicros;
+            for (int i = 0; i < MN_MESSAGE_LATENCY_BUCKETS; i++)
+                stats.vLatency[i] = pair.second.vLatency[i];
+        }
+        return mapStats;
+    }
+};
+
+static CMasternodeMessageDispatcher& GetMessageDispatcher()
+{
+    static CMasternodeMessageDispatcher dispatcher;
+    return dispatcher;
+}
+
 bool ProcessMessageMasternodeTypes(CNode* pfrom, const std::string& msg_type, CDataStream& vRecv, const CChainParams& chainparams, CTxMemPool& mempool, CConnman* connman, BanMan* banman, const std::atomic<bool>& interruptMsgProc)
 {
-    mnodeman.ProcessMessage(pfrom, msg_type, vRecv, connman);
-    snodeman.ProcessMessage(pfrom, msg_type, vRecv, connman);
-    budget.ProcessMessage(pfrom, msg_type, vRecv, connman);
-    masternodePayments.ProcessMessageMasternodePayments(pfrom, msg_type, vRecv, connman);
-    systemnodePayments.ProcessMessageSystemnodePayments(pfrom, msg_type, vRecv, connman);
-    instantSend.ProcessMessage(pfrom, msg_type, vRecv, connman);
-    ProcessSpork(pfrom, connman, msg_type, vRecv);
-    masternodeSync.ProcessMessage(pfrom, msg_type, vRecv, connman);
-    systemnodeSync.ProcessMessage(pfrom, msg_type, vRecv, connman);
+    GetMessageDispatcher().Dispatch(pfrom, msg_type, vRecv, connman);
 
     return true;
 }
+
+std::map<std::string, CMasternodeMessageStats> GetMasternodeMessageStats()
+{
+    return GetMessageDispatcher().GetStats();
+}
@@ -12,14 +12,31 @@
 #include <sync.h>
 #include <validationinterface.h>
 
+#include <array>
+#include <map>
+#include <string>
+
 class CChainParams;
 class CTxMemPool;
 
+static const int MN_MESSAGE_LATENCY_BUCKETS = 6;
+
+/** Counters of one masternode family message type */
+struct CMasternodeMessageStats {
+    uint64_t nCount{0};
+    uint64_t nBytes{0};
+    int64_t nTotalMicros{0};
+    //! handler latency histogram, bucket i counts calls faster than 10^(i+1) microseconds, the last one all slower calls
+    std::array<uint64_t, MN_MESSAGE_LATENCY_BUCKETS> vLatency{};
+};
+
 #define SET_CONDITION_FLAG(flag) flag = true;
 #define RETURN_ON_CONDITION(condition) if (condition) { return true; }
 
 bool AlreadyHaveMasternodeTypes(const CInv& inv, const CTxMemPool& mempool);
 void ProcessGetDataMasternodeTypes(CNode* pfrom, const CChainParams& chainparams, CConnman* connman, const CTxMemPool& mempool, const CInv& inv, bool& pushed) LOCKS_EXCLUDED(cs_main);
 bool ProcessMessageMasternodeTypes(CNode* pfrom, const std::string& msg_type, CDataStream& vRecv, const CChainParams& chainparams, CTxMemPool& mempool, CConnman* connman, BanMan* banman, const std::atomic<bool>& interruptMsgProc);
+/** Counters of every masternode family message type received since startup */
+std::map<std::string, CMasternodeMessageStats> GetMasternodeMessageStats();
 
 #endif // CROWN_MN_PROCESSING_H
@@ -4,6 +4,7 @@
 
 #include "primitives/transaction.h"
 #include "chain.h"
+#include "memusage.h"
 
 #include <platform/platform-utils.h>
 #include <platform/specialtx.h>
@@ -17,6 +18,20 @@ namespace Platform
     using NftIndexByOwnerId = NfTokensIndexSet::index<Tags::OwnerId>::type;
 
     /*static*/ std::unique_ptr<NfTokensManager> NfTokensManager::s_instance;
+    /*static*/ size_t NfTokensManager::s_indexMemoryBudget = NfTokensManager::DEFAULT_INDEX_MEMORY_BUDGET << 20;
+
+    static size_t NfTokenIndexMemoryUsage(const NfTokenIndex & nftIndex)
+    {
+        /// Estimate the overhead of a multi-index node to be 20 pointers + an allocation, plus 4 hashed index buckets
+        size_t usage = memusage::MallocUsage(sizeof(NfTokenIndex) + 24 * sizeof(void*))
+                       + memusage::DynamicUsage(nftIndex.NfTokenPtr())
+                       + memusage::DynamicUsage(nftIndex.NfTokenPtr()->metadata);
+        /// The recency list node and its position entry of the tiered mode
+        if (PlatformDb::Instance().TieredNftIndex())
+            usage += memusage::MallocUsage(sizeof(std::pair<uint64_t, uint256>) + 2 * sizeof(void*))
+                     + memusage::MallocUsage(sizeof(std::pair<uint64_t, uint256>) + 3 * sizeof(void*));
+        return usage;
+    }
 
     NfTokensManager::NfTokensManager()
     {
@@ -32,27 +47,31 @@ namespace Platform
             return true;
         };
 
+        PlatformDb::Instance().ProcessNftSupplyGutsOnly(protoSupplyHandler);
+
         if (PlatformDb::Instance().OptimizeSpeed())
         {
-            PlatformDb::Instance().ProcessPlatformDbGuts([&, this](const leveldb::Iterator & dbIt) -> bool
+            int64_t nStart = GetTimeMillis();
+
+            /// the global total supply is the number of records, every hashed index gets its buckets up front
+            auto totalIt = m_protocolsTotalSupply.find(NfToken::UNKNOWN_TOKEN_PROTOCOL);
+            size_t expectedCount = totalIt != m_protocolsTotalSupply.end() ? totalIt->second : 0;
+            m_nfTokensIndexSet.get<Tags::ProtocolIdTokenId>().reserve(expectedCount);
+            m_nfTokensIndexSet.get<Tags::RegTxHash>().reserve(expectedCount);
+            m_nfTokensIndexSet.get<Tags::BlockHash>().reserve(expectedCount);
+            m_nfTokensIndexSet.get<Tags::ProtocolId>().reserve(expectedCount);
+
+            PlatformDb::Instance().LoadNftIndexGuts(expectedCount, [this](NfTokenIndex nftIndex) -> bool
             {
-                if (!PlatformDb::Instance().ProcessNftSupply(dbIt, protoSupplyHandler))
-                {
-                    return false;
-                }
-                return PlatformDb::Instance().ProcessNftIndex(dbIt, [this](NfTokenIndex nftIndex) -> bool
-                {
-                    return m_nfTokensIndexSet.emplace(std::move(nftIndex)).second;
-                });
+                return InsertNfTokenIndex(std::move(nftIndex)).second;
             });
+
+            LogPrintf("%s: loaded %u NFTs in %dms\n", __func__, m_nfTokensIndexSet.size(), GetTimeMillis() - nStart);
         }
-        else /// PlatformDb::Instance().OptimizeRam() is on
+        else /// PlatformDb::Instance().OptimizeRam() is on, also in the tiered mode
         {
-            PlatformDb::Instance().ProcessPlatformDbGuts([&](const leveldb::Iterator & dbIt) -> bool
-            {
-                PlatformDb::Instance().ProcessNftSupply(dbIt, protoSupplyHandler);
-                return true;
-            });
+            if (!PlatformDb::Instance().HasNftSecondaryIndexes())
+                PlatformDb::Instance().BuildNftSecondaryIndexes();
         }
     }
 
@@ -68,13 +87,15 @@ namespace Platform
 
         std::shared_ptr<NfToken> nfTokenPtr(new NfToken(nfToken));
         NfTokenIndex nftIndex(pindex, tx.GetHash(), nfTokenPtr);
-        auto itRes = m_nfTokensIndexSet.emplace(std::move(nftIndex));
+        auto itRes = InsertNfTokenIndex(std::move(nftIndex));
 
         if (itRes.second)
         {
+            m_blockChanges.emplace_back(*itRes.first, true);
             NfTokenDiskIndex nftDiskIndex(*pindex->phashBlock, pindex, tx.GetHash(), nfTokenPtr);
             PlatformDb::Instance().WriteNftDiskIndex(nftDiskIndex);
             this->UpdateTotalSupply(nfTokenPtr->tokenProtocolId, true);
+            EvictColdNfTokens();
         }
         return itRes.second;
     }
@@ -85,14 +106,9 @@ namespace Platform
         assert(protocolId != NfToken::UNKNOWN_TOKEN_PROTOCOL);
         assert(!tokenId.IsNull());
 
-        NfTokensIndexSet::const_iterator it = m_nfTokensIndexSet.find(std::make_tuple(protocolId, tokenId));
-        if (it != m_nfTokensIndexSet.end())
-        {
-            return *it;
-        }
-
-        /// PlatformDb::Instance().OptimizeRam() is on
-        return GetNftIndexFromDb(protocolId, tokenId);
+        NfTokenIndex nftIndex = GetCachedNfTokenIndex(protocolId, tokenId);
+        EvictColdNfTokens();
+        return nftIndex;
     }
 
     NfTokenIndex NfTokensManager::GetNfTokenIndex(const uint256 & regTxId)
@@ -112,8 +128,11 @@ namespace Platform
         }
         else /// PlatformDb::Instance().OptimizeRam() is on
         {
-            std::string error = std::string(__func__) + " is implemented only for speed optimized node instances. Change the conf and restart your node.";
-            throw std::runtime_error(error);
+            uint64_t protocolId;
+            uint256 tokenId;
+            if (!PlatformDb::Instance().ReadNftIdByRegTx(regTxId, protocolId, tokenId))
+                return NfTokenIndex();
+            return GetNfTokenIndex(protocolId, tokenId);
         }
     }
 
@@ -144,14 +163,8 @@ namespace Platform
         assert(protocolId != NfToken::UNKNOWN_TOKEN_PROTOCOL);
         assert(!tokenId.IsNull());
 
-        NfTokensIndexSet::const_iterator it = m_nfTokensIndexSet.find(std::make_tuple(protocolId, tokenId));
-        if (it != m_nfTokensIndexSet.end())
-        {
-            return it->NfTokenPtr()->tokenOwnerKeyId;
-        }
-
-        /// PlatformDb::Instance().OptimizeRam() is on
-        auto nftIndex = GetNftIndexFromDb(protocolId, tokenId);
+        auto nftIndex = GetCachedNfTokenIndex(protocolId, tokenId);
+        EvictColdNfTokens();
         if (!nftIndex.IsNull())
             return nftIndex.NfTokenPtr()->tokenOwnerKeyId;
         return CKeyID();
@@ -166,17 +179,7 @@ namespace Platform
 
         if (PlatformDb::Instance().OptimizeRam())
         {
-            unsigned int count = 0;
-            PlatformDb::Instance().ProcessNftIndexGutsOnly([&](NfTokenIndex nftIndex) -> bool
-            {
-                if (nftIndex.NfTokenPtr()->tokenProtocolId == protocolId &&
-                    nftIndex.NfTokenPtr()->tokenOwnerKeyId == ownerId)
-                {
-                    count++;
-                }
-                return true;
-            });
-            return count;
+            return PlatformDb::Instance().CountNftsByOwner(protocolId, ownerId);
         }
 
         /// PlatformDb::Instance().OptimizeSpeed() is on
@@ -192,14 +195,7 @@ namespace Platform
 
         if (PlatformDb::Instance().OptimizeRam())
         {
-            unsigned int count = 0;
-            PlatformDb::Instance().ProcessNftIndexGutsOnly([&](NfTokenIndex nftIndex) -> bool
-            {
-                if (nftIndex.NfTokenPtr()->tokenOwnerKeyId == ownerId)
-                    count++;
-                return true;
-            });
-            return count;
+            return PlatformDb::Instance().CountNftsByOwner(ownerId);
         }
 
         /// PlatformDb::Instance().OptimizeSpeed() is on
@@ -207,16 +203,26 @@ namespace Platform
         return ownerIndex.count(ownerId);
     }
 
-    std::vector<std::weak_ptr<const NfToken> > NfTokensManager::NfTokensOf(uint64_t protocolId, const CKeyID & ownerId) const
+    std::vector<std::shared_ptr<const NfToken> > NfTokensManager::NfTokensOf(uint64_t protocolId, const CKeyID & ownerId) const
     {
         LOCK(m_cs);
         assert(protocolId != NfToken::UNKNOWN_TOKEN_PROTOCOL);
         assert(!ownerId.IsNull());
 
+        std::vector<std::shared_ptr<const NfToken> > nfTokens;
+        if (PlatformDb::Instance().OptimizeRam())
+        {
+            PlatformDb::Instance().ProcessNftIdsByOwner(protocolId, ownerId, [&](uint64_t nftProtoId, const uint256 & tokenId) -> bool
+            {
+                nfTokens.emplace_back(GetCachedNfTokenIndex(nftProtoId, tokenId).NfTokenPtr());
+                return true;
+            });
+            return nfTokens;
+        }
+
         const NftIndexByProtocolAndOwnerId & protocolOwnerIndex = m_nfTokensIndexSet.get<Tags::ProtocolIdOwnerId>();
         const auto range = protocolOwnerIndex.equal_range(std::make_tuple(protocolId, ownerId));
 
-        std::vector<std::weak_ptr<const NfToken> > nfTokens;
         nfTokens.reserve(std::distance(range.first, range.second));
         std::for_each(range.first, range.second, [&](const NfTokenIndex & nfTokenIdx)
         {
@@ -226,15 +232,25 @@ namespace Platform
         return nfTokens;
     }
 
-    std::vector<std::weak_ptr<const NfToken> > NfTokensManager::NfTokensOf(const CKeyID & ownerId) const
+    std::vector<std::shared_ptr<const NfToken> > NfTokensManager::NfTokensOf(const CKeyID & ownerId) const
     {
         LOCK(m_cs);
         assert(!ownerId.IsNull());
 
+        std::vector<std::shared_ptr<const NfToken> > nfTokens;
+        if (PlatformDb::Instance().OptimizeRam())
+        {
+            PlatformDb::Instance().ProcessNftIdsByOwner(ownerId, [&](uint64_t nftProtoId, const uint256 & tokenId) -> bool
+            {
+                nfTokens.emplace_back(GetCachedNfTokenIndex(nftProtoId, tokenId).NfTokenPtr());
+                return true;
+            });
+            return nfTokens;
+        }
+
         const NftIndexByOwnerId & ownerIndex = m_nfTokensIndexSet.get<Tags::OwnerId>();
         const auto range = ownerIndex.equal_range(ownerId);
 
-        std::vector<std::weak_ptr<const NfToken> > nfTokens;
         nfTokens.reserve(std::distance(range.first, range.second));
         std::for_each(range.first, range.second, [&](const NfTokenIndex & nfTokenIdx)
         {
@@ -250,10 +266,20 @@ namespace Platform
         assert(protocolId != NfToken::UNKNOWN_TOKEN_PROTOCOL);
         assert(!ownerId.IsNull());
 
+        std::vector<uint256> nfTokenIds;
+        if (PlatformDb::Instance().OptimizeRam())
+        {
+            PlatformDb::Instance().ProcessNftIdsByOwner(protocolId, ownerId, [&](uint64_t nftProtoId, const uint256 & tokenId) -> bool
+            {
+                nfTokenIds.emplace_back(tokenId);
+                return true;
+            });
+            return nfTokenIds;
+        }
+
         const NftIndexByProtocolAndOwnerId & protocolOwnerIndex = m_nfTokensIndexSet.get<Tags::ProtocolIdOwnerId>();
         const auto range = protocolOwnerIndex.equal_range(std::make_tuple(protocolId, ownerId));
 
-        std::vector<uint256> nfTokenIds;
         nfTokenIds.reserve(std::distance(range.first, range.second));
         std::for_each(range.first, range.second, [&](const NfTokenIndex & nfTokenIdx)
         {
@@ -267,10 +293,20 @@ namespace Platform
         LOCK(m_cs);
         assert(!ownerId.IsNull());
 
+        std::vector<uint256> nfTokenIds;
+        if (PlatformDb::Instance().OptimizeRam())
+        {
+            PlatformDb::Instance().ProcessNftIdsByOwner(ownerId, [&](uint64_t nftProtoId, const uint256 & tokenId) -> bool
+            {
+                nfTokenIds.emplace_back(tokenId);
+                return true;
+            });
+            return nfTokenIds;
+        }
+
         const NftIndexByOwnerId & ownerIndex = m_nfTokensIndexSet.get<Tags::OwnerId>();
         const auto range = ownerIndex.equal_range(ownerId);
 
-        std::vector<uint256> nfTokenIds;
         nfTokenIds.reserve(std::distance(range.first, range.second));
         std::for_each(range.first, range.second, [&](const NfTokenIndex & nfTokenIdx)
         {
@@ -352,8 +388,10 @@ namespace Platform
         }
         else /// PlatformDb::Instance().OptimizeRam() is on
         {
-            std::string error = std::string(__func__) + " is implemented only for speed optimized node instances. Change the conf and restart your node.";
-            throw std::runtime_error(error);
+            PlatformDb::Instance().ProcessNftIdsByHeight(height, count, skipFromTip, [&](uint64_t protocolId, const uint256 & tokenId) -> bool
+            {
+                return ProcessNftIndexFromDb(nftIndexHandler, protocolId, tokenId);
+            });
         }
     }
 
@@ -384,8 +422,10 @@ namespace Platform
         }
         else /// PlatformDb::Instance().OptimizeRam() is on
         {
-            std::string error = std::string(__func__) + " is implemented only for speed optimized node instances. Change the conf and restart your node.";
-            throw std::runtime_error(error);
+            PlatformDb::Instance().ProcessNftIdsByHeight(nftProtoId, height, count, skipFromTip, [&](uint64_t protocolId, const uint256 & tokenId) -> bool
+            {
+                return ProcessNftIndexFromDb(nftIndexHandler, protocolId, tokenId);
+            });
         }
     }
 
@@ -416,8 +456,10 @@ namespace Platform
         }
         else /// PlatformDb::Instance().OptimizeRam() is on
         {
-            std::string error = std::string(__func__) + " is implemented only for speed optimized node instances. Change the conf and restart your node.";
-            throw std::runtime_error(error);
+            PlatformDb::Instance().ProcessNftIdsByHeight(keyId, height, count, skipFromTip, [&](uint64_t protocolId, const uint256 & tokenId) -> bool
+            {
+                return ProcessNftIndexFromDb(nftIndexHandler, protocolId, tokenId);
+            });
         }
     }
 
@@ -449,8 +491,10 @@ namespace Platform
         }
         else /// PlatformDb::Instance().OptimizeRam() is on
         {
-            std::string error = std::string(__func__) + " is implemented only for speed optimized node instances. Change the conf and restart your node.";
-            throw std::runtime_error(error);
+            PlatformDb::Instance().ProcessNftIdsByHeight(nftProtoId, keyId, height, count, skipFromTip, [&](uint64_t protocolId, const uint256 & tokenId) -> bool
+            {
+                return ProcessNftIndexFromDb(nftIndexHandler, protocolId, tokenId);
+            });
         }
     }
 
@@ -471,7 +515,8 @@ namespace Platform
             auto it = m_nfTokensIndexSet.find(std::make_tuple(protocolId, tokenId));
             if (it != m_nfTokensIndexSet.end() && it->BlockIndex()->nHeight <= height)
             {
-                m_nfTokensIndexSet.erase(it);
+                m_blockChanges.emplace_back(*it, false);
+                EraseNfTokenIndex(it);
                 PlatformDb::Instance().EraseNftDiskIndex(protocolId, tokenId);
                 this->UpdateTotalSupply(protocolId, false);
                 return true;
@@ -482,6 +527,10 @@ namespace Platform
             auto index = PlatformDb::Instance().ReadNftIndex(protocolId, tokenId);
             if (!index.IsNull() && index.BlockIndex()->nHeight <= height)
             {
+                m_blockChanges.emplace_back(index, false);
+                auto it = m_nfTokensIndexSet.find(std::make_tuple(protocolId, tokenId));
+                if (it != m_nfTokensIndexSet.end())
+                    EraseNfTokenIndex(it);
                 PlatformDb::Instance().EraseNftDiskIndex(protocolId, tokenId);
                 this->UpdateTotalSupply(protocolId, false);
                 return true;
@@ -506,28 +555,126 @@ namespace Platform
     {
         LOCK(m_cs);
         m_protocolsTotalSupply[protocolId] = 0;
-        PlatformDb::Instance().WriteTotalSupply(0, protocolId);
+        m_dirtyTotalSupply.insert(protocolId);
+    }
+
+    void NfTokensManager::CommitBlockChanges()
+    {
+        LOCK(m_cs);
+        FlushTotalSupply();
+        m_blockChanges.clear();
+    }
+
+    void NfTokensManager::AbortBlockChanges()
+    {
+        LOCK(m_cs);
+        for (auto change = m_blockChanges.rbegin(); change != m_blockChanges.rend(); ++change)
+        {
+            const NfTokenIndex & nftIndex = change->first;
+            auto it = m_nfTokensIndexSet.find(std::make_tuple(nftIndex.NfTokenPtr()->tokenProtocolId, nftIndex.NfTokenPtr()->tokenId));
+            if (change->second && it != m_nfTokensIndexSet.end())
+                EraseNfTokenIndex(it);
+            /// the RAM modes read a deleted token back from the db once it is needed
+            else if (!change->second && it == m_nfTokensIndexSet.end() && PlatformDb::Instance().OptimizeSpeed())
+                InsertNfTokenIndex(nftIndex);
+        }
+        m_blockChanges.clear();
+        DiscardTotalSupply();
+    }
+
+    void NfTokensManager::FlushTotalSupply()
+    {
+        LOCK(m_cs);
+        for (uint64_t protocolId : m_dirtyTotalSupply)
+            PlatformDb::Instance().WriteTotalSupply(m_protocolsTotalSupply[protocolId], protocolId);
+        m_dirtyTotalSupply.clear();
+    }
+
+    void NfTokensManager::DiscardTotalSupply()
+    {
+        LOCK(m_cs);
+        for (uint64_t protocolId : m_dirtyTotalSupply)
+        {
+            unsigned int totalSupply = 0;
+            if (PlatformDb::Instance().ReadTotalSupply(totalSupply, protocolId))
+                m_protocolsTotalSupply[protocolId] = totalSupply;
+            else
+                m_protocolsTotalSupply.erase(protocolId);
+        }
+        m_dirtyTotalSupply.clear();
     }
 
     void NfTokensManager::UpdateTotalSupply(uint64_t protocolId, bool increase)
     {
-        unsigned int updatedSize = increase ? ++m_protocolsTotalSupply[protocolId] : --m_protocolsTotalSupply[protocolId];
-        PlatformDb::Instance().WriteTotalSupply(updatedSize, protocolId);
+        /// written once per protocol when the block is done, see FlushTotalSupply
+        int delta = increase ? 1 : -1;
+        m_protocolsTotalSupply[protocolId] += delta;
+        m_dirtyTotalSupply.insert(protocolId);
         if (protocolId != NfToken::UNKNOWN_TOKEN_PROTOCOL)
         {
             /// Update total supply count
             uint64_t tempTotalId = NfToken::UNKNOWN_TOKEN_PROTOCOL;
-            unsigned int updatedTotalSize = increase ? ++m_protocolsTotalSupply[tempTotalId] : --m_protocolsTotalSupply[tempTotalId];
-            PlatformDb::Instance().WriteTotalSupply(updatedTotalSize);
+            m_protocolsTotalSupply[tempTotalId] += delta;
+            m_dirtyTotalSupply.insert(tempTotalId);
         }
     }
 
-    NfTokenIndex NfTokensManager::GetNftIndexFromDb(uint64_t protocolId, const uint256 & tokenId)
+    NfTokensCacheStats NfTokensManager::GetCacheStats() const
+    {
+        LOCK(m_cs);
+        NfTokensCacheStats stats;
+        stats.entries = m_nfTokensIndexSet.size();
+        stats.memoryUsage = m_nfTokensMemoryUsage;
+        stats.memoryBudget = PlatformDb::Instance().TieredNftIndex() ? s_indexMemoryBudget : 0;
+        stats.hits = m_cacheHits;
+        stats.misses = m_cacheMisses;
+        stats.evictions = m_cacheEvictions;
+        return stats;
+    }
+
+    NfTokenIndex NfTokensManager::GetCachedNfTokenIndex(uint64_t protocolId, const uint256 & tokenId) const
+    {
+        auto it = m_nfTokensIndexSet.find(std::make_tuple(protocolId, tokenId));
+        if (it != m_nfTokensIndexSet.end())
+        {
+            ++m_cacheHits;
+            TouchNfTokenIndex(it);
+            return *it;
+        }
+        ++m_cacheMisses;
+        return GetNftIndexFromDb(protocolId, tokenId);
+    }
+
+    bool NfTokensManager::ProcessNftIndexFromDb(const std::function<bool(const NfTokenIndex &)> & nftIndexHandler, uint64_t protocolId, const uint256 & tokenId) const
+    {
+        auto it = m_nfTokensIndexSet.find(std::make_tuple(protocolId, tokenId));
+        if (it != m_nfTokensIndexSet.end())
+        {
+            ++m_cacheHits;
+            if (!nftIndexHandler(*it))
+                LogPrintf("%s: NFT index processing failed.", __func__);
+            return true;
+        }
+        ++m_cacheMisses;
+
+        /// ranges are read without caching, a listing should not fill the memory this mode saves
+        NfTokenIndex nftIndex = PlatformDb::Instance().ReadNftIndex(protocolId, tokenId);
+        if (nftIndex.IsNull())
+        {
+            LogPrintf("%s: Can't read NFT index %s:%s from the database", __func__, std::to_string(protocolId), tokenId.ToString());
+            return true;
+        }
+        if (!nftIndexHandler(nftIndex))
+            LogPrintf("%s: NFT index processing failed.", __func__);
+        return true;
+    }
+
+    NfTokenIndex NfTokensManager::GetNftIndexFromDb(uint64_t protocolId, const uint256 & tokenId) const
     {
         NfTokenIndex nftIndex = PlatformDb::Instance().ReadNftIndex(protocolId, tokenId);
         if (!nftIndex.IsNull())
         {
-            auto insRes = m_nfTokensIndexSet.emplace(std::move(nftIndex));
+            auto insRes = InsertNfTokenIndex(std::move(nftIndex));
             assert(insRes.second);
             return *insRes.first;
         }
@@ -537,4 +684,58 @@ namespace Platform
             return nftIndex;
         }
     }
+
+    std::pair<NfTokensIndexSet::iterator, bool> NfTokensManager::InsertNfTokenIndex(NfTokenIndex nftIndex) const
+    {
+        auto insRes = m_nfTokensIndexSet.emplace(std::move(nftIndex));
+        if (insRes.second)
+        {
+            m_nfTokensMemoryUsage += NfTokenIndexMemoryUsage(*insRes.first);
+            if (PlatformDb::Instance().TieredNftIndex())
+            {
+                const NftId nftId(insRes.first->NfTokenPtr()->tokenProtocolId, insRes.first->NfTokenPtr()->tokenId);
+                m_recencyPositions.emplace(nftId, m_recencyList.insert(m_recencyList.end(), nftId));
+            }
+        }
+        return insRes;
+    }
+
+    void NfTokensManager::EraseNfTokenIndex(NfTokensIndexSet::iterator it) const
+    {
+        if (PlatformDb::Instance().TieredNftIndex())
+        {
+            auto posIt = m_recencyPositions.find(NftId(it->NfTokenPtr()->tokenProtocolId, it->NfTokenPtr()->tokenId));
+            assert(posIt != m_recencyPositions.end());
+            m_recencyList.erase(posIt->second);
+            m_recencyPositions.erase(posIt);
+        }
+        m_nfTokensMemoryUsage -= NfTokenIndexMemoryUsage(*it);
+        m_nfTokensIndexSet.erase(it);
+    }
+
+    void NfTokensManager::TouchNfTokenIndex(NfTokensIndexSet::iterator it) const
+    {
+        if (!PlatformDb::Instance().TieredNftIndex())
+            return;
+
+        auto posIt = m_recencyPositions.find(NftId(it->NfTokenPtr()->tokenProtocolId, it->NfTokenPtr()->tokenId));
+        assert(posIt != m_recencyPositions.end());
+        m_recencyList.splice(m_recencyList.end(), m_recencyList, posIt->second);
+    }
+
+    void NfTokensManager::EvictColdNfTokens() const
+    {
+        if (!PlatformDb::Instance().TieredNftIndex())
+            return;
+
+        /// the most recently used nf-token stays even if it does not fit the budget on its own
+        while (m_nfTokensMemoryUsage > s_indexMemoryBudget && m_recencyList.size() > 1)
+        {
+            const NftId & coldest = m_recencyList.front();
+            auto it = m_nfTokensIndexSet.find(std::make_tuple(coldest.first, coldest.second));
+            assert(it != m_nfTokensIndexSet.end());
+            EraseNfTokenIndex(it);
+            ++m_cacheEvictions;
+        }
+    }
 }
@@ -5,7 +5,9 @@
 #ifndef CROWN_PLATFORM_NF_TOKENS_MANAGER_H
 #define CROWN_PLATFORM_NF_TOKENS_MANAGER_H
 
+#include <list>
 #include <unordered_map>
+#include <unordered_set>
 #include <boost/range/adaptors.hpp>
 #include <boost/range/any_range.hpp>
 
@@ -162,9 +164,22 @@ namespace Platform
         >
     >;
 
+    struct NfTokensCacheStats
+    {
+        size_t entries{0};
+        size_t memoryUsage{0};
+        size_t memoryBudget{0};
+        uint64_t hits{0};
+        uint64_t misses{0};
+        uint64_t evictions{0};
+    };
+
     class NfTokensManager
     {
         public:
+            /// Default memory budget of the nf-tokens index in the tiered mode, in MiB
+            static const size_t DEFAULT_INDEX_MEMORY_BUDGET = 64;
+
             static NfTokensManager & Instance()
             {
                 if (s_instance == nullptr)
@@ -196,9 +211,10 @@ namespace Platform
             unsigned int BalanceOf(const CKeyID & ownerId) const;
 
             /// Retrieve all nf-tokens belonging to a specified owner within a protocol
-            std::vector<std::weak_ptr<const NfToken> > NfTokensOf(uint64_t protocolId, const CKeyID & ownerId) const;
+            /// The tokens are shared, in the RAM modes they may be dropped from the index by the next call
+            std::vector<std::shared_ptr<const NfToken> > NfTokensOf(uint64_t protocolId, const CKeyID & ownerId) const;
             /// Retrieve all nf-tokens belonging to a specified owner in a global protocol set
-            std::vector<std::weak_ptr<const NfToken> > NfTokensOf(const CKeyID & ownerId) const;
+            std::vector<std::shared_ptr<const NfToken> > NfTokensOf(const CKeyID & ownerId) const;
 
             /// Retrieve all nf-token IDs belonging to a specified owner within a protocol
             std::vector<uint256> NfTokenIdsOf(uint64_t protocolId, const CKeyID & ownerId) const;
@@ -249,21 +265,61 @@ namespace Platform
             /// Add new registered NFT protocol
             void OnNewProtocolRegistered(uint64_t protocolId);
 
+            /// Keep the changes of the blocks in the platform db batch, write the changed total supplies into it
+            void CommitBlockChanges();
+            /// Undo the index and total supply changes of the blocks in the batch, after the db batch is rolled back
+            void AbortBlockChanges();
+
+            /// Set the memory budget of the nf-tokens index in the tiered mode, in bytes
+            static void SetIndexMemoryBudget(size_t memoryBudget) { s_indexMemoryBudget = memoryBudget; }
+            /// Size, memory usage and hit rate of the nf-tokens kept in memory
+            NfTokensCacheStats GetCacheStats() const;
+
         private:
             NfTokensManager();
 
             void UpdateTotalSupply(uint64_t protocolId, bool increase);
-            NfTokenIndex GetNftIndexFromDb(uint64_t protocolId, const uint256 & tokenId);
+            /// Write the total supply of every protocol changed since the last flush, once per protocol
+            void FlushTotalSupply();
+            /// Re-read the total supply of every protocol changed since the last flush from the db
+            void DiscardTotalSupply();
+            NfTokenIndex GetNftIndexFromDb(uint64_t protocolId, const uint256 & tokenId) const;
+            /// The index in memory, read from the db and kept if it is not loaded yet
+            NfTokenIndex GetCachedNfTokenIndex(uint64_t protocolId, const uint256 & tokenId) const;
+            bool ProcessNftIndexFromDb(const std::function<bool(const NfTokenIndex &)> & nftIndexHandler, uint64_t protocolId, const uint256 & tokenId) const;
+
+            /// Keep the index entry accounted in the memory usage, see EvictColdNfTokens
+            std::pair<NfTokensIndexSet::iterator, bool> InsertNfTokenIndex(NfTokenIndex nftIndex) const;
+            void EraseNfTokenIndex(NfTokensIndexSet::iterator it) const;
+            /// Move an nf-token to the most recently used end in the tiered mode
+            void TouchNfTokenIndex(NfTokensIndexSet::iterator it) const;
+            /// Evict the least recently used nf-tokens until the index fits the memory budget in the tiered mode
+            void EvictColdNfTokens() const;
 
         private:
-            NfTokensIndexSet m_nfTokensIndexSet;
+            /// every nf-token when optimized for speed, the tokens read from the db so far when optimized for RAM,
+            /// the recently used ones within the memory budget in the tiered mode
+            mutable NfTokensIndexSet m_nfTokensIndexSet;
+            mutable size_t m_nfTokensMemoryUsage{0};
+            mutable uint64_t m_cacheHits{0};
+            mutable uint64_t m_cacheMisses{0};
+            mutable uint64_t m_cacheEvictions{0};
+            /// nf-tokens in memory from the least to the most recently used, only kept in the tiered mode
+            using NftId = std::pair<uint64_t, uint256>;
+            mutable std::list<NftId> m_recencyList;
+            mutable std::unordered_map<NftId, std::list<NftId>::iterator, boost::hash<NftId> > m_recencyPositions;
             int m_tipHeight{-1};
             uint256 m_tipBlockHash;
             mutable RecursiveMutex m_cs;
 
             std::unordered_map<uint64_t, unsigned int> m_protocolsTotalSupply;
+            /// protocols with a total supply not written to the db yet, see FlushTotalSupply
+            std::unordered_set<uint64_t> m_dirtyTotalSupply;
+            /// nf-tokens added (true) or deleted (false) since the last commit, undone in reverse by AbortBlockChanges
+            std::vector<std::pair<NfTokenIndex, bool> > m_blockChanges;
 
             static std::unique_ptr<NfTokensManager> s_instance;
+            static size_t s_indexMemoryBudget;
     };
 
 }
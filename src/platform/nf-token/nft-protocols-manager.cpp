@@ -21,10 +21,16 @@ namespace Platform
 
         PlatformDb::Instance().ReadTotalProtocolCount(m_totalProtocolsCount);
 
-        PlatformDb::Instance().ProcessNftProtoIndexGutsOnly([this](NftProtoIndex protoIndex) -> bool
+        int64_t nStart = GetTimeMillis();
+        m_nftProtoIndexSet.get<Tags::ProtocolId>().reserve(m_totalProtocolsCount);
+        m_nftProtoIndexSet.get<Tags::RegTxHash>().reserve(m_totalProtocolsCount);
+
+        PlatformDb::Instance().LoadNftProtoIndexGuts(m_totalProtocolsCount, [this](NftProtoIndex protoIndex) -> bool
         {
             return m_nftProtoIndexSet.emplace(std::move(protoIndex)).second;
         });
+
+        LogPrintf("%s: loaded %u NFT protocols in %dms\n", __func__, m_nftProtoIndexSet.size(), GetTimeMillis() - nStart);
     }
 
     bool NftProtocolsManager::AddNftProto(const NfTokenProtocol & nftProto, const CTransaction & tx, const CBlockIndex * pindex)
@@ -41,9 +47,11 @@ namespace Platform
 
         if (itRes.second)
         {
+            m_blockChanges.emplace_back(*itRes.first, true);
             NftProtoDiskIndex protoDiskIndex(*pindex->phashBlock, pindex, tx.GetHash(), nftProtoPtr);
             PlatformDb::Instance().WriteNftProtoDiskIndex(protoDiskIndex);
-            PlatformDb::Instance().WriteTotalProtocolCount(++m_totalProtocolsCount);
+            ++m_totalProtocolsCount;
+            m_totalProtocolsCountDirty = true;
         }
         return itRes.second;
     }
@@ -162,9 +170,11 @@ namespace Platform
         auto it = m_nftProtoIndexSet.find(protocolId);
         if (it != m_nftProtoIndexSet.end() && it->BlockIndex()->nHeight <= height)
         {
+            m_blockChanges.emplace_back(*it, false);
             m_nftProtoIndexSet.erase(it);
             PlatformDb::Instance().EraseNftProtoDiskIndex(protocolId);
-            PlatformDb::Instance().WriteTotalProtocolCount(--m_totalProtocolsCount);
+            --m_totalProtocolsCount;
+            m_totalProtocolsCountDirty = true;
             return true;
         }
 
@@ -198,4 +208,46 @@ namespace Platform
             return protoIndex;
         }
     }*/
+
+    void NftProtocolsManager::CommitBlockChanges()
+    {
+        LOCK(m_cs);
+        FlushTotalSupply();
+        m_blockChanges.clear();
+    }
+
+    void NftProtocolsManager::AbortBlockChanges()
+    {
+        LOCK(m_cs);
+        for (auto change = m_blockChanges.rbegin(); change != m_blockChanges.rend(); ++change)
+        {
+            if (change->second)
+                m_nftProtoIndexSet.erase(change->first.NftProtoPtr()->tokenProtocolId);
+            else
+                m_nftProtoIndexSet.emplace(change->first);
+        }
+        m_blockChanges.clear();
+        DiscardTotalSupply();
+    }
+
+    void NftProtocolsManager::FlushTotalSupply()
+    {
+        LOCK(m_cs);
+        if (m_totalProtocolsCountDirty)
+        {
+            PlatformDb::Instance().WriteTotalProtocolCount(m_totalProtocolsCount);
+            m_totalProtocolsCountDirty = false;
+        }
+    }
+
+    void NftProtocolsManager::DiscardTotalSupply()
+    {
+        LOCK(m_cs);
+        if (m_totalProtocolsCountDirty)
+        {
+            m_totalProtocolsCount = 0;
+            PlatformDb::Instance().ReadTotalProtocolCount(m_totalProtocolsCount);
+            m_totalProtocolsCountDirty = false;
+        }
+    }
 }
@@ -118,8 +118,17 @@ namespace Platform
         /// Update with the best block tip
         void UpdateBlockTip(const CBlockIndex * pindex);
 
+        /// Keep the changes of the blocks in the platform db batch, write the changed total amount into it
+        void CommitBlockChanges();
+        /// Undo the protocol set and total amount changes of the blocks in the batch, after the db batch is rolled back
+        void AbortBlockChanges();
+
     private:
         NftProtocolsManager();
+        /// Write the total amount of nft protocols if it changed since the last flush
+        void FlushTotalSupply();
+        /// Re-read the total amount of nft protocols from the db if it changed since the last flush
+        void DiscardTotalSupply();
         /// Reserved for future use
         /// NftProtoIndex GetNftProtoIndexFromDb(uint64_t protocolId);
 
@@ -130,6 +139,9 @@ namespace Platform
         mutable RecursiveMutex m_cs;
 
         unsigned int m_totalProtocolsCount{0};
+        bool m_totalProtocolsCountDirty{false};
+        /// protocols added (true) or deleted (false) since the last commit, undone in reverse by AbortBlockChanges
+        std::vector<std::pair<NftProtoIndex, bool> > m_blockChanges;
 
         static std::unique_ptr<NftProtocolsManager> s_instance;
     };
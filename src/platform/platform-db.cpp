@@ -8,18 +8,112 @@
 #include <platform/nf-token/nf-token-protocol-reg-tx.h>
 #include <platform/nf-token/nf-token-reg-tx.h>
 
+#include <algorithm>
+#include <thread>
+
 namespace Platform
 {
+    /// Threads used to deserialize the NFT indexes at startup
+    static const unsigned int MAX_INDEX_LOAD_THREADS = 8;
+    /// Records per thread below which a parallel load does not pay off
+    static const size_t MIN_RECORDS_PER_LOAD_THREAD = 4096;
+
+    /// Deserialize the raw records in contiguous shards, one per thread, each shard keeps the key order.
+    /// The workers only deserialize, the records are resolved to block indexes by the caller under cs_main
+    template <typename DiskIndex>
+    static std::vector<std::vector<DiskIndex>> DeserializeIndexShards(const std::vector<std::string> & values)
+    {
+        size_t nThreads = std::min<size_t>(std::max(GetNumCores(), 1), MAX_INDEX_LOAD_THREADS);
+        nThreads = std::max<size_t>(std::min(nThreads, values.size() / MIN_RECORDS_PER_LOAD_THREAD), 1);
+        const size_t shardSize = (values.size() + nThreads - 1) / nThreads;
+
+        std::vector<std::vector<DiskIndex>> shards(nThreads);
+        std::vector<std::exception_ptr> errors(nThreads);
+        auto deserializeShard = [&](size_t shard)
+        {
+            try
+            {
+                const size_t begin = std::min(shard * shardSize, values.size());
+                const size_t end = std::min(begin + shardSize, values.size());
+                shards[shard].reserve(end - begin);
+                for (size_t i = begin; i < end; ++i)
+                {
+                    CDataStream streamValue(values[i].data(), values[i].data() + values[i].size(), SER_DISK, CLIENT_VERSION);
+                    DiskIndex diskIndex;
+                    try
+                    {
+                        streamValue >> diskIndex;
+                    }
+                    catch (const std::exception & ex)
+                    {
+                        LogPrintf("%s : Deserialize or I/O error - %s", __func__, ex.what());
+                        continue;
+                    }
+                    shards[shard].emplace_back(std::move(diskIndex));
+                }
+            }
+            catch (...)
+            {
+                /// rethrown on the loading thread, an exception escaping a worker would terminate the process
+                errors[shard] = std::current_exception();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t shard = 1; shard < nThreads; ++shard)
+        {
+            threads.emplace_back(&TraceThread<std::function<void()>>, "nftload", [&deserializeShard, shard] {
+                deserializeShard(shard);
+            });
+        }
+        deserializeShard(0);
+        for (auto & thread : threads)
+            thread.join();
+
+        for (const auto & error : errors)
+        {
+            if (error)
+                std::rethrow_exception(error);
+        }
+        return shards;
+    }
+
     /*static*/ std::unique_ptr<PlatformDb> PlatformDb::s_instance;
     /*static*/ const char PlatformDb::DB_NFT = 'n';
     /*static*/ const char PlatformDb::DB_NFT_TOTAL = 't';
     /*static*/ const char PlatformDb::DB_NFT_PROTO = 'p';
     /*static*/ const char PlatformDb::DB_NFT_PROTO_TOTAL = 'c';
+    /*static*/ const char PlatformDb::DB_NFT_BY_REGTX = 'x';
+    /*static*/ const char PlatformDb::DB_NFT_BY_HEIGHT = 'h';
+    /*static*/ const char PlatformDb::DB_NFT_BY_PROTO_HEIGHT = 'q';
+    /*static*/ const char PlatformDb::DB_NFT_BY_OWNER_HEIGHT = 'o';
+    /*static*/ const char PlatformDb::DB_NFT_BY_OWNER_PROTO_HEIGHT = 'w';
+    /*static*/ const char PlatformDb::DB_NFT_SECONDARY_INDEXES = 'i';
+    /*static*/ const char PlatformDb::DB_BEST_BLOCK = 'b';
+
+    /// Version of the secondary NFT index layout written by BuildNftSecondaryIndexes
+    static const int NFT_SECONDARY_INDEXES_VERSION = 1;
+
+    template<typename... Ts>
+    static std::string NftIndexKeyPrefix(const Ts &... fields)
+    {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << std::make_tuple(fields...);
+        return std::string(ssKey.begin(), ssKey.end());
+    }
 
     PlatformDb::PlatformDb(size_t nCacheSize, PlatformOpt optSetting, bool fMemory, bool fWipe)
     : TransactionLevelDBWrapper("platform", nCacheSize, fMemory, fWipe)
     {
         m_optSetting = optSetting;
+
+        /// Speed mode does not update the secondary indexes, a later RAM optimized run has to rebuild them
+        if (OptimizeSpeed() && this->Exists(DB_NFT_SECONDARY_INDEXES))
+        {
+            this->Erase(DB_NFT_SECONDARY_INDEXES);
+            LOCK(m_cs);
+            m_dbTransaction.Commit();
+        }
     }
 
     void PlatformDb::ProcessPlatformDbGuts(std::function<bool(const leveldb::Iterator &)> processor)
@@ -73,6 +167,81 @@ namespace Platform
         HandleError(dbIt->status());
     }
 
+    std::vector<std::string> PlatformDb::ReadRawValuesByPrefix(char prefix, size_t expectedCount)
+    {
+        const std::string keyPrefix(1, prefix);
+        std::vector<std::string> values;
+        values.reserve(expectedCount);
+
+        std::unique_ptr<leveldb::Iterator> dbIt(m_db.NewIterator());
+        for (dbIt->Seek(keyPrefix); dbIt->Valid() && dbIt->key().starts_with(keyPrefix); dbIt->Next())
+        {
+            values.emplace_back(dbIt->value().data(), dbIt->value().size());
+        }
+
+        HandleError(dbIt->status());
+        return values;
+    }
+
+    void PlatformDb::LoadNftIndexGuts(size_t expectedCount, std::function<bool(NfTokenIndex)> nftIndexHandler)
+    {
+        auto shards = DeserializeIndexShards<NfTokenDiskIndex>(ReadRawValuesByPrefix(DB_NFT, expectedCount));
+
+        LOCK(cs_main);
+        for (const auto & shard : shards)
+        {
+            for (const auto & nftDiskIndex : shard)
+            {
+                NfTokenIndex nftIndex = NftDiskIndexToNftMemIndex(nftDiskIndex);
+                if (nftIndex.IsNull())
+                {
+                    LogPrintf("%s : Cannot build an NFT record, reg tx hash: %s", __func__, nftDiskIndex.RegTxHash().ToString());
+                    continue;
+                }
+                if (!nftIndexHandler(std::move(nftIndex)))
+                    LogPrintf("%s : Cannot process an NFT index, reg tx hash: %s", __func__, nftDiskIndex.RegTxHash().ToString());
+            }
+        }
+    }
+
+    void PlatformDb::LoadNftProtoIndexGuts(size_t expectedCount, std::function<bool(NftProtoIndex)> protoIndexHandler)
+    {
+        auto shards = DeserializeIndexShards<NftProtoDiskIndex>(ReadRawValuesByPrefix(DB_NFT_PROTO, expectedCount));
+
+        LOCK(cs_main);
+        for (const auto & shard : shards)
+        {
+            for (const auto & protoDiskIndex : shard)
+            {
+                NftProtoIndex protoIndex = NftProtoDiskIndexToNftProtoMemIndex(protoDiskIndex);
+                if (protoIndex.IsNull())
+                {
+                    LogPrintf("%s : Cannot build an NFT proto record, reg tx hash: %s", __func__, protoDiskIndex.RegTxHash().ToString());
+                    continue;
+                }
+                if (!protoIndexHandler(std::move(protoIndex)))
+                    LogPrintf("%s : Cannot process an NFT proto index, reg tx hash: %s", __func__, protoDiskIndex.RegTxHash().ToString());
+            }
+        }
+    }
+
+    void PlatformDb::ProcessNftSupplyGutsOnly(std::function<bool(uint64_t, unsigned int)> protoSupplyHandler)
+    {
+        const std::string keyPrefix(1, DB_NFT_TOTAL);
+        std::unique_ptr<leveldb::Iterator> dbIt(m_db.NewIterator());
+
+        for (dbIt->Seek(keyPrefix); dbIt->Valid() && dbIt->key().starts_with(keyPrefix); dbIt->Next())
+        {
+            if (!ProcessNftSupply(*dbIt, protoSupplyHandler))
+            {
+                LogPrintf("%s : Cannot process a platform db record - %s", __func__, dbIt->key().ToString());
+                continue;
+            }
+        }
+
+        HandleError(dbIt->status());
+    }
+
     bool PlatformDb::IsNftIndexEmpty()
     {
         std::unique_ptr<leveldb::Iterator> dbIt(m_db.NewIterator());
@@ -193,6 +362,51 @@ namespace Platform
         return true;
     }
 
+    void PlatformDb::BeginBlockBatch()
+    {
+        LOCK(m_cs);
+        assert(m_blockTransaction == nullptr);
+        /// mutations made outside of a block are written first, they are not part of its batch
+        if (!m_dbTransaction.IsClean())
+            m_dbTransaction.Commit();
+        ClearPendingNftIdKeys();
+        m_blockTransaction = BeginTransaction();
+    }
+
+    void PlatformDb::CommitBlockBatch()
+    {
+        LOCK(m_cs);
+        assert(m_blockTransaction != nullptr);
+        m_blockTransaction->Commit();
+        m_blockTransaction.reset();
+        ClearPendingNftIdKeys();
+    }
+
+    void PlatformDb::AbortBlockBatch()
+    {
+        LOCK(m_cs);
+        assert(m_blockTransaction != nullptr);
+        m_blockTransaction->Rollback();
+        m_blockTransaction.reset();
+        ClearPendingNftIdKeys();
+    }
+
+    bool PlatformDb::InBlockBatch()
+    {
+        LOCK(m_cs);
+        return m_blockTransaction != nullptr;
+    }
+
+    void PlatformDb::WriteBestBlock(const uint256 & blockHash)
+    {
+        this->Write(DB_BEST_BLOCK, blockHash);
+    }
+
+    bool PlatformDb::ReadBestBlock(uint256 & blockHash)
+    {
+        return this->Read(DB_BEST_BLOCK, blockHash);
+    }
+
     void PlatformDb::WriteNftDiskIndex(const NfTokenDiskIndex & nftDiskIndex)
     {
         this->Write(std::make_tuple(DB_NFT,
@@ -200,13 +414,349 @@ namespace Platform
               nftDiskIndex.NfTokenPtr()->tokenId),
               nftDiskIndex
               );
+
+        NftIndexEntry entry;
+        entry.protocolId = nftDiskIndex.NfTokenPtr()->tokenProtocolId;
+        entry.tokenId = nftDiskIndex.NfTokenPtr()->tokenId;
+        entry.ownerId = nftDiskIndex.NfTokenPtr()->tokenOwnerKeyId;
+        entry.height = nftDiskIndex.BlockIndex()->nHeight;
+        WriteNftSecondaryIndexes(entry, nftDiskIndex.RegTxHash());
     }
 
     void PlatformDb::EraseNftDiskIndex(const uint64_t &protocolId, const uint256 &tokenId)
     {
+        NfTokenDiskIndex nftDiskIndex;
+        NftIndexEntry entry;
+        if (OptimizeRam() &&
+            this->Read(std::make_tuple(DB_NFT, protocolId, tokenId), nftDiskIndex) &&
+            this->Read(std::make_pair(DB_NFT_BY_REGTX, nftDiskIndex.RegTxHash()), entry))
+        {
+            EraseNftSecondaryIndexes(entry, nftDiskIndex.RegTxHash());
+        }
+
         this->Erase(std::make_tuple(DB_NFT, protocolId, tokenId));
     }
 
+    /// Serialized keys of the height ordered indexes of an NFT, as written by WriteNftSecondaryIndexes
+    static std::vector<std::string> NftIdKeys(const NftIndexEntry & entry)
+    {
+        const NftIndexHeight height{entry.height};
+        return {
+            NftIndexKeyPrefix(PlatformDb::DB_NFT_BY_HEIGHT, height, entry.protocolId, entry.tokenId),
+            NftIndexKeyPrefix(PlatformDb::DB_NFT_BY_PROTO_HEIGHT, entry.protocolId, height, entry.tokenId),
+            NftIndexKeyPrefix(PlatformDb::DB_NFT_BY_OWNER_HEIGHT, entry.ownerId, height, entry.protocolId, entry.tokenId),
+            NftIndexKeyPrefix(PlatformDb::DB_NFT_BY_OWNER_PROTO_HEIGHT, entry.ownerId, entry.protocolId, height, entry.tokenId)
+        };
+    }
+
+    void PlatformDb::WriteNftSecondaryIndexes(const NftIndexEntry & entry, const uint256 & regTxHash)
+    {
+        if (OptimizeSpeed())
+            return;
+
+        const auto nftId = std::make_pair(entry.protocolId, entry.tokenId);
+        const NftIndexHeight height{entry.height};
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        ssValue << nftId;
+        const std::string value(ssValue.begin(), ssValue.end());
+
+        LOCK(m_cs);
+        for (const auto & key : NftIdKeys(entry))
+            m_pendingNftIdKeys[key] = value;
+
+        this->Write(std::make_pair(DB_NFT_BY_REGTX, regTxHash), entry);
+        this->Write(std::make_tuple(DB_NFT_BY_HEIGHT, height, entry.protocolId, entry.tokenId), nftId);
+        this->Write(std::make_tuple(DB_NFT_BY_PROTO_HEIGHT, entry.protocolId, height, entry.tokenId), nftId);
+        this->Write(std::make_tuple(DB_NFT_BY_OWNER_HEIGHT, entry.ownerId, height, entry.protocolId, entry.tokenId), nftId);
+        this->Write(std::make_tuple(DB_NFT_BY_OWNER_PROTO_HEIGHT, entry.ownerId, entry.protocolId, height, entry.tokenId), nftId);
+    }
+
+    void PlatformDb::EraseNftSecondaryIndexes(const NftIndexEntry & entry, const uint256 & regTxHash)
+    {
+        if (OptimizeSpeed())
+            return;
+
+        const NftIndexHeight height{entry.height};
+
+        LOCK(m_cs);
+        for (const auto & key : NftIdKeys(entry))
+            m_pendingNftIdKeys[key] = nullopt;
+
+        this->Erase(std::make_pair(DB_NFT_BY_REGTX, regTxHash));
+        this->Erase(std::make_tuple(DB_NFT_BY_HEIGHT, height, entry.protocolId, entry.tokenId));
+        this->Erase(std::make_tuple(DB_NFT_BY_PROTO_HEIGHT, entry.protocolId, height, entry.tokenId));
+        this->Erase(std::make_tuple(DB_NFT_BY_OWNER_HEIGHT, entry.ownerId, height, entry.protocolId, entry.tokenId));
+        this->Erase(std::make_tuple(DB_NFT_BY_OWNER_PROTO_HEIGHT, entry.ownerId, entry.protocolId, height, entry.tokenId));
+    }
+
+    void PlatformDb::ClearPendingNftIdKeys()
+    {
+        LOCK(m_cs);
+        m_pendingNftIdKeys.clear();
+    }
+
+    bool PlatformDb::HasNftSecondaryIndexes()
+    {
+        int version = 0;
+        return this->Read(DB_NFT_SECONDARY_INDEXES, version) && version == NFT_SECONDARY_INDEXES_VERSION;
+    }
+
+    void PlatformDb::BuildNftSecondaryIndexes()
+    {
+        /// Drop what an earlier RAM optimized run left, every index key of an NFT is derived from its regtx record
+        std::vector<std::pair<uint256, NftIndexEntry>> staleEntries;
+        const std::string regTxPrefix = NftIndexKeyPrefix(DB_NFT_BY_REGTX);
+        std::unique_ptr<leveldb::Iterator> dbIt(m_db.NewIterator());
+        for (dbIt->Seek(regTxPrefix); dbIt->Valid() && dbIt->key().starts_with(regTxPrefix); dbIt->Next())
+        {
+            CDataStream streamKey(dbIt->key().data(), dbIt->key().data() + dbIt->key().size(), SER_DISK, CLIENT_VERSION);
+            CDataStream streamValue(dbIt->value().data(), dbIt->value().data() + dbIt->value().size(), SER_DISK, CLIENT_VERSION);
+            std::pair<char, uint256> key;
+            NftIndexEntry entry;
+            try
+            {
+                streamKey >> key;
+                streamValue >> entry;
+            }
+            catch (const std::exception & ex)
+            {
+                LogPrintf("%s : Deserialize or I/O error - %s", __func__, ex.what());
+                continue;
+            }
+            staleEntries.emplace_back(key.second, entry);
+        }
+        HandleError(dbIt->status());
+        dbIt.reset();
+        for (const auto & staleEntry : staleEntries)
+            EraseNftSecondaryIndexes(staleEntry.second, staleEntry.first);
+
+        unsigned int count = 0;
+        ProcessNftIndexGutsOnly([&](NfTokenIndex nftIndex) -> bool
+        {
+            NftIndexEntry entry;
+            entry.protocolId = nftIndex.NfTokenPtr()->tokenProtocolId;
+            entry.tokenId = nftIndex.NfTokenPtr()->tokenId;
+            entry.ownerId = nftIndex.NfTokenPtr()->tokenOwnerKeyId;
+            entry.height = nftIndex.BlockIndex()->nHeight;
+            WriteNftSecondaryIndexes(entry, nftIndex.RegTxHash());
+            count++;
+            return true;
+        });
+        this->Write(DB_NFT_SECONDARY_INDEXES, NFT_SECONDARY_INDEXES_VERSION);
+
+        LOCK(m_cs);
+        if (m_blockTransaction == nullptr)
+        {
+            m_dbTransaction.Commit();
+            ClearPendingNftIdKeys();
+        }
+        LogPrintf("%s: indexed %u NFTs by owner, protocol, height and registration tx\n", __func__, count);
+    }
+
+    bool PlatformDb::ReadNftIdByRegTx(const uint256 &regTxHash, uint64_t &protocolId, uint256 &tokenId)
+    {
+        NftIndexEntry entry;
+        if (!this->Read(std::make_pair(DB_NFT_BY_REGTX, regTxHash), entry))
+            return false;
+
+        protocolId = entry.protocolId;
+        tokenId = entry.tokenId;
+        return true;
+    }
+
+    unsigned int PlatformDb::CountNftsByOwner(const CKeyID &ownerId)
+    {
+        return CountNftIdsByPrefix(NftIndexKeyPrefix(DB_NFT_BY_OWNER_HEIGHT, ownerId));
+    }
+
+    unsigned int PlatformDb::CountNftsByOwner(uint64_t protocolId, const CKeyID &ownerId)
+    {
+        return CountNftIdsByPrefix(NftIndexKeyPrefix(DB_NFT_BY_OWNER_PROTO_HEIGHT, ownerId, protocolId));
+    }
+
+    void PlatformDb::ProcessNftIdsByOwner(const CKeyID &ownerId, std::function<bool(uint64_t, const uint256 &)> nftIdHandler)
+    {
+        ProcessNftIdsByPrefix(NftIndexKeyPrefix(DB_NFT_BY_OWNER_HEIGHT, ownerId), nftIdHandler);
+    }
+
+    void PlatformDb::ProcessNftIdsByOwner(uint64_t protocolId, const CKeyID &ownerId, std::function<bool(uint64_t, const uint256 &)> nftIdHandler)
+    {
+        ProcessNftIdsByPrefix(NftIndexKeyPrefix(DB_NFT_BY_OWNER_PROTO_HEIGHT, ownerId, protocolId), nftIdHandler);
+    }
+
+    void PlatformDb::ProcessNftIdsByHeight(unsigned int height, unsigned int count, unsigned int skipFromTip,
+                                           std::function<bool(uint64_t, const uint256 &)> nftIdHandler)
+    {
+        ProcessNftIdsByPrefixAndHeight(NftIndexKeyPrefix(DB_NFT_BY_HEIGHT), height, count, skipFromTip, nftIdHandler);
+    }
+
+    void PlatformDb::ProcessNftIdsByHeight(uint64_t protocolId, unsigned int height, unsigned int count, unsigned int skipFromTip,
+                                           std::function<bool(uint64_t, const uint256 &)> nftIdHandler)
+    {
+        ProcessNftIdsByPrefixAndHeight(NftIndexKeyPrefix(DB_NFT_BY_PROTO_HEIGHT, protocolId), height, count, skipFromTip, nftIdHandler);
+    }
+
+    void PlatformDb::ProcessNftIdsByHeight(const CKeyID &ownerId, unsigned int height, unsigned int count, unsigned int skipFromTip,
+                                           std::function<bool(uint64_t, const uint256 &)> nftIdHandler)
+    {
+        ProcessNftIdsByPrefixAndHeight(NftIndexKeyPrefix(DB_NFT_BY_OWNER_HEIGHT, ownerId), height, count, skipFromTip, nftIdHandler);
+    }
+
+    void PlatformDb::ProcessNftIdsByHeight(uint64_t protocolId, const CKeyID &ownerId, unsigned int height, unsigned int count, unsigned int skipFromTip,
+                                           std::function<bool(uint64_t, const uint256 &)> nftIdHandler)
+    {
+        ProcessNftIdsByPrefixAndHeight(NftIndexKeyPrefix(DB_NFT_BY_OWNER_PROTO_HEIGHT, ownerId, protocolId), height, count, skipFromTip, nftIdHandler);
+    }
+
+    static bool ReadNftId(const leveldb::Slice & sliceValue, uint64_t & protocolId, uint256 & tokenId)
+    {
+        CDataStream streamValue(sliceValue.data(), sliceValue.data() + sliceValue.size(), SER_DISK, CLIENT_VERSION);
+        std::pair<uint64_t, uint256> nftId;
+
+        try
+        {
+            streamValue >> nftId;
+        }
+        catch (const std::exception & ex)
+        {
+            LogPrintf("%s : Deserialize or I/O error - %s", __func__, ex.what());
+            return false;
+        }
+
+        protocolId = nftId.first;
+        tokenId = nftId.second;
+        return true;
+    }
+
+    void PlatformDb::ProcessNftIdValues(const std::string & prefix, const std::string & upperKey,
+                                        std::function<bool(const leveldb::Slice &)> valueHandler)
+    {
+        LOCK(m_cs);
+        const bool backwards = !upperKey.empty();
+
+        /// The pending keys in the walk range, in walk order
+        std::vector<const std::pair<const std::string, Optional<std::string>> *> pendingKeys;
+        for (auto it = m_pendingNftIdKeys.lower_bound(prefix);
+             it != m_pendingNftIdKeys.end() && it->first.compare(0, prefix.size(), prefix) == 0 && (!backwards || it->first < upperKey);
+             ++it)
+        {
+            pendingKeys.push_back(&*it);
+        }
+        if (backwards)
+            std::reverse(pendingKeys.begin(), pendingKeys.end());
+
+        std::unique_ptr<leveldb::Iterator> dbIt(m_db.NewIterator());
+        if (backwards)
+        {
+            dbIt->Seek(upperKey);
+            if (dbIt->Valid())
+                dbIt->Prev();
+            else
+                dbIt->SeekToLast();
+        }
+        else
+        {
+            dbIt->Seek(prefix);
+        }
+
+        size_t pendingPos = 0;
+        for (;;)
+        {
+            const bool dbValid = dbIt->Valid() && dbIt->key().starts_with(prefix);
+            if (!dbValid && pendingPos == pendingKeys.size())
+                break;
+
+            /// Below zero the db key comes first in walk order, zero means the pending mutation replaces it
+            int order;
+            if (!dbValid)
+                order = 1;
+            else if (pendingPos == pendingKeys.size())
+                order = -1;
+            else
+                order = dbIt->key().compare(leveldb::Slice(pendingKeys[pendingPos]->first)) * (backwards ? -1 : 1);
+
+            bool proceed = true;
+            if (order < 0)
+            {
+                proceed = valueHandler(dbIt->value());
+            }
+            else
+            {
+                const auto & pendingValue = pendingKeys[pendingPos++]->second;
+                if (pendingValue)
+                    proceed = valueHandler(leveldb::Slice(*pendingValue));
+            }
+
+            if (order <= 0)
+            {
+                if (backwards)
+                    dbIt->Prev();
+                else
+                    dbIt->Next();
+            }
+            if (!proceed)
+                break;
+        }
+
+        HandleError(dbIt->status());
+    }
+
+    void PlatformDb::ProcessNftIdsByPrefix(const std::string & prefix, std::function<bool(uint64_t, const uint256 &)> nftIdHandler)
+    {
+        ProcessNftIdValues(prefix, std::string(), [&](const leveldb::Slice & value) -> bool
+        {
+            uint64_t protocolId;
+            uint256 tokenId;
+            if (!ReadNftId(value, protocolId, tokenId))
+                return true;
+            return nftIdHandler(protocolId, tokenId);
+        });
+    }
+
+    unsigned int PlatformDb::CountNftIdsByPrefix(const std::string & prefix)
+    {
+        unsigned int count = 0;
+        ProcessNftIdValues(prefix, std::string(), [&](const leveldb::Slice &) -> bool
+        {
+            count++;
+            return true;
+        });
+        return count;
+    }
+
+    void PlatformDb::ProcessNftIdsByPrefixAndHeight(const std::string & prefix, unsigned int height, unsigned int count, unsigned int skipFromTip,
+                                                    std::function<bool(uint64_t, const uint256 &)> nftIdHandler)
+    {
+        /// Walk back from the first key above the height, skip the most recent ones and keep the next `count`
+        CDataStream ssUpper(SER_DISK, CLIENT_VERSION);
+        ssUpper << NftIndexHeight{std::min<uint32_t>(height, std::numeric_limits<uint32_t>::max() - 1) + 1};
+
+        std::vector<std::pair<uint64_t, uint256>> nftIds;
+        unsigned int skipped = 0;
+        if (count > 0)
+        {
+            ProcessNftIdValues(prefix, prefix + std::string(ssUpper.begin(), ssUpper.end()), [&](const leveldb::Slice & value) -> bool
+            {
+                if (skipped < skipFromTip)
+                {
+                    skipped++;
+                    return true;
+                }
+
+                std::pair<uint64_t, uint256> nftId;
+                if (ReadNftId(value, nftId.first, nftId.second))
+                    nftIds.emplace_back(std::move(nftId));
+                return nftIds.size() < count;
+            });
+        }
+
+        for (auto it = nftIds.rbegin(); it != nftIds.rend(); ++it)
+        {
+            if (!nftIdHandler(it->first, it->second))
+                break;
+        }
+    }
+
     NfTokenIndex PlatformDb::ReadNftIndex(const uint64_t &protocolId, const uint256 &tokenId)
     {
         NfTokenDiskIndex nftDiskIndex;
@@ -14,15 +14,47 @@
 #include <leveldb/write_batch.h>
 
 #include <leveldbwrapper.h>
+#include <optional.h>
+
+#include <map>
 
 class BlockIndex;
 
 namespace Platform
 {
+    /// Block height stored big-endian, so the secondary NFT index keys are ordered by height
+    struct NftIndexHeight
+    {
+        uint32_t height;
+
+        SERIALIZE_METHODS(NftIndexHeight, obj)
+        {
+            READWRITE(Using<BigEndianFormatter<4>>(obj.height));
+        }
+
+        friend bool operator<(const NftIndexHeight & a, const NftIndexHeight & b) { return a.height < b.height; }
+    };
+
+    /// The fields the secondary index keys of an NFT are made of, stored under its registration tx
+    struct NftIndexEntry
+    {
+        uint64_t protocolId{0};
+        uint256 tokenId;
+        CKeyID ownerId;
+        uint32_t height{0};
+
+        SERIALIZE_METHODS(NftIndexEntry, obj)
+        {
+            READWRITE(obj.protocolId, obj.tokenId, obj.ownerId, obj.height);
+        }
+    };
+
     enum class PlatformOpt
     {
         OptSpeed,
-        OptRam
+        OptRam,
+        /// RAM optimized, with a bounded cache of the recently used nf-tokens
+        OptTiered
     };
 
     class PlatformDb : public TransactionLevelDBWrapper
@@ -53,21 +85,59 @@ namespace Platform
         static NftProtoIndex NftProtoDiskIndexToNftProtoMemIndex(const NftProtoDiskIndex &protoDiskIndex);
         static BlockIndex * FindBlockIndex(const uint256 & blockHash);
 
-        bool OptimizeRam() const { return m_optSetting == PlatformOpt::OptRam; }
+        bool OptimizeRam() const { return m_optSetting != PlatformOpt::OptSpeed; }
         bool OptimizeSpeed() const { return m_optSetting == PlatformOpt::OptSpeed; }
+        bool TieredNftIndex() const { return m_optSetting == PlatformOpt::OptTiered; }
 
         void ProcessPlatformDbGuts(std::function<bool(const leveldb::Iterator &)> processor);
         void ProcessNftIndexGutsOnly(std::function<bool(NfTokenIndex)> nftIndexHandler);
         void ProcessNftProtoIndexGutsOnly(std::function<bool(NftProtoIndex)> protoIndexHandler);
+        /// Startup load: the records are deserialized and resolved to block indexes on several threads,
+        /// then passed to the handler in key order. The expected count is used to reserve memory
+        void LoadNftIndexGuts(size_t expectedCount, std::function<bool(NfTokenIndex)> nftIndexHandler);
+        void LoadNftProtoIndexGuts(size_t expectedCount, std::function<bool(NftProtoIndex)> protoIndexHandler);
+        void ProcessNftSupplyGutsOnly(std::function<bool(uint64_t, unsigned int)> protoSupplyHandler);
         bool ProcessNftIndex(const leveldb::Iterator & dbIt, std::function<bool(NfTokenIndex)> nftIndexHandler);
         bool ProcessNftProtoIndex(const leveldb::Iterator & dbIt, std::function<bool(NftProtoIndex)> protoIndexHandler);
         bool ProcessNftSupply(const leveldb::Iterator & dbIt, std::function<bool(uint64_t, unsigned int)> protoSupplyHandler);
 
+        /// Collect the platform db mutations of a block, written in one batch by CommitBlockBatch
+        void BeginBlockBatch();
+        void CommitBlockBatch();
+        /// Drop the mutations collected since BeginBlockBatch
+        void AbortBlockBatch();
+        bool InBlockBatch();
+
+        /// The last block connected to the platform state, or the parent of the last disconnected one
+        void WriteBestBlock(const uint256 & blockHash);
+        bool ReadBestBlock(uint256 & blockHash);
+
         bool IsNftIndexEmpty();
         void WriteNftDiskIndex(const NfTokenDiskIndex & nftDiskIndex);
         void EraseNftDiskIndex(const uint64_t &protocolId, const uint256 &tokenId);
         NfTokenIndex ReadNftIndex(const uint64_t &protocolId, const uint256 &tokenId);
 
+        /// Whether the secondary NFT indexes cover every NFT record, see BuildNftSecondaryIndexes
+        bool HasNftSecondaryIndexes();
+        /// Write the secondary index keys of every NFT record, for databases created before they existed
+        void BuildNftSecondaryIndexes();
+        /// Protocol and token ID of the NFT registered in a specified transaction
+        bool ReadNftIdByRegTx(const uint256 &regTxHash, uint64_t &protocolId, uint256 &tokenId);
+        unsigned int CountNftsByOwner(const CKeyID &ownerId);
+        unsigned int CountNftsByOwner(uint64_t protocolId, const CKeyID &ownerId);
+        void ProcessNftIdsByOwner(const CKeyID &ownerId, std::function<bool(uint64_t, const uint256 &)> nftIdHandler);
+        void ProcessNftIdsByOwner(uint64_t protocolId, const CKeyID &ownerId, std::function<bool(uint64_t, const uint256 &)> nftIdHandler);
+        /// Pass the NFTs registered up to a specified height to the handler in height order, like the speed
+        /// optimized ranges: the last `count` of them after leaving out the `skipFromTip` most recent ones
+        void ProcessNftIdsByHeight(unsigned int height, unsigned int count, unsigned int skipFromTip,
+                                   std::function<bool(uint64_t, const uint256 &)> nftIdHandler);
+        void ProcessNftIdsByHeight(uint64_t protocolId, unsigned int height, unsigned int count, unsigned int skipFromTip,
+                                   std::function<bool(uint64_t, const uint256 &)> nftIdHandler);
+        void ProcessNftIdsByHeight(const CKeyID &ownerId, unsigned int height, unsigned int count, unsigned int skipFromTip,
+                                   std::function<bool(uint64_t, const uint256 &)> nftIdHandler);
+        void ProcessNftIdsByHeight(uint64_t protocolId, const CKeyID &ownerId, unsigned int height, unsigned int count, unsigned int skipFromTip,
+                                   std::function<bool(uint64_t, const uint256 &)> nftIdHandler);
+
         void WriteTotalSupply(unsigned int count, uint64_t nftProtocolId = NfToken::UNKNOWN_TOKEN_PROTOCOL);
         bool ReadTotalSupply(unsigned int & count, uint64_t nftProtocolId = NfToken::UNKNOWN_TOKEN_PROTOCOL);
 
@@ -86,14 +156,45 @@ namespace Platform
                 bool fWipe = false
                 );
 
+        /// Raw values of every record with a specified key prefix
+        std::vector<std::string> ReadRawValuesByPrefix(char prefix, size_t expectedCount);
+
+        /// The secondary indexes are only maintained when RAM is optimized, speed mode answers from memory
+        void WriteNftSecondaryIndexes(const NftIndexEntry & entry, const uint256 & regTxHash);
+        void EraseNftSecondaryIndexes(const NftIndexEntry & entry, const uint256 & regTxHash);
+        /// Forget the secondary index mutations once the transaction holding them is committed or dropped
+        void ClearPendingNftIdKeys();
+
+        /// Walk the values of the keys starting with the serialized prefix, in key order or backwards from
+        /// below the upper key when one is given. The index mutations not committed yet are merged in
+        void ProcessNftIdValues(const std::string & prefix, const std::string & upperKey,
+                                std::function<bool(const leveldb::Slice &)> valueHandler);
+        /// Pass every secondary index value whose key starts with the serialized prefix
+        void ProcessNftIdsByPrefix(const std::string & prefix, std::function<bool(uint64_t, const uint256 &)> nftIdHandler);
+        unsigned int CountNftIdsByPrefix(const std::string & prefix);
+        /// Height ordered variant, the prefix is followed by an NftIndexHeight in every key
+        void ProcessNftIdsByPrefixAndHeight(const std::string & prefix, unsigned int height, unsigned int count, unsigned int skipFromTip,
+                                            std::function<bool(uint64_t, const uint256 &)> nftIdHandler);
+
     public:
         static const char DB_NFT;
         static const char DB_NFT_TOTAL;
         static const char DB_NFT_PROTO;
         static const char DB_NFT_PROTO_TOTAL;
+        static const char DB_NFT_BY_REGTX;
+        static const char DB_NFT_BY_HEIGHT;
+        static const char DB_NFT_BY_PROTO_HEIGHT;
+        static const char DB_NFT_BY_OWNER_HEIGHT;
+        static const char DB_NFT_BY_OWNER_PROTO_HEIGHT;
+        static const char DB_NFT_SECONDARY_INDEXES;
+        static const char DB_BEST_BLOCK;
 
     private:
         PlatformOpt m_optSetting = PlatformOpt::OptSpeed;
+        std::unique_ptr<CScopedDBTransaction> m_blockTransaction;
+        /// Serialized height ordered index keys written (or erased, no value) in the open transaction,
+        /// the raw db iterators behind the index seeks do not see them
+        std::map<std::string, Optional<std::string>> m_pendingNftIdKeys GUARDED_BY(m_cs);
 
         static std::unique_ptr<PlatformDb> s_instance;
     };
@@ -12,6 +12,7 @@
 #include <platform/nf-token/nf-token-reg-tx-builder.h>
 #include <platform/nf-token/nf-tokens-manager.h>
 #include <platform/nf-token/nft-protocols-manager.h>
+#include <platform/platform-db.h>
 #include <platform/rpc/specialtx-rpc-utils.h>
 #include <platform/rpc/rpc-nf-token.h>
 
@@ -22,7 +23,7 @@ UniValue nftoken(const JSONRPCRequest& request)
         throw std::runtime_error("NFT spork is off");
     }
 
-    std::string command = request.params[0].get_str();// Platform::GetCommand(params, "usage: nftoken register(issue)|list|get|getbytxid|totalsupply|balanceof|ownerof");
+    std::string command = request.params[0].get_str();// Platform::GetCommand(params, "usage: nftoken register(issue)|list|get|getbytxid|totalsupply|balanceof|ownerof|cacheinfo");
 
     if (command == "register" || command == "issue")
         return Platform::RegisterNfToken(request.params);
@@ -38,6 +39,8 @@ UniValue nftoken(const JSONRPCRequest& request)
         return Platform::NfTokenBalanceOf(request.params);
     else if (command == "ownerof")
         return Platform::NfTokenOwnerOf(request.params);
+    else if (command == "cacheinfo")
+        return Platform::NfTokenCacheInfo(request.params);
 
     throw std::runtime_error("Invalid command: " + command);
 }
@@ -426,4 +429,52 @@ Examples:
 
         return EncodeDestination(PKHash(ownerId));
     }
+
+    void NfTokenCacheInfoHelp()
+    {
+        static std::string helpMessage = R"(nftoken cacheinfo
+Get the size, memory usage and hit rate of the NFT index kept in memory
+
+Result:
+{
+  "mode":       (string) The platform db optimization: speed, ram or tiered
+  "entries":    (numeric) The number of NFTs in memory
+  "memusage":   (numeric) The estimated memory usage of the NFTs in memory, in bytes
+  "budget":     (numeric) The memory budget in the tiered mode, in bytes
+  "hits":       (numeric) The number of lookups answered from memory
+  "misses":     (numeric) The number of lookups read from the platform database
+  "hitrate":    (numeric) The share of lookups answered from memory
+  "evictions":  (numeric) The number of NFTs evicted to fit the memory budget
+}
+
+Examples:
+)"
++ HelpExampleCli("nftoken", "cacheinfo")
++ HelpExampleRpc("nftoken", "cacheinfo");
+
+        throw std::runtime_error(helpMessage);
+    }
+
+    UniValue NfTokenCacheInfo(const UniValue& params)
+    {
+        NfTokensCacheStats stats = NfTokensManager::Instance().GetCacheStats();
+        uint64_t lookups = stats.hits + stats.misses;
+
+        std::string mode = "speed";
+        if (PlatformDb::Instance().TieredNftIndex())
+            mode = "tiered";
+        else if (PlatformDb::Instance().OptimizeRam())
+            mode = "ram";
+
+        UniValue result(UniValue::VOBJ);
+        result.pushKV("mode", mode);
+        result.pushKV("entries", static_cast<uint64_t>(stats.entries));
+        result.pushKV("memusage", static_cast<uint64_t>(stats.memoryUsage));
+        result.pushKV("budget", static_cast<uint64_t>(stats.memoryBudget));
+        result.pushKV("hits", stats.hits);
+        result.pushKV("misses", stats.misses);
+        result.pushKV("hitrate", lookups == 0 ? 0.0 : static_cast<double>(stats.hits) / lookups);
+        result.pushKV("evictions", stats.evictions);
+        return result;
+    }
 }
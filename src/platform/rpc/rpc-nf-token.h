@@ -16,6 +16,7 @@ namespace Platform
     UniValue NfTokenTotalSupply(const UniValue& params);
     UniValue NfTokenBalanceOf(const UniValue& params);
     UniValue NfTokenOwnerOf(const UniValue& params);
+    UniValue NfTokenCacheInfo(const UniValue& params);
 }
 
 #endif // CROWN_PLATFORM_RPC_NF_TOKEN_H
@@ -4,16 +4,21 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <clientversion.h>
+#include <consensus/validation.h>
+#include <dbwrapper.h>
 #include <hash.h>
+#include <leveldbwrapper.h>
 #include <platform/governance.h>
 #include <platform/governance-vote.h>
 #include <platform/nf-token/nf-token-protocol-reg-tx.h>
 #include <platform/nf-token/nf-token-reg-tx.h>
 #include <platform/nf-token/nf-tokens-manager.h>
 #include <platform/nf-token/nft-protocols-manager.h>
+#include <platform/platform-db.h>
 #include <platform/specialtx.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
+#include <validation.h>
 
 bool CheckNftTx(const CTransaction& tx, const CBlockIndex* pindexLast, TxValidationState& state)
 {
@@ -73,8 +78,49 @@ bool UndoNftTx(const CTransaction& tx, const CBlockIndex* pindex)
     return false;
 }
 
+CNftBlockBatch::CNftBlockBatch()
+{
+    Platform::PlatformDb::Instance().BeginBlockBatch();
+}
+
+CNftBlockBatch::~CNftBlockBatch()
+{
+    if (m_committed)
+        return;
+    Platform::PlatformDb::Instance().AbortBlockBatch();
+    Platform::NfTokensManager::Instance().AbortBlockChanges();
+    Platform::NftProtocolsManager::Instance().AbortBlockChanges();
+}
+
+void CNftBlockBatch::Commit()
+{
+    assert(!m_committed);
+    Platform::NfTokensManager::Instance().CommitBlockChanges();
+    Platform::NftProtocolsManager::Instance().CommitBlockChanges();
+    Platform::PlatformDb::Instance().CommitBlockBatch();
+    m_committed = true;
+}
+
+// A replay reconnects blocks the platform db may have been written past before the chainstate was flushed
+static bool IsNftBlockApplied(const CBlockIndex* pindex)
+{
+    uint256 bestBlockHash;
+    if (!Platform::PlatformDb::Instance().ReadBestBlock(bestBlockHash) || pindex->pprev == nullptr || bestBlockHash == pindex->pprev->GetBlockHash())
+        return false;
+    const CBlockIndex* pindexBest = LookupBlockIndex(bestBlockHash);
+    return pindexBest != nullptr && pindexBest->GetAncestor(pindex->nHeight) == pindex;
+}
+
 bool ProcessNftTxsInBlock(const CBlock& block, const CBlockIndex* pindex, TxValidationState& state)
 {
+    AssertLockHeld(cs_main);
+    assert(Platform::PlatformDb::Instance().InBlockBatch());
+
+    if (IsNftBlockApplied(pindex)) {
+        LogPrintf("%s -- block %s is in the platform db already\n", __func__, pindex->GetBlockHash().ToString());
+        return true;
+    }
+
     int64_t nTimeLoop = 0;
     try {
         int64_t nTime1 = GetTimeMicros();
@@ -89,15 +135,30 @@ bool ProcessNftTxsInBlock(const CBlock& block, const CBlockIndex* pindex, TxVali
         }
         int64_t nTime2 = GetTimeMicros(); nTimeLoop += nTime2 - nTime1;
         LogPrint(BCLog::BENCH, "        - ProcessNftTxsInBlock: %.2fms [%.2fs]\n", 0.001 * (nTime2 - nTime1), nTimeLoop * 0.000001);
+    } catch (const leveldb_error& e) {
+        // a local storage failure, the block itself may be fine
+        return state.Error(strprintf("%s -- platform db failure: %s", __func__, e.what()));
+    } catch (const dbwrapper_error& e) {
+        return state.Error(strprintf("%s -- database failure: %s", __func__, e.what()));
     } catch (const std::exception& e) {
         LogPrintf("%s -- failed: %s\n", __func__, e.what());
     }
 
+    Platform::PlatformDb::Instance().WriteBestBlock(pindex->GetBlockHash());
     return true;
 }
 
 bool UndoNftTxsInBlock(const CBlock& block, const CBlockIndex* pindex)
 {
+    AssertLockHeld(cs_main);
+    assert(Platform::PlatformDb::Instance().InBlockBatch());
+
+    uint256 bestBlockHash;
+    if (Platform::PlatformDb::Instance().ReadBestBlock(bestBlockHash) && bestBlockHash != pindex->GetBlockHash()) {
+        LogPrintf("%s -- block %s is not in the platform db\n", __func__, pindex->GetBlockHash().ToString());
+        return true;
+    }
+
     int64_t nTimeLoop = 0;
     try {
         int64_t nTime1 = GetTimeMicros();
@@ -110,9 +171,11 @@ bool UndoNftTxsInBlock(const CBlock& block, const CBlockIndex* pindex)
         int64_t nTime2 = GetTimeMicros(); nTimeLoop += nTime2 - nTime1;
         LogPrint(BCLog::BENCH, "        - UndoNftTxsInBlock: %.2fms [%.2fs]\n", 0.001 * (nTime2 - nTime1), nTimeLoop * 0.000001);
     } catch (const std::exception& e) {
-        return error(strprintf("%s -- failed: %s\n", __func__, e.what()).c_str());
+        return error("%s -- failed: %s\n", __func__, e.what());
     }
 
+    if (pindex->pprev != nullptr)
+        Platform::PlatformDb::Instance().WriteBestBlock(pindex->pprev->GetBlockHash());
     return true;
 }
 
@@ -20,8 +20,27 @@ class CBlock;
 class CBlockIndex;
 class TxValidationState;
 
+/** The platform db batch and in-memory NFT changes of the blocks connected or disconnected in its scope.
+ *  Rolled back unless committed, so a block that is only checked or fails later in validation leaves no trace */
+class CNftBlockBatch
+{
+public:
+    CNftBlockBatch();
+    ~CNftBlockBatch();
+    CNftBlockBatch(const CNftBlockBatch&) = delete;
+    CNftBlockBatch& operator=(const CNftBlockBatch&) = delete;
+
+    /// Write the batch, next to the flush of the coins view the blocks were applied to
+    void Commit();
+
+private:
+    bool m_committed{false};
+};
+
 bool CheckNftTx(const CTransaction& tx, const CBlockIndex* pindex, TxValidationState& state);
+/// Apply the NFT txs of a block to the open CNftBlockBatch, skipped if the platform db already holds the block
 bool ProcessNftTxsInBlock(const CBlock& block, const CBlockIndex* pindex, TxValidationState& state);
+/// Undo the NFT txs of a block in the open CNftBlockBatch, skipped if the platform db does not hold the block
 bool UndoNftTxsInBlock(const CBlock& block, const CBlockIndex* pindex);
 void UpdateNftTxsBlockTip(const CBlockIndex* pindex);
 uint256 CalcNftTxInputsHash(const CTransaction& tx);
@@ -1,4 +1,5 @@
 #include <arith_uint256.h>
+#include <crypto/common.h>
 #include <hash.h>
 #include <pos/kernel.h>
 #include <pos/stakepointer.h>
@@ -49,6 +50,17 @@ bool Kernel::IsValidProof(const uint256& nTarget)
     return CheckProof(target, hashProof, m_nAmount);
 }
 
+bool Kernel::SearchValidProof(uint64_t nTimeStart, uint64_t nTimeEnd, const uint256& nTarget)
+{
+    KernelSearch search(m_outpoint, m_nAmount, m_nStakeModifier, m_nTimeBlockFrom, nTarget);
+    uint64_t nTimeFound;
+    if (!search.Search(nTimeStart, nTimeEnd, nTimeFound))
+        return false;
+
+    m_nTimeStake = nTimeFound;
+    return true;
+}
+
 void Kernel::SetStakeTime(uint64_t nTime)
 {
     m_nTimeStake = nTime;
@@ -59,3 +71,47 @@ std::string Kernel::ToString()
     return strprintf("OutPoint: %s:%d Modifier=%s timeblockfrom=%d time=%d amount=%d", m_outpoint.hash.GetHex(),
         m_outpoint.n, m_nStakeModifier.GetHex(), m_nTimeBlockFrom, m_nTimeStake, m_nAmount);
 }
+
+KernelSearch::KernelSearch(const COutPoint& outpoint, const uint64_t nAmount, const uint256& nStakeModifier,
+    const uint64_t nTimeBlockFrom, const uint256& nTarget)
+{
+    // same layout as the CDataStream serialization in Kernel::GetStakeHash
+    unsigned char data[SERIALIZED_SIZE];
+    memcpy(data, outpoint.hash.begin(), 32);
+    WriteLE32(data + 32, outpoint.n);
+    memcpy(data + 36, nStakeModifier.begin(), 32);
+    WriteLE64(data + 68, nTimeBlockFrom);
+    WriteLE64(data + 76, 0);
+
+    m_midstate.Write(data, 64);
+    memcpy(m_tail, data + 64, sizeof(m_tail));
+    m_weightedTarget = nAmount * UintToArith256(nTarget);
+}
+
+uint256 KernelSearch::GetStakeHash(uint64_t nTimeStake) const
+{
+    unsigned char tail[sizeof(m_tail)];
+    memcpy(tail, m_tail, sizeof(tail) - 8);
+    WriteLE64(tail + sizeof(tail) - 8, nTimeStake);
+
+    uint256 hash;
+    CSHA256(m_midstate).Write(tail, sizeof(tail)).Finalize(hash.begin());
+    CSHA256().Write(hash.begin(), CSHA256::OUTPUT_SIZE).Finalize(hash.begin());
+    return hash;
+}
+
+bool KernelSearch::IsValidProof(uint64_t nTimeStake) const
+{
+    return UintToArith256(GetStakeHash(nTimeStake)) < m_weightedTarget;
+}
+
+bool KernelSearch::Search(uint64_t nTimeStart, uint64_t nTimeEnd, uint64_t& nTimeRet) const
+{
+    for (uint64_t nTime = nTimeStart; nTime <= nTimeEnd; nTime++) {
+        if (IsValidProof(nTime)) {
+            nTimeRet = nTime;
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,10 +1,11 @@
 #ifndef CROWN_CORE_KERNEL_H
 #define CROWN_CORE_KERNEL_H
 
+#include <arith_uint256.h>
+#include <crypto/sha256.h>
 #include <uint256.h>
 #include <primitives/transaction.h>
 
-class arith_uint256;
 class StakePointer;
 
 class Kernel {
@@ -14,6 +15,7 @@ public:
     uint256 GetStakeHash();
     uint64_t GetTime() const;
     bool IsValidProof(const uint256& nTarget);
+    bool SearchValidProof(uint64_t nTimeStart, uint64_t nTimeEnd, const uint256& nTarget);
     void SetStakeTime(uint64_t nTime);
     std::string ToString();
 
@@ -27,4 +29,29 @@ private:
     uint64_t m_nAmount {0};
 };
 
+/*
+ * Evaluates the proof hash of one kernel for many stake times. Only the stake time changes between
+ * candidates, so the SHA256 state after the first 64 bytes of the serialized kernel and the
+ * amount weighted target are computed once instead of for every second searched.
+ */
+class KernelSearch {
+public:
+    KernelSearch(const COutPoint& outpoint, const uint64_t nAmount, const uint256& nStakeModifier,
+        const uint64_t nTimeBlockFrom, const uint256& nTarget);
+    uint256 GetStakeHash(uint64_t nTimeStake) const;
+    bool IsValidProof(uint64_t nTimeStake) const;
+
+    //! Find the first stake time in [nTimeStart, nTimeEnd] giving a valid proof
+    bool Search(uint64_t nTimeStart, uint64_t nTimeEnd, uint64_t& nTimeRet) const;
+
+private:
+    static const size_t SERIALIZED_SIZE = 84;
+
+    // hasher state after the first SHA256 block of the serialized kernel
+    CSHA256 m_midstate;
+    // the rest of the serialized kernel, ending with the stake time
+    unsigned char m_tail[SERIALIZED_SIZE - 64];
+    arith_uint256 m_weightedTarget;
+};
+
 #endif //CROWN_CORE_KERNEL_H
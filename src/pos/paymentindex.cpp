@@ -0,0 +1,134 @@
+#include <chain.h>
+#include <chainparams.h>
+#include <logging.h>
+#include <pos/paymentindex.h>
+#include <primitives/block.h>
+#include <util/time.h>
+#include <validation.h>
+
+NodePaymentIndex g_paymentIndex;
+
+//! Number of blocks kept below the stake pointer window so that a reorg does not leave holes
+static int GetPaymentIndexDepth()
+{
+    return Params().ValidStakePointerDuration() + Params().MaxReorganizationDepth();
+}
+
+void NodePaymentIndex::EraseHeight(int nHeight)
+{
+    auto it = m_mapPayeesByHeight.find(nHeight);
+    if (it == m_mapPayeesByHeight.end())
+        return;
+
+    for (const CScript& payee : it->second) {
+        auto itPayee = m_mapPayments.find(payee);
+        if (itPayee == m_mapPayments.end())
+            continue;
+        auto& mapPayee = itPayee->second;
+        mapPayee.erase(mapPayee.lower_bound(std::make_pair(nHeight, 0u)), mapPayee.lower_bound(std::make_pair(nHeight + 1, 0u)));
+        if (mapPayee.empty())
+            m_mapPayments.erase(itPayee);
+    }
+    m_mapPayeesByHeight.erase(it);
+}
+
+void NodePaymentIndex::EraseBeforeHeight(int nHeight)
+{
+    while (!m_mapPayeesByHeight.empty() && m_mapPayeesByHeight.begin()->first < nHeight) {
+        EraseHeight(m_mapPayeesByHeight.begin()->first);
+    }
+}
+
+void NodePaymentIndex::BlockConnected(const CBlock& block, const CBlockIndex* pindex)
+{
+    if (block.vtx.empty() || !block.vtx[0]->IsCoinBase())
+        return;
+
+    const CTransactionRef& tx = block.vtx[0];
+    const uint256 txid = tx->GetHash();
+    const uint256 hashBlock = pindex->GetBlockHash();
+    const unsigned int nOutputs = (tx->nVersion >= TX_ELE_VERSION ? tx->vpout.size() : tx->vout.size());
+
+    LOCK(cs);
+    // a block at this height may still be indexed if it was disconnected outside of DisconnectBlock
+    EraseHeight(pindex->nHeight);
+
+    std::vector<CScript>& vPayees = m_mapPayeesByHeight[pindex->nHeight];
+    // slot 0 is the block reward, node payments start at slot 1
+    for (unsigned int nPos = 1; nPos < nOutputs; nPos++) {
+        const CScript& payee = (tx->nVersion >= TX_ELE_VERSION ? tx->vpout[nPos].scriptPubKey : tx->vout[nPos].scriptPubKey);
+        if (payee.empty())
+            continue;
+
+        m_mapPayments[payee][std::make_pair(pindex->nHeight, nPos)] = NodePayment{pindex->nHeight, hashBlock, txid, nPos};
+        vPayees.emplace_back(payee);
+    }
+    if (vPayees.empty())
+        m_mapPayeesByHeight.erase(pindex->nHeight);
+
+    EraseBeforeHeight(pindex->nHeight - GetPaymentIndexDepth());
+}
+
+void NodePaymentIndex::BlockDisconnected(const CBlock& block, const CBlockIndex* pindex)
+{
+    LOCK(cs);
+    EraseHeight(pindex->nHeight);
+}
+
+bool NodePaymentIndex::Rebuild(const CChain& chain)
+{
+    AssertLockHeld(cs_main);
+
+    Clear();
+    if (chain.Tip() == nullptr)
+        return true;
+
+    int64_t nStart = GetTimeMillis();
+    int nStartHeight = std::max(1, chain.Height() - GetPaymentIndexDepth());
+    for (const CBlockIndex* pindex = chain[nStartHeight]; pindex; pindex = chain.Next(pindex)) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus()))
+            return error("%s: Failed reading block %s from disk", __func__, pindex->GetBlockHash().GetHex());
+        BlockConnected(block, pindex);
+    }
+
+    LogPrintf("%s: indexed %u node payments from height %d in %dms\n", __func__, size(), nStartHeight, GetTimeMillis() - nStart);
+    return true;
+}
+
+bool NodePaymentIndex::GetPayments(const CScript& payee, unsigned int nPos, int nMinHeight, int nMaxHeight, std::vector<NodePayment>& vPayments) const
+{
+    vPayments.clear();
+
+    LOCK(cs);
+    auto itPayee = m_mapPayments.find(payee);
+    if (itPayee == m_mapPayments.end())
+        return false;
+
+    const auto& mapPayee = itPayee->second;
+    auto itBegin = mapPayee.lower_bound(std::make_pair(nMinHeight, 0u));
+    auto itEnd = mapPayee.lower_bound(std::make_pair(nMaxHeight + 1, 0u));
+    for (auto it = itBegin; it != itEnd; ++it) {
+        if (it->second.nPos != nPos)
+            continue;
+        vPayments.emplace_back(it->second);
+    }
+
+    return !vPayments.empty();
+}
+
+size_t NodePaymentIndex::size() const
+{
+    LOCK(cs);
+    size_t nCount = 0;
+    for (const auto& p : m_mapPayments)
+        nCount += p.second.size();
+    return nCount;
+}
+
+void NodePaymentIndex::Clear()
+{
+    LOCK(cs);
+    m_mapPayments.clear();
+    m_mapPayeesByHeight.clear();
+}
@@ -0,0 +1,64 @@
+#ifndef CROWN_CORE_PAYMENTINDEX_H
+#define CROWN_CORE_PAYMENTINDEX_H
+
+#include <script/script.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <map>
+#include <vector>
+
+class CBlock;
+class CBlockIndex;
+class CChain;
+
+extern RecursiveMutex cs_main;
+
+/*
+ * A coinbase payment made to a masternode or systemnode payee script.
+ *
+ * @param nHeight The height of the block containing the payment
+ * @param hashBlock The hash of the block containing the payment
+ * @param txid The coinbase transaction that paid the node
+ * @param nPos The coinbase output slot holding the payment (MN_PMT_SLOT / SN_PMT_SLOT)
+ */
+struct NodePayment {
+    int nHeight;
+    uint256 hashBlock;
+    uint256 txid;
+    unsigned int nPos;
+};
+
+/*
+ * In-memory index of recent coinbase payments keyed by payee script. It is maintained from
+ * ConnectBlock/DisconnectBlock and only retains the window in which a payment can still be used
+ * as a stake pointer, so stake pointer lookups never need to read blocks from disk.
+ */
+class NodePaymentIndex {
+private:
+    mutable Mutex cs;
+    // payee script => {(height, slot) => payment}
+    std::map<CScript, std::map<std::pair<int, unsigned int>, NodePayment>> m_mapPayments GUARDED_BY(cs);
+    // height => payee scripts paid in that block, used for disconnects and pruning
+    std::map<int, std::vector<CScript>> m_mapPayeesByHeight GUARDED_BY(cs);
+
+    void EraseHeight(int nHeight) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    void EraseBeforeHeight(int nHeight) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+public:
+    void BlockConnected(const CBlock& block, const CBlockIndex* pindex);
+    void BlockDisconnected(const CBlock& block, const CBlockIndex* pindex);
+
+    //! Populate the index from the blocks still inside the stake pointer window of the active chain
+    bool Rebuild(const CChain& chain) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    //! Payments to payee in coinbase slot nPos within [nMinHeight, nMaxHeight], ordered by height
+    bool GetPayments(const CScript& payee, unsigned int nPos, int nMinHeight, int nMaxHeight, std::vector<NodePayment>& vPayments) const;
+
+    size_t size() const;
+    void Clear();
+};
+
+extern NodePaymentIndex g_paymentIndex;
+
+#endif //CROWN_CORE_PAYMENTINDEX_H
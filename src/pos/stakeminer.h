@@ -7,6 +7,9 @@ class CBlock;
 class Kernel;
 class uint256;
 
+//! Number of seconds searched for a valid proof hash per stake pointer
+static const uint32_t STAKE_SEARCH_INTERVAL = 30;
+
 bool SearchTimeSpan(Kernel& kernel, uint32_t nTimeStart, uint32_t nTimeEnd, const uint256& nTarget);
 bool SignBlock(CBlock* pblock);
 #endif //CROWN_CORE_STAKEMINER_H
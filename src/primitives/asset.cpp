@@ -9,191 +9,177 @@
 #include <key_io.h>
 #include <util/moneystr.h>
 #include <util/system.h>
+
+namespace {
+
+/**
+ * Walk the union of two sorted amount maps in a single pass, passing the
+ * amount each side holds for every asset (zero when absent). Stops early and
+ * returns false as soon as fn does.
+ */
+template<typename Fn>
+bool AllAmountPairs(const CAmountMap& a, const CAmountMap& b, Fn fn)
+{
+    CAmountMap::const_iterator ia = a.begin();
+    CAmountMap::const_iterator ib = b.begin();
+    while (ia != a.end() || ib != b.end()) {
+        bool ok;
+        if (ib == b.end() || (ia != a.end() && ia->first < ib->first)) {
+            ok = fn(ia->second, CAmount(0));
+            ++ia;
+        } else if (ia == a.end() || ib->first < ia->first) {
+            ok = fn(CAmount(0), ib->second);
+            ++ib;
+        } else {
+            ok = fn(ia->second, ib->second);
+            ++ia;
+            ++ib;
+        }
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+/** Combine the amounts of the assets present in both maps. */
+template<typename Fn>
+CAmountMap CombineCommonAssets(const CAmountMap& a, const CAmountMap& b, Fn fn)
+{
+    CAmountMap c;
+    CAmountMap::const_iterator jt = b.begin();
+    for (const auto& entry : a) {
+        while (jt != b.end() && jt->first < entry.first)
+            ++jt;
+        if (jt != b.end() && jt->first == entry.first)
+            c.emplace(entry.first, fn(entry.second, jt->second));
+    }
+    return c;
+}
+
+/** Copy a and apply fn to each of its amounts. */
+template<typename Fn>
+CAmountMap TransformAmounts(const CAmountMap& a, Fn fn)
+{
+    CAmountMap c(a);
+    for (auto& entry : c)
+        entry.second = fn(entry.second);
+    return c;
+}
+
+} // namespace
+
 CAmountMap& operator+=(CAmountMap& a, const CAmountMap& b)
 {
-    for(std::map<CAsset, CAmount>::const_iterator it = b.begin(); it != b.end(); ++it)
-        a[it->first] += it->second;
+    for (const auto& entry : b)
+        a[entry.first] += entry.second;
     return a;
 }
 
 CAmountMap& operator-=(CAmountMap& a, const CAmountMap& b)
 {
-    for(std::map<CAsset, CAmount>::const_iterator it = b.begin(); it != b.end(); ++it)
-        a[it->first] -= it->second;
+    for (const auto& entry : b)
+        a[entry.first] -= entry.second;
     return a;
 }
 
 CAmountMap operator+(const CAmountMap& a, const CAmountMap& b)
 {
-    CAmountMap c;
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it)
-        c[it->first] += it->second;
-    for(std::map<CAsset, CAmount>::const_iterator it = b.begin(); it != b.end(); ++it)
-        c[it->first] += it->second;
+    CAmountMap c(a);
+    c += b;
     return c;
 }
 
 CAmountMap operator-(const CAmountMap& a, const CAmountMap& b)
 {
-    CAmountMap c;
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it)
-        c[it->first] += it->second;
-    for(std::map<CAsset, CAmount>::const_iterator it = b.begin(); it != b.end(); ++it)
-        c[it->first] -= it->second;
+    CAmountMap c(a);
+    c -= b;
     return c;
 }
 
 CAmountMap operator*=(const CAmountMap& a, const CAmount& b)
 {
-    CAmountMap c;
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it)
-        c[it->first] = it->second*b;
-    return c;
+    return TransformAmounts(a, [&b](CAmount value) { return value * b; });
 }
 
 CAmountMap operator*(const CAmountMap& a, const CAmount& b)
 {
-    CAmountMap c;
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it)
-        c[it->first] = it->second*b;
-    return c;
+    return TransformAmounts(a, [&b](CAmount value) { return value * b; });
 }
 
 CAmountMap operator/=(const CAmountMap& a, const CAmount& b)
 {
-    CAmountMap c;
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it)
-        c[it->first] = it->second/b;
-    return c;
+    return TransformAmounts(a, [&b](CAmount value) { return value / b; });
 }
 
 CAmountMap operator/(const CAmountMap& a, const CAmount& b)
 {
-    CAmountMap c;
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it)
-        c[it->first] = it->second/b;
-    return c;
+    return TransformAmounts(a, [&b](CAmount value) { return value / b; });
 }
 
 CAmountMap operator%(const CAmountMap& a, const CAmount& b)
 {
-    CAmountMap c;
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it)
-        c[it->first] = it->second%b;
-    return c;
+    return TransformAmounts(a, [&b](CAmount value) { return value % b; });
 }
 
 CAmountMap operator+=(const CAmountMap& a, const CAmount& b)
 {
-    CAmountMap c;
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it)
-        c[it->first] = it->second+b;
-    return c;
+    return TransformAmounts(a, [&b](CAmount value) { return value + b; });
 }
 
 CAmountMap operator+(const CAmountMap& a, const CAmount& b)
 {
-    CAmountMap c;
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it)
-        c[it->first] = it->second+b;
-    return c;
+    return TransformAmounts(a, [&b](CAmount value) { return value + b; });
 }
 
 CAmountMap operator-=(const CAmountMap& a, const CAmount& b)
 {
-    CAmountMap c;
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it)
-        c[it->first] = it->second-b;
-    return c;
+    return TransformAmounts(a, [&b](CAmount value) { return value - b; });
 }
 
 CAmountMap operator-(const CAmountMap& a, const CAmount& b)
 {
-    CAmountMap c;
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it)
-        c[it->first] = it->second-b;
-    return c;
+    return TransformAmounts(a, [&b](CAmount value) { return value - b; });
 }
 
 bool operator<(const CAmountMap& a, const CAmountMap& b)
 {
     bool smallerElement = false;
-    for(std::map<CAsset, CAmount>::const_iterator it = b.begin(); it != b.end(); ++it) {
-        CAmount aValue = a.count(it->first) ? a.find(it->first)->second : 0;
-        if (aValue > it->second)
+    bool ok = AllAmountPairs(a, b, [&smallerElement](CAmount aValue, CAmount bValue) {
+        if (aValue > bValue)
             return false;
-        if (aValue < it->second)
+        if (aValue < bValue)
             smallerElement = true;
-    }
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it) {
-        CAmount bValue = b.count(it->first) ? b.find(it->first)->second : 0;
-        if (it->second > bValue)
-            return false;
-        if (it->second < bValue)
-            smallerElement = true;
-    }
-    return smallerElement;
+        return true;
+    });
+    return ok && smallerElement;
 }
 
 bool operator<=(const CAmountMap& a, const CAmountMap& b)
 {
-    for(std::map<CAsset, CAmount>::const_iterator it = b.begin(); it != b.end(); ++it) {
-        CAmount aValue = a.count(it->first) ? a.find(it->first)->second : 0;
-        if (aValue > it->second)
-            return false;
-    }
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it) {
-        CAmount bValue = b.count(it->first) ? b.find(it->first)->second : 0;
-        if (it->second > bValue)
-            return false;
-    }
-    return true;
+    return AllAmountPairs(a, b, [](CAmount aValue, CAmount bValue) { return aValue <= bValue; });
 }
 
 bool operator>(const CAmountMap& a, const CAmountMap& b)
 {
     bool largerElement = false;
-    for(std::map<CAsset, CAmount>::const_iterator it = b.begin(); it != b.end(); ++it) {
-        CAmount aValue = a.count(it->first) ? a.find(it->first)->second : 0;
-        if (aValue < it->second)
-            return false;
-        if (aValue > it->second)
-            largerElement = true;
-    }
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it) {
-        CAmount bValue = b.count(it->first) ? b.find(it->first)->second : 0;
-        if (it->second < bValue)
+    bool ok = AllAmountPairs(a, b, [&largerElement](CAmount aValue, CAmount bValue) {
+        if (aValue < bValue)
             return false;
-        if (it->second > bValue)
+        if (aValue > bValue)
             largerElement = true;
-    }
-    return largerElement;
+        return true;
+    });
+    return ok && largerElement;
 }
 
 bool operator>=(const CAmountMap& a, const CAmountMap& b)
 {
-    for(std::map<CAsset, CAmount>::const_iterator it = b.begin(); it != b.end(); ++it) {
-        if ((a.count(it->first) ? a.find(it->first)->second : 0) < it->second)
-            return false;
-    }
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it) {
-        if (it->second < (b.count(it->first) ? b.find(it->first)->second : 0))
-            return false;
-    }
-    return true;
+    return AllAmountPairs(a, b, [](CAmount aValue, CAmount bValue) { return aValue >= bValue; });
 }
 
 bool operator==(const CAmountMap& a, const CAmountMap& b)
 {
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it) {
-        if ((b.count(it->first) ? b.find(it->first)->second : 0) != it->second)
-            return false;
-    }
-    for(std::map<CAsset, CAmount>::const_iterator it = b.begin(); it != b.end(); ++it) {
-        if ((a.count(it->first) ? a.find(it->first)->second : 0) != it->second)
-            return false;
-    }
-    return true;
+    return AllAmountPairs(a, b, [](CAmount aValue, CAmount bValue) { return aValue == bValue; });
 }
 
 bool operator!=(const CAmountMap& a, const CAmountMap& b)
@@ -218,7 +204,7 @@ std::ostream& operator <<(std::ostream& os, const CAmountMap& a){
 
 bool hasNegativeValue(const CAmountMap& amount)
 {
-    for(std::map<CAsset, CAmount>::const_iterator it = amount.begin(); it != amount.end(); ++it) {
+    for(CAmountMap::const_iterator it = amount.begin(); it != amount.end(); ++it) {
         if (it->second < 0)
             return true;
     }
@@ -227,7 +213,7 @@ bool hasNegativeValue(const CAmountMap& amount)
 
 bool hasNonPostiveValue(const CAmountMap& amount)
 {
-    for(std::map<CAsset, CAmount>::const_iterator it = amount.begin(); it != amount.end(); ++it) {
+    for(CAmountMap::const_iterator it = amount.begin(); it != amount.end(); ++it) {
         if (it->second <= 0)
             return true;
     }
@@ -355,42 +341,22 @@ CAmount convertfloor(CAsset &a, CAsset &b)
 
 CAmountMap operator*=(const CAmountMap& a, const CAmountMap& b)
 {
-    CAmountMap c;
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it)
-        for(std::map<CAsset, CAmount>::const_iterator jt = b.begin(); jt != b.end(); ++jt)
-            if(it->first == jt->first)
-                c[it->first] = it->second*jt->second;
-    return c;
+    return CombineCommonAssets(a, b, [](CAmount aValue, CAmount bValue) { return aValue * bValue; });
 }
 
 CAmountMap operator*(const CAmountMap& a, const CAmountMap& b)
 {
-    CAmountMap c;
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it)
-        for(std::map<CAsset, CAmount>::const_iterator jt = b.begin(); jt != b.end(); ++jt)
-            if(it->first == jt->first)
-                c[it->first] = it->second*jt->second;
-    return c;
+    return CombineCommonAssets(a, b, [](CAmount aValue, CAmount bValue) { return aValue * bValue; });
 }
 
 CAmountMap operator/=(const CAmountMap& a, const CAmountMap& b)
 {
-    CAmountMap c;
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it)
-        for(std::map<CAsset, CAmount>::const_iterator jt = b.begin(); jt != b.end(); ++jt)
-            if(it->first == jt->first)
-                c[it->first] = it->second/jt->second;
-    return c;
+    return CombineCommonAssets(a, b, [](CAmount aValue, CAmount bValue) { return aValue / bValue; });
 }
 
 CAmountMap operator/(const CAmountMap& a, const CAmountMap& b)
 {
-    CAmountMap c;
-    for(std::map<CAsset, CAmount>::const_iterator it = a.begin(); it != a.end(); ++it)
-        for(std::map<CAsset, CAmount>::const_iterator jt = b.begin(); jt != b.end(); ++jt)
-            if(it->first == jt->first)
-                c[it->first] = it->second/jt->second;
-    return c;
+    return CombineCommonAssets(a, b, [](CAmount aValue, CAmount bValue) { return aValue / bValue; });
 }
 
 std::string AssetTypeToString(uint32_t &type){
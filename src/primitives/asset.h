@@ -5,8 +5,12 @@
 #include <uint256.h>
 
 #include <amount.h>
+#include <prevector.h>
 #include <script/script.h>
 #include <tinyformat.h>
+
+#include <initializer_list>
+#include <stdexcept>
 /**
  *  Native Asset Issuance
  *
@@ -185,8 +189,159 @@ struct CAsset : public AssetMetadata
     std::string ToString(bool mini = true) const;
 };
 
-/** Used for consensus fee and general wallet accounting*/
-typedef std::map<CAsset, CAmount> CAmountMap;
+/** A single asset amount held by a CAmountMap, named like std::map's value_type. */
+struct CAmountMapEntry
+{
+    CAsset first;
+    CAmount second{0};
+
+    CAmountMapEntry() = default;
+    CAmountMapEntry(const CAsset& assetIn, CAmount amountIn) : first(assetIn), second(amountIn) {}
+    template<typename K, typename V>
+    CAmountMapEntry(const std::pair<K, V>& entry) : first(entry.first), second(entry.second) {}
+
+    SERIALIZE_METHODS(CAmountMapEntry, obj) { READWRITE(obj.first, obj.second); }
+};
+static_assert(std::is_trivially_copyable<CAmountMapEntry>::value, "CAmountMap relocates entries with memmove");
+
+/**
+ * Used for consensus fee and general wallet accounting.
+ *
+ * A flat map from asset to amount, kept sorted by asset id so iteration and
+ * serialization match the std::map it replaces. Transactions and blocks
+ * rarely carry more than a couple of assets, so the first INLINE_ASSETS
+ * entries are stored inline and arithmetic on them never touches the heap.
+ */
+class CAmountMap
+{
+public:
+    /** Entries stored without a heap allocation; kept small as every CBlockIndex holds one. */
+    static constexpr unsigned int INLINE_ASSETS = 2;
+
+    typedef CAsset key_type;
+    typedef CAmount mapped_type;
+    typedef CAmountMapEntry value_type;
+
+private:
+    typedef prevector<INLINE_ASSETS, value_type> entries_type;
+    entries_type m_entries;
+
+public:
+    typedef entries_type::size_type size_type;
+    typedef entries_type::iterator iterator;
+    typedef entries_type::const_iterator const_iterator;
+
+    CAmountMap() = default;
+    CAmountMap(std::initializer_list<value_type> entries)
+    {
+        for (const value_type& entry : entries)
+            insert(entry);
+    }
+
+    iterator begin() { return m_entries.begin(); }
+    iterator end() { return m_entries.end(); }
+    const_iterator begin() const { return m_entries.begin(); }
+    const_iterator end() const { return m_entries.end(); }
+    const_iterator cbegin() const { return m_entries.begin(); }
+    const_iterator cend() const { return m_entries.end(); }
+
+    size_type size() const { return m_entries.size(); }
+    bool empty() const { return m_entries.empty(); }
+    void clear() { m_entries.clear(); }
+
+    iterator lower_bound(const CAsset& asset)
+    {
+        return std::lower_bound(m_entries.begin(), m_entries.end(), asset,
+            [](const value_type& entry, const CAsset& key) { return entry.first < key; });
+    }
+    const_iterator lower_bound(const CAsset& asset) const
+    {
+        return std::lower_bound(m_entries.begin(), m_entries.end(), asset,
+            [](const value_type& entry, const CAsset& key) { return entry.first < key; });
+    }
+
+    iterator find(const CAsset& asset)
+    {
+        iterator it = lower_bound(asset);
+        return (it != end() && it->first == asset) ? it : end();
+    }
+    const_iterator find(const CAsset& asset) const
+    {
+        const_iterator it = lower_bound(asset);
+        return (it != end() && it->first == asset) ? it : end();
+    }
+
+    size_type count(const CAsset& asset) const { return find(asset) != end() ? 1 : 0; }
+
+    CAmount& operator[](const CAsset& asset)
+    {
+        iterator it = lower_bound(asset);
+        if (it == end() || it->first != asset)
+            it = m_entries.insert(it, value_type(asset, 0));
+        return it->second;
+    }
+
+    CAmount& at(const CAsset& asset)
+    {
+        iterator it = find(asset);
+        if (it == end())
+            throw std::out_of_range("CAmountMap::at");
+        return it->second;
+    }
+    const CAmount& at(const CAsset& asset) const
+    {
+        const_iterator it = find(asset);
+        if (it == end())
+            throw std::out_of_range("CAmountMap::at");
+        return it->second;
+    }
+
+    /** Insert an entry unless its asset is already present, like std::map::insert. */
+    std::pair<iterator, bool> insert(const value_type& entry)
+    {
+        iterator it = lower_bound(entry.first);
+        if (it != end() && it->first == entry.first)
+            return std::make_pair(it, false);
+        return std::make_pair(m_entries.insert(it, entry), true);
+    }
+
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        return insert(value_type(std::forward<Args>(args)...));
+    }
+
+    iterator erase(iterator pos) { return m_entries.erase(pos); }
+    iterator erase(const_iterator pos) { return m_entries.erase(begin() + (pos - cbegin())); }
+    size_type erase(const CAsset& asset)
+    {
+        iterator it = find(asset);
+        if (it == end())
+            return 0;
+        m_entries.erase(it);
+        return 1;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        WriteCompactSize(s, m_entries.size());
+        for (const value_type& entry : m_entries)
+            ::Serialize(s, entry);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        clear();
+        uint64_t nSize = ReadCompactSize(s);
+        for (uint64_t i = 0; i < nSize; i++) {
+            value_type entry;
+            ::Unserialize(s, entry);
+            insert(entry);
+        }
+    }
+};
 
 CAmountMap& operator+=(CAmountMap& a, const CAmountMap& b);
 CAmountMap& operator-=(CAmountMap& a, const CAmountMap& b);
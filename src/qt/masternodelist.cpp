@@ -309,14 +309,22 @@ void MasternodeList::updateNodeList()
     nTimeListUpdated = GetTime();
     fFilterUpdated = false;
 
+    // redraw only when the list or the filter changed since the last update
+    std::shared_ptr<const MasternodeListSnapshot> pSnapshot = mnodeman.GetListSnapshot();
+    if (pSnapshot->nVersion == nListVersionShown && strCurrentFilter == strFilterShown) {
+        ui->countLabel->setText(QString::number(ui->tableWidgetMasternodes->rowCount()));
+        return;
+    }
+    nListVersionShown = pSnapshot->nVersion;
+    strFilterShown = strCurrentFilter;
+
     QString strToFilter;
     ui->countLabel->setText("Updating...");
     ui->tableWidgetMasternodes->setSortingEnabled(false);
     ui->tableWidgetMasternodes->clearContents();
     ui->tableWidgetMasternodes->setRowCount(0);
-    std::vector<CMasternode> vMasternodes = mnodeman.GetFullMasternodeVector();
 
-    for (CMasternode& mn : vMasternodes)
+    for (const CMasternode& mn : pSnapshot->vMasternodes)
     {
         // populate list
         // Address, Protocol, Status, Active Seconds, Last Seen, Pub Key
@@ -48,6 +48,9 @@ private:
     QMenu* contextMenu;
     int64_t nTimeFilterUpdated{0};
     bool fFilterUpdated{false};
+    // list snapshot version and filter of the table currently shown
+    int64_t nListVersionShown{-1};
+    QString strFilterShown;
 
 public Q_SLOTS:
     void updateMyMasternodeInfo(QString alias, QString addr, QString privkey, QString txHash, QString txIndex, CMasternode *pmn);
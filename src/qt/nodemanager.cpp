@@ -404,6 +404,16 @@ void NodeManager::updateNodeList()
         return;
     }
 
+    // redraw only when one of the lists or the filter changed since the last update
+    std::shared_ptr<const MasternodeListSnapshot> pMasternodes = mnodeman.GetListSnapshot();
+    std::shared_ptr<const SystemnodeListSnapshot> pSystemnodes = snodeman.GetListSnapshot();
+    if (pMasternodes->nVersion == nMasternodeVersionShown && pSystemnodes->nVersion == nSystemnodeVersionShown && strCurrentFilter == strFilterShown) {
+        return;
+    }
+    nMasternodeVersionShown = pMasternodes->nVersion;
+    nSystemnodeVersionShown = pSystemnodes->nVersion;
+    strFilterShown = strCurrentFilter;
+
     QString strToFilter;
     ui->mncountLabel->setText("Updating...");
     ui->sncountLabel->setText("Updating...");
@@ -415,10 +425,7 @@ void NodeManager::updateNodeList()
     ui->tableWidgetSystemnodes->clearContents();
     ui->tableWidgetSystemnodes->setRowCount(0);
 
-    std::vector<CMasternode> vMasternodes = mnodeman.GetFullMasternodeVector();
-    std::vector<CSystemnode> vSystemnodes = snodeman.GetFullSystemnodeVector();
-
-    for (CMasternode& mn : vMasternodes)
+    for (const CMasternode& mn : pMasternodes->vMasternodes)
     {
         // populate list
         // Address, Protocol, Status, Active Seconds, Last Seen, Pub Key
@@ -450,7 +457,7 @@ void NodeManager::updateNodeList()
     }
 
 
-    for (CSystemnode& mn : vSystemnodes)
+    for (const CSystemnode& mn : pSystemnodes->vSystemnodes)
     {
         // populate list
         // Address, Protocol, Status, Active Seconds, Last Seen, Pub Key
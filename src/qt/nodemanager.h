@@ -104,6 +104,10 @@ private:
 
     int64_t nTimeFilterUpdated{0};
     bool fFilterUpdated{false};
+    // list snapshot versions and filter of the tables currently shown
+    int64_t nMasternodeVersionShown{-1};
+    int64_t nSystemnodeVersionShown{-1};
+    QString strFilterShown;
 };
 
 #endif // NODEMANAGER_H
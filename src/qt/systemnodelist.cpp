@@ -283,14 +283,22 @@ void SystemnodeList::updateNodeList()
     nTimeListUpdated = GetTime();
     fFilterUpdated = false;
 
+    // redraw only when the list or the filter changed since the last update
+    std::shared_ptr<const SystemnodeListSnapshot> pSnapshot = snodeman.GetListSnapshot();
+    if (pSnapshot->nVersion == nListVersionShown && strCurrentFilter == strFilterShown) {
+        ui->countLabel->setText(QString::number(ui->tableWidgetSystemnodes->rowCount()));
+        return;
+    }
+    nListVersionShown = pSnapshot->nVersion;
+    strFilterShown = strCurrentFilter;
+
     QString strToFilter;
     ui->countLabel->setText("Updating...");
     ui->tableWidgetSystemnodes->setSortingEnabled(false);
     ui->tableWidgetSystemnodes->clearContents();
     ui->tableWidgetSystemnodes->setRowCount(0);
-    std::vector<CSystemnode> vSystemnodes = snodeman.GetFullSystemnodeVector();
 
-    for (CSystemnode& mn : vSystemnodes)
+    for (const CSystemnode& mn : pSnapshot->vSystemnodes)
     {
         // populate list
         // Address, Protocol, Status, Active Seconds, Last Seen, Pub Key
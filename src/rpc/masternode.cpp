@@ -4,6 +4,7 @@
 
 #include <init.h>
 #include <key_io.h>
+#include <mn_processing.h>
 #include <net.h>
 #include <net_processing.h>
 #include <node/context.h>
@@ -19,6 +20,9 @@
 #include <masternode/masternode-sync.h>
 #include <masternode/masternodeconfig.h>
 #include <masternode/masternodeman.h>
+#include <crown/cache.h>
+#include <crown/instantx.h>
+#include <crown/legacysigcache.h>
 #include <crown/nodesync.h>
 
 #include <boost/lexical_cast.hpp>
@@ -669,11 +673,11 @@ UniValue getmasternodescores(const JSONRPCRequest& request)
     }
     UniValue obj(UniValue::VOBJ);
 
-    std::vector<CMasternode> vMasternodes = mnodeman.GetFullMasternodeVector();
+    std::shared_ptr<const MasternodeListSnapshot> pSnapshot = mnodeman.GetListSnapshot();
     for (int nHeight = ::ChainActive().Tip()->nHeight - nLast; nHeight < ::ChainActive().Tip()->nHeight + 20; nHeight++) {
         uint256 nHigh;
-        CMasternode* pBestMasternode = NULL;
-        for (CMasternode& mn : vMasternodes) {
+        const CMasternode* pBestMasternode = NULL;
+        for (const CMasternode& mn : pSnapshot->vMasternodes) {
             uint256 n = ArithToUint256(mn.CalculateScore(nHeight));
             if (UintToArith256(n) > UintToArith256(nHigh)) {
                 nHigh = n;
@@ -867,6 +871,156 @@ UniValue decodemasternodebroadcast(const JSONRPCRequest& request)
     return resultObj;
 }
 
+UniValue getcachesnapshotinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || (request.params.size() > 0))
+        throw std::runtime_error(
+            "getcachesnapshotinfo\n"
+            "\nGet timing of the periodic masternode, systemnode and budget cache snapshots\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"file\": {               (object) Cache file name\n"
+            "    \"lastsnapshot\": ttt,   (numeric) The time in seconds since epoch (Jan 1 1970 GMT) of the last snapshot\n"
+            "    \"lastcopyus\": n,       (numeric) Microseconds the manager was locked while copying the last snapshot\n"
+            "    \"lastwriteus\": n,      (numeric) Microseconds spent writing the last snapshot\n"
+            "    \"maxcopyus\": n,        (numeric) Longest copy since startup\n"
+            "    \"maxwriteus\": n,       (numeric) Longest write since startup\n"
+            "    \"count\": n,            (numeric) Snapshots taken since startup\n"
+            "    \"failures\": n          (numeric) Snapshots that could not be written\n"
+            "  }\n"
+            "  ,...\n"
+            "}\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("getcachesnapshotinfo", "") + HelpExampleRpc("getcachesnapshotinfo", ""));
+
+    UniValue ret(UniValue::VOBJ);
+    for (const auto& entry : GetCacheSnapshotStats()) {
+        const CCacheSnapshotStats& stats = entry.second;
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("lastsnapshot", stats.nLastTime);
+        obj.pushKV("lastcopyus", stats.nLastCopyMicros);
+        obj.pushKV("lastwriteus", stats.nLastWriteMicros);
+        obj.pushKV("maxcopyus", stats.nMaxCopyMicros);
+        obj.pushKV("maxwriteus", stats.nMaxWriteMicros);
+        obj.pushKV("count", stats.nCount);
+        obj.pushKV("failures", stats.nFailures);
+        ret.pushKV(entry.first, obj);
+    }
+
+    return ret;
+}
+
+UniValue getmasternodemessagestats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || (request.params.size() > 0))
+        throw std::runtime_error(
+            "getmasternodemessagestats\n"
+            "\nGet counters of the masternode, systemnode, budget, payment, instantsend, spork and sync messages received since startup\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"type\": {               (object) Message type\n"
+            "    \"count\": n,            (numeric) Messages received\n"
+            "    \"bytes\": n,            (numeric) Payload bytes received\n"
+            "    \"totalus\": n,          (numeric) Microseconds spent in the handler\n"
+            "    \"latency\": {           (object) Number of handler calls by duration\n"
+            "      \"<10us\": n, \"<100us\": n, \"<1ms\": n, \"<10ms\": n, \"<100ms\": n, \">=100ms\": n\n"
+            "    }\n"
+            "  }\n"
+            "  ,...\n"
+            "}\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("getmasternodemessagestats", "") + HelpExampleRpc("getmasternodemessagestats", ""));
+
+    static const char* const vBucketNames[MN_MESSAGE_LATENCY_BUCKETS] = {"<10us", "<100us", "<1ms", "<10ms", "<100ms", ">=100ms"};
+
+    UniValue ret(UniValue::VOBJ);
+    for (const auto& entry : GetMasternodeMessageStats()) {
+        const CMasternodeMessageStats& stats = entry.second;
+        UniValue latencyObj(UniValue::VOBJ);
+        for (int i = 0; i < MN_MESSAGE_LATENCY_BUCKETS; i++)
+            latencyObj.pushKV(vBucketNames[i], stats.vLatency[i]);
+
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("count", stats.nCount);
+        obj.pushKV("bytes", stats.nBytes);
+        obj.pushKV("totalus", stats.nTotalMicros);
+        obj.pushKV("latency", latencyObj);
+        ret.pushKV(entry.first, obj);
+    }
+
+    return ret;
+}
+
+UniValue getlegacysigcacheinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || (request.params.size() > 0))
+        throw std::runtime_error(
+            "getlegacysigcacheinfo\n"
+            "\nGet usage of the cache of masternode, systemnode, budget, spork and instantsend message signatures\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"hits\": n,               (numeric) Signatures found in the cache since startup\n"
+            "  \"misses\": n,             (numeric) Signatures that had to be recovered since startup\n"
+            "  \"maxelements\": n         (numeric) Number of signatures the cache can hold\n"
+            "}\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("getlegacysigcacheinfo", "") + HelpExampleRpc("getlegacysigcacheinfo", ""));
+
+    CLegacySigCacheStats stats = GetLegacySignatureCacheStats();
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("hits", stats.nHits);
+    ret.pushKV("misses", stats.nMisses);
+    ret.pushKV("maxelements", (uint64_t)stats.nMaxElements);
+
+    return ret;
+}
+
+UniValue getinstantsendinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || (request.params.size() > 0))
+        throw std::runtime_error(
+            "getinstantsendinfo\n"
+            "\nGet the number of instantsend locks and votes kept in memory and the cost of removing the expired ones\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"lockrequests\": n,       (numeric) Transaction lock requests\n"
+            "  \"locks\": n,              (numeric) Transaction locks\n"
+            "  \"lockedinputs\": n,       (numeric) Inputs locked by complete transaction locks\n"
+            "  \"votes\": n,              (numeric) Transaction lock votes\n"
+            "  \"cleanups\": n,           (numeric) Cleanups of expired locks and votes since startup\n"
+            "  \"expiredlocks\": n,       (numeric) Locks removed on expiry since startup\n"
+            "  \"expiredvotes\": n,       (numeric) Votes removed on expiry since startup\n"
+            "  \"lastcleanupus\": n,      (numeric) Duration of the last cleanup in microseconds\n"
+            "  \"maxcleanupus\": n        (numeric) Longest cleanup since startup in microseconds\n"
+            "}\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("getinstantsendinfo", "") + HelpExampleRpc("getinstantsendinfo", ""));
+
+    CInstantSendStats stats = instantSend.GetStats();
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("lockrequests", (uint64_t)stats.nLockRequests);
+    ret.pushKV("locks", (uint64_t)stats.nLocks);
+    ret.pushKV("lockedinputs", (uint64_t)stats.nLockedInputs);
+    ret.pushKV("votes", (uint64_t)stats.nVotes);
+    ret.pushKV("cleanups", stats.nCleanups);
+    ret.pushKV("expiredlocks", stats.nExpiredLocks);
+    ret.pushKV("expiredvotes", stats.nExpiredVotes);
+    ret.pushKV("lastcleanupus", stats.nLastCleanupMicros);
+    ret.pushKV("maxcleanupus", stats.nMaxCleanupMicros);
+
+    return ret;
+}
+
 void RegisterMasternodeCommands(CRPCTable& t)
 {
     static const CRPCCommand commands[] = {
@@ -884,6 +1038,10 @@ void RegisterMasternodeCommands(CRPCTable& t)
         { "masternode", "getmasternodestatus", &getmasternodestatus, {} },
         { "masternode", "getmasternodewinners", &getmasternodewinners, {} },
         { "masternode", "getmasternodescores", &getmasternodescores, {} },
+        { "masternode", "getcachesnapshotinfo", &getcachesnapshotinfo, {} },
+        { "masternode", "getmasternodemessagestats", &getmasternodemessagestats, {} },
+        { "masternode", "getlegacysigcacheinfo", &getlegacysigcacheinfo, {} },
+        { "masternode", "getinstantsendinfo", &getinstantsendinfo, {} },
     };
 
     for (unsigned int vcidx = 0; vcidx < ARRAYLEN(commands); vcidx++)
@@ -667,11 +667,11 @@ UniValue getsystemnodescores(const JSONRPCRequest& request)
     }
     UniValue obj(UniValue::VOBJ);
 
-    std::vector<CSystemnode> vSystemnodes = snodeman.GetFullSystemnodeVector();
+    std::shared_ptr<const SystemnodeListSnapshot> pSnapshot = snodeman.GetListSnapshot();
     for (int nHeight = ::ChainActive().Tip()->nHeight - nLast; nHeight < ::ChainActive().Tip()->nHeight + 20; nHeight++) {
         uint256 nHigh;
-        CSystemnode* pBestSystemnode = NULL;
-        for (CSystemnode& sn : vSystemnodes) {
+        const CSystemnode* pBestSystemnode = NULL;
+        for (const CSystemnode& sn : pSnapshot->vSystemnodes) {
             uint256 n = ArithToUint256(sn.CalculateScore(nHeight));
             if (UintToArith256(n) > UintToArith256(nHigh)) {
                 nHigh = n;
@@ -216,6 +216,7 @@ bool CActiveSystemnode::SendSystemnodePing(std::string& errorMessage, CConnman&
         }
 
         pmn->lastPing = mnp;
+        snodeman.NotifySystemnodePing();
         snodeman.mapSeenSystemnodePing.insert(std::make_pair(mnp.GetHash(), mnp));
 
         //snodeman.mapSeenSystemnodeBroadcast.lastPing is probably outdated, so we'll update it
@@ -385,6 +385,16 @@ void CSystemnodePayments::CheckAndRemove()
             LogPrint(BCLog::SYSTEMNODE, "CSystemnodePayments::CleanPaymentList - Removing old Systemnode payment - block %d\n", winner.nBlockHeight);
             systemnodeSync.mapSeenSyncSNW.erase((*it).first);
             mapSystemnodePayeeVotes.erase(it++);
+            if (mapSystemnodeBlocks.count(winner.nBlockHeight)) {
+                for (const auto& payee : mapSystemnodeBlocks[winner.nBlockHeight].vecPayments) {
+                    auto itVoted = mapPayeeVotedHeights.find(payee.scriptPubKey);
+                    if (itVoted == mapPayeeVotedHeights.end())
+                        continue;
+                    itVoted->second.erase(winner.nBlockHeight);
+                    if (itVoted->second.empty())
+                        mapPayeeVotedHeights.erase(itVoted);
+                }
+            }
             mapSystemnodeBlocks.erase(winner.nBlockHeight);
         } else {
             ++it;
@@ -397,7 +407,8 @@ bool CSystemnodePaymentWinner::IsValid(CNode* pnode, std::string& strError, CCon
     if (IsReferenceNode(vinSystemnode))
         return true;
 
-    CSystemnode* psn = snodeman.Find(vinSystemnode);
+    std::shared_ptr<const SystemnodeListSnapshot> pSnapshot = snodeman.GetListSnapshot();
+    const CSystemnode* psn = pSnapshot->Find(vinSystemnode.prevout);
 
     if (!psn) {
         strError = strprintf("Unknown Systemnode %s", vinSystemnode.prevout.ToStringShort());
@@ -521,11 +532,54 @@ bool CSystemnodePayments::AddWinningSystemnode(CSystemnodePaymentWinner& winnerI
     int n = 1;
     if (IsReferenceNode(winnerIn.vinSystemnode))
         n = 100;
-    mapSystemnodeBlocks[winnerIn.nBlockHeight].AddPayee(winnerIn.payee, n);
+    AddPayeeVotes(winnerIn.nBlockHeight, winnerIn.payee, n);
 
     return true;
 }
 
+void CSystemnodePayments::AddPayeeVotes(int nBlockHeight, const CScript& payee, int nVotes)
+{
+    LOCK(cs_mapSystemnodeBlocks);
+
+    if (!mapSystemnodeBlocks.count(nBlockHeight)) {
+        CSystemnodeBlockPayees blockPayees(nBlockHeight);
+        mapSystemnodeBlocks[nBlockHeight] = blockPayees;
+    }
+
+    mapSystemnodeBlocks[nBlockHeight].AddPayee(payee, nVotes);
+    if (mapSystemnodeBlocks[nBlockHeight].HasPayeeWithVotes(payee, 2))
+        mapPayeeVotedHeights[payee].insert(nBlockHeight);
+}
+
+// Most recent height not above nMaxHeight where payee had at least two votes, 0 if there is none
+int CSystemnodePayments::GetLastPaidHeight(const CScript& payee, int nMaxHeight)
+{
+    LOCK(cs_mapSystemnodeBlocks);
+
+    auto it = mapPayeeVotedHeights.find(payee);
+    if (it == mapPayeeVotedHeights.end())
+        return 0;
+
+    auto itHeight = it->second.upper_bound(nMaxHeight);
+    if (itHeight == it->second.begin())
+        return 0;
+
+    return *std::prev(itHeight);
+}
+
+void CSystemnodePayments::RebuildPayeeVotedHeights()
+{
+    LOCK(cs_mapSystemnodeBlocks);
+
+    mapPayeeVotedHeights.clear();
+    for (auto& blockPayees : mapSystemnodeBlocks) {
+        for (const auto& payee : blockPayees.second.vecPayments) {
+            if (payee.nVotes >= 2)
+                mapPayeeVotedHeights[payee.scriptPubKey].insert(blockPayees.first);
+        }
+    }
+}
+
 void CSystemnodePaymentWinner::Relay(CConnman& connman)
 {
     CInv inv(MSG_SYSTEMNODE_WINNER, GetHash());
@@ -535,10 +589,11 @@ void CSystemnodePaymentWinner::Relay(CConnman& connman)
 bool CSystemnodePaymentWinner::SignatureValid()
 {
 
-    CSystemnode* psn = snodeman.Find(vinSystemnode);
+    std::shared_ptr<const SystemnodeListSnapshot> pSnapshot = snodeman.GetListSnapshot();
+    const CSystemnode* psn = pSnapshot->Find(vinSystemnode.prevout);
 
     if (psn) {
-        std::string strMessage = vinSystemnode.prevout.ToStringShort() + boost::lexical_cast<std::string>(nBlockHeight) + payee.ToString();
+        std::string strMessage = GetSignatureMessage();
 
         std::string errorMessage = "";
         if (!legacySigner.VerifyMessage(psn->pubkey2, vchSig, strMessage, errorMessage)) {
@@ -615,6 +670,31 @@ bool CSystemnodePayments::IsScheduled(CSystemnode& sn, int nNotBlockHeight)
     return false;
 }
 
+void CSystemnodePayments::GetScheduledPayees(int nNotBlockHeight, std::set<CScript>& setPayees)
+{
+    LOCK(cs_mapSystemnodeBlocks);
+
+    setPayees.clear();
+
+    int nHeight;
+    {
+        TRY_LOCK(cs_main, locked);
+        if (!locked || ::ChainActive().Tip() == nullptr)
+            return;
+        nHeight = ::ChainActive().Tip()->nHeight;
+    }
+
+    CScript payee;
+    for (int64_t h = nHeight; h <= nHeight + 8; h++) {
+        if (h == nNotBlockHeight)
+            continue;
+        if (mapSystemnodeBlocks.count(h)) {
+            if (mapSystemnodeBlocks[h].GetPayee(payee))
+                setPayees.insert(payee);
+        }
+    }
+}
+
 std::string CSystemnodePayments::ToString() const
 {
     std::ostringstream info;
@@ -624,12 +704,17 @@ std::string CSystemnodePayments::ToString() const
     return info.str();
 }
 
+std::string CSystemnodePaymentWinner::GetSignatureMessage() const
+{
+    return vinSystemnode.prevout.ToStringShort() + boost::lexical_cast<std::string>(nBlockHeight) + payee.ToString();
+}
+
 bool CSystemnodePaymentWinner::Sign(CKey& keySystemnode, CPubKey& pubKeySystemnode)
 {
     std::string errorMessage;
     std::string strSystemNodeSignMessage;
 
-    std::string strMessage = vinSystemnode.prevout.ToStringShort() + boost::lexical_cast<std::string>(nBlockHeight) + payee.ToString();
+    std::string strMessage = GetSignatureMessage();
 
     if (!legacySigner.SignMessage(strMessage, vchSig, keySystemnode)) {
         LogPrint(BCLog::SYSTEMNODE, "CSystemnodePing::Sign() - Error: %s\n", errorMessage.c_str());
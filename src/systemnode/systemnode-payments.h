@@ -168,6 +168,8 @@ public:
         READWRITE(obj.vchSig);
     }
 
+    //! The message covered by the signature, see CLegacySigner::GetMessageHash
+    std::string GetSignatureMessage() const;
     bool Sign(CKey& keySystemnode, CPubKey& pubKeySystemnode);
     bool IsValid(CNode* pnode, std::string& strError, CConnman& connman);
     bool SignatureValid();
@@ -193,6 +195,8 @@ class CSystemnodePayments {
 private:
     int nSyncedFromPeer;
     int nLastBlockHeight;
+    // payee => heights at which the payee had at least two votes, lets GetLastPaid skip walking the chain
+    std::map<CScript, std::set<int>> mapPayeeVotedHeights;
 
 public:
     std::map<uint256, CSystemnodePaymentWinner> mapSystemnodePayeeVotes;
@@ -211,6 +215,13 @@ public:
         LOCK2(cs_mapSystemnodeBlocks, cs_mapSystemnodePayeeVotes);
         mapSystemnodeBlocks.clear();
         mapSystemnodePayeeVotes.clear();
+        mapPayeeVotedHeights.clear();
+    }
+
+    bool HasPayeeVote(const uint256& hash) const
+    {
+        LOCK(cs_mapSystemnodePayeeVotes);
+        return mapSystemnodePayeeVotes.count(hash);
     }
 
     bool ProcessBlock(int nBlockHeight, CConnman& connman);
@@ -221,6 +232,11 @@ public:
     bool IsTransactionValid(const CAmount& nValueCreated, const CTransaction& txNew, int nBlockHeight);
     bool GetBlockPayee(int nBlockHeight, CScript& payee);
     bool IsScheduled(CSystemnode& sn, int nNotBlockHeight);
+    void GetScheduledPayees(int nNotBlockHeight, std::set<CScript>& setPayees);
+
+    void AddPayeeVotes(int nBlockHeight, const CScript& payee, int nVotes);
+    int GetLastPaidHeight(const CScript& payee, int nMaxHeight);
+    void RebuildPayeeVotedHeights();
     bool CanVote(COutPoint outSystemnode, int nBlockHeight);
     std::string GetRequiredPaymentsString(int nBlockHeight);
     void FillBlockPayee(CMutableTransaction& txNew, int64_t nFees, bool &hasMNPayment);
@@ -230,6 +246,7 @@ public:
     {
         READWRITE(obj.mapSystemnodePayeeVotes);
         READWRITE(obj.mapSystemnodeBlocks);
+        SER_READ(obj, obj.RebuildPayeeVotedHeights());
     }
 };
 
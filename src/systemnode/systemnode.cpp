@@ -57,6 +57,9 @@ CSystemnode::CSystemnode(const CSystemnode& other)
     lastPing = other.lastPing;
     unitTest = other.unitTest;
     protocolVersion = other.protocolVersion;
+    fCollateralSpent = other.fCollateralSpent;
+    hashBroadcast = other.hashBroadcast;
+    nBroadcastHashSigTime = other.nBroadcastHashSigTime;
     lastTimeChecked = 0;
 }
 
@@ -134,6 +137,19 @@ CSystemnode::CollateralStatus CSystemnode::CheckCollateral(const COutPoint& outp
     return COLLATERAL_OK;
 }
 
+uint256 CSystemnode::GetBroadcastHash() const
+{
+    // same as CSystemnodeBroadcast::GetHash, without copying the entry into a broadcast
+    if (nBroadcastHashSigTime != sigTime) {
+        CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+        ss << sigTime;
+        ss << pubkey;
+        hashBroadcast = ss.GetHash();
+        nBroadcastHashSigTime = sigTime;
+    }
+    return hashBroadcast;
+}
+
 //
 // When a new systemnode broadcast is sent, update our information
 //
@@ -146,6 +162,7 @@ bool CSystemnode::UpdateFromNewBroadcast(CSystemnodeBroadcast& snb, CConnman& co
         protocolVersion = snb.protocolVersion;
         addr = snb.addr;
         lastTimeChecked = 0;
+        snodeman.NotifySystemnodeUpdates(true);
         int nDoS = 0;
         if (snb.lastPing == CSystemnodePing() || (snb.lastPing != CSystemnodePing() && snb.lastPing.CheckAndUpdate(nDoS, connman, false))) {
             lastPing = snb.lastPing;
@@ -165,9 +182,19 @@ void CSystemnode::Check(bool forceCheck)
         return;
     lastTimeChecked = GetTime();
 
-    //once spent, stop doing the checks
-    if (activeState == SYSTEMNODE_VIN_SPENT)
+    int nActiveStatePrev = activeState;
+    CheckState();
+    if (activeState != nActiveStatePrev)
+        snodeman.NotifySystemnodeUpdates();
+}
+
+void CSystemnode::CheckState()
+{
+    // the collateral is followed from block events by the manager, see CSystemnodeMan::UpdateCollaterals
+    if (fCollateralSpent && !unitTest) {
+        activeState = SYSTEMNODE_VIN_SPENT;
         return;
+    }
 
     if (!IsPingedWithin(SYSTEMNODE_REMOVAL_SECONDS)) {
         activeState = SYSTEMNODE_REMOVE;
@@ -179,18 +206,6 @@ void CSystemnode::Check(bool forceCheck)
         return;
     }
 
-    //test if the collateral is still good
-    if (!unitTest) {
-        TRY_LOCK(cs_main, lockMain);
-        if(!lockMain) return;
-        CollateralStatus err = CheckCollateral(vin.prevout);
-        if (err == COLLATERAL_UTXO_NOT_FOUND) {
-            activeState = SYSTEMNODE_VIN_SPENT;
-            LogPrint(BCLog::SYSTEMNODE, "CSystemnode::Check -- Failed to find Systemnode UTXO, systemnode=%s\n", vin.prevout.ToString());
-            return;
-        }
-    }
-
     activeState = SYSTEMNODE_ENABLED; // OK
 }
 
@@ -203,12 +218,12 @@ bool CSystemnode::IsValidNetAddr()
     return (addr.IsIPv4() && addr.IsRoutable());
 }
 
-int64_t CSystemnode::SecondsSincePayment() const
+int64_t CSystemnode::SecondsSincePayment(int nEnabledCount) const
 {
     CScript pubkeyScript;
     pubkeyScript = GetScriptForDestination(PKHash(pubkey));
 
-    int64_t sec = (GetAdjustedTime() - GetLastPaid());
+    int64_t sec = (GetAdjustedTime() - GetLastPaid(nEnabledCount));
     int64_t month = 60 * 60 * 24 * 30;
     if (sec < month)
         return sec; //if it's less than 30 days, give seconds
@@ -222,11 +237,11 @@ int64_t CSystemnode::SecondsSincePayment() const
     return month + UintToArith256(hash).GetCompact(false);
 }
 
-int64_t CSystemnode::GetLastPaid() const
+int64_t CSystemnode::GetLastPaid(int nEnabledCount) const
 {
-    CBlockIndex* pindexPrev = ::ChainActive().Tip();
-    if (pindexPrev == nullptr)
-        return false;
+    const CBlockIndex* pindexTip = ::ChainActive().Tip();
+    if (pindexTip == nullptr)
+        return 0;
 
     CScript snpayee;
     snpayee = GetScriptForDestination(PKHash(pubkey));
@@ -237,75 +252,69 @@ int64_t CSystemnode::GetLastPaid() const
     uint256 hash = ss.GetHash();
 
     // use a deterministic offset to break a tie -- 2.5 minutes
-    int64_t nOffset = UintToArith256(hash).GetCompact(false) % 150; 
+    int64_t nOffset = UintToArith256(hash).GetCompact(false) % 150;
 
-    if (::ChainActive().Tip() == NULL) return false;
+    if (nEnabledCount < 0)
+        nEnabledCount = snodeman.CountEnabled();
+    int nMnCount = nEnabledCount * 1.25;
 
-    const CBlockIndex *BlockReading = ::ChainActive().Tip();
+    /*
+        Search for this payee, with at least 2 votes, within the last nMnCount blocks. This will aid in consensus
+        allowing the network to converge on the same payees quickly, then keep the same schedule.
+    */
+    int nPaidHeight = systemnodePayments.GetLastPaidHeight(snpayee, pindexTip->nHeight);
+    if (nPaidHeight <= 0 || pindexTip->nHeight - nPaidHeight >= nMnCount)
+        return 0;
 
-    int nMnCount = snodeman.CountEnabled()*1.25;
-    int n = 0;
-    for (unsigned int i = 1; BlockReading && BlockReading->nHeight > 0; i++) {
-        if (n >= nMnCount) {
-            return 0;
-        }
-        n++;
-
-        if(systemnodePayments.mapSystemnodeBlocks.count(BlockReading->nHeight)){
-            /*
-                Search for this payee, with at least 2 votes. This will aid in consensus allowing the network 
-                to converge on the same payees quickly, then keep the same schedule.
-            */
-            if(systemnodePayments.mapSystemnodeBlocks[BlockReading->nHeight].HasPayeeWithVotes(snpayee, 2)){
-                return BlockReading->nTime + nOffset;
-            }
-        }
+    return ::ChainActive()[nPaidHeight]->nTime + nOffset;
+}
 
-        if (BlockReading->pprev == nullptr) {
-            assert(BlockReading);
-            break;
-        }
-        BlockReading = BlockReading->pprev;
+// First height of the stake pointer window for a chain ending at nTipHeight
+int CSystemnode::GetPaymentWindowStart(int nTipHeight)
+{
+    return std::max(1, nTipHeight - Params().ValidStakePointerDuration());
+}
+
+// Find all payments the SN received within defined block depth
+// Used for generating stakepointers
+bool CSystemnode::GetRecentPayments(std::vector<NodePayment>& vPayments, bool limitMostRecent) const
+{
+    int nMinimumValidBlockHeight = GetPaymentWindowStart(::ChainActive().Height());
+
+    CScript snpayee;
+    snpayee = GetScriptForDestination(PKHash(pubkey));
+
+    std::vector<NodePayment> vIndexed;
+    g_paymentIndex.GetPayments(snpayee, SN_PMT_SLOT, nMinimumValidBlockHeight, ::ChainActive().Height() - 1, vIndexed);
+
+    // the index follows ConnectBlock/DisconnectBlock, make sure every entry is still on the active chain
+    vPayments.clear();
+    for (const auto& payment : vIndexed) {
+        const CBlockIndex* pindex = ::ChainActive()[payment.nHeight];
+        if (pindex && pindex->GetBlockHash() == payment.hashBlock)
+            vPayments.emplace_back(payment);
     }
 
-    return 0;
+    // as the block scan this replaced, limitMostRecent keeps the first payment of the window
+    if (limitMostRecent && vPayments.size() > 1)
+        vPayments.resize(1);
+
+    return !vPayments.empty();
 }
 
 // Find all blocks where SN received reward within defined block depth
-// Used for generating stakepointers
 bool CSystemnode::GetRecentPaymentBlocks(std::vector<const CBlockIndex*>& vPaymentBlocks, bool limitMostRecent) const
 {
     vPaymentBlocks.clear();
-    int nMinimumValidBlockHeight = ::ChainActive().Height() - Params().ValidStakePointerDuration();
-    if (nMinimumValidBlockHeight < 1)
-        nMinimumValidBlockHeight = 1;
 
-    CBlockIndex* pindex = ::ChainActive()[nMinimumValidBlockHeight];
+    std::vector<NodePayment> vPayments;
+    if (!GetRecentPayments(vPayments, limitMostRecent))
+        return false;
 
-    CScript snpayee;
-    snpayee = GetScriptForDestination(PKHash(pubkey));
+    for (const auto& payment : vPayments)
+        vPaymentBlocks.emplace_back(::ChainActive()[payment.nHeight]);
 
-    bool fBlockFound = false;
-    while (::ChainActive().Next(pindex)) {
-        CBlock block;
-        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus()))
-            continue;
-
-        int m = (block.vtx[0]->nVersion >= TX_ELE_VERSION ? block.vtx[0]->vpout.size() : block.vtx[0]->vout.size());
-
-        if (m > 2) {
-            CTxOutAsset out = (block.vtx[0]->nVersion >= TX_ELE_VERSION ? block.vtx[0]->vpout[2] : block.vtx[0]->vout[2]);
-            if (out.scriptPubKey == snpayee){
-                vPaymentBlocks.emplace_back(pindex);
-                fBlockFound = true;
-                if (limitMostRecent)
-                    return fBlockFound;
-            }
-        }
-        pindex = ::ChainActive().Next(pindex);
-    }
-
-    return fBlockFound;
+    return true;
 }
 
 //
@@ -649,16 +658,21 @@ bool CSystemnodeBroadcast::Create(CTxIn txin, CService service, CKey keyCollater
 
     return true;
 }
-bool CSystemnodeBroadcast::Sign(const CKey& keyCollateralAddress)
+std::string CSystemnodeBroadcast::GetSignatureMessage() const
 {
-    std::string errorMessage;
-
     std::string vchPubKey(pubkey.begin(), pubkey.end());
     std::string vchPubKey2(pubkey2.begin(), pubkey2.end());
 
+    return addr.ToString() + boost::lexical_cast<std::string>(sigTime) + vchPubKey + vchPubKey2 + boost::lexical_cast<std::string>(protocolVersion);
+}
+
+bool CSystemnodeBroadcast::Sign(const CKey& keyCollateralAddress)
+{
+    std::string errorMessage;
+
     sigTime = GetAdjustedTime();
 
-    std::string strMessage = addr.ToString() + boost::lexical_cast<std::string>(sigTime) + vchPubKey + vchPubKey2 + boost::lexical_cast<std::string>(protocolVersion);
+    std::string strMessage = GetSignatureMessage();
 
     if (!legacySigner.SignMessage(strMessage, sig, keyCollateralAddress)) {
         LogPrint(BCLog::SYSTEMNODE, "CSystemnodeBroadcast::Sign() - Error: %s\n", errorMessage);
@@ -672,10 +686,7 @@ bool CSystemnodeBroadcast::VerifySignature() const
 {
     std::string errorMessage;
 
-    std::string vchPubKey(pubkey.begin(), pubkey.end());
-    std::string vchPubKey2(pubkey2.begin(), pubkey2.end());
-
-    std::string strMessage = addr.ToString() + boost::lexical_cast<std::string>(sigTime) + vchPubKey + vchPubKey2 + boost::lexical_cast<std::string>(protocolVersion);
+    std::string strMessage = GetSignatureMessage();
 
     if(!legacySigner.VerifyMessage(pubkey, sig, strMessage, errorMessage)) {
         LogPrint(BCLog::SYSTEMNODE, "CSystemnodeBroadcast::VerifySignature() - Error: %s\n", errorMessage);
@@ -701,12 +712,17 @@ CSystemnodePing::CSystemnodePing(const CTxIn& newVin)
     vchSig = std::vector<unsigned char>();
 }
 
+std::string CSystemnodePing::GetSignatureMessage() const
+{
+    return vin.ToString() + blockHash.ToString() + boost::lexical_cast<std::string>(sigTime);
+}
+
 bool CSystemnodePing::Sign(const CKey& keySystemnode, const CPubKey& pubKeySystemnode)
 {
     std::string errorMessage;
     std::string strThroNeSignMessage;
     sigTime = GetAdjustedTime();
-    std::string strMessage = vin.ToString() + blockHash.ToString() + boost::lexical_cast<std::string>(sigTime);
+    std::string strMessage = GetSignatureMessage();
 
     if (!legacySigner.SignMessage(strMessage, vchSig, keySystemnode)) {
         LogPrint(BCLog::SYSTEMNODE, "CSystemnodePing::Sign() - Error: %s\n", errorMessage);
@@ -723,7 +739,7 @@ bool CSystemnodePing::Sign(const CKey& keySystemnode, const CPubKey& pubKeySyste
 
 bool CSystemnodePing::VerifySignature(const CPubKey& pubKeySystemnode, int &nDos) const
 {
-    std::string strMessage = vin.ToString() + blockHash.ToString() + boost::lexical_cast<std::string>(sigTime);
+    std::string strMessage = GetSignatureMessage();
     std::string errorMessage = "";
 
     if(!legacySigner.VerifyMessage(pubKeySystemnode, vchSig, strMessage, errorMessage))
@@ -792,6 +808,7 @@ bool CSystemnodePing::CheckAndUpdate(int& nDos, CConnman& connman, bool fRequire
             }
 
             psn->lastPing = *this;
+            snodeman.NotifySystemnodePing();
 
             //snodeman.mapSeenSystemnodeBroadcast.lastPing is probably outdated, so we'll update it
             CSystemnodeBroadcast snb(*psn);
@@ -9,6 +9,7 @@
 #include <base58.h>
 #include <key.h>
 #include <net.h>
+#include <pos/paymentindex.h>
 #include <sync.h>
 #include <timedata.h>
 #include <util/system.h>
@@ -26,7 +27,6 @@
 class CSystemnode;
 class CSystemnodeBroadcast;
 class CSystemnodePing;
-extern std::map<int64_t, uint256> mapCacheBlockHashes;
 
 //
 // The Systemnode Ping Class : Contains a different serialize method for sending pings from systemnodes throughout the network
@@ -51,6 +51,8 @@ public:
     }
 
     bool CheckAndUpdate(int& nDos, CConnman& connman, bool fRequireEnabled = true, bool fCheckSigTimeOnly = false);
+    //! The message covered by the signature, see CLegacySigner::GetMessageHash
+    std::string GetSignatureMessage() const;
     bool Sign(const CKey& keySystemnode, const CPubKey& pubKeySystemnode);
     bool VerifySignature(const CPubKey& pubKeySystemnode, int& nDos) const;
     void Relay(CConnman& connman);
@@ -100,6 +102,11 @@ private:
     // critical section to protect the inner data structures
     mutable RecursiveMutex cs;
     int64_t lastTimeChecked;
+    // hash of the broadcast of this entry and the sigTime it was computed for
+    mutable uint256 hashBroadcast;
+    mutable int64_t nBroadcastHashSigTime{-1};
+
+    void CheckState();
 
 public:
     enum state {
@@ -129,6 +136,8 @@ public:
     int protocolVersion;
     CSystemnodePing lastPing;
     std::vector<unsigned char> vchSignover;
+    // set by the manager from connected and disconnected blocks, not serialized
+    bool fCollateralSpent{false};
 
     CSystemnode();
     CSystemnode(const CSystemnode& other);
@@ -152,6 +161,9 @@ public:
         swap(first.unitTest, second.unitTest);
         swap(first.protocolVersion, second.protocolVersion);
         swap(first.vchSignover, second.vchSignover);
+        swap(first.fCollateralSpent, second.fCollateralSpent);
+        swap(first.hashBroadcast, second.hashBroadcast);
+        swap(first.nBroadcastHashSigTime, second.nBroadcastHashSigTime);
     }
 
     CSystemnode& operator=(CSystemnode from)
@@ -190,13 +202,16 @@ public:
     static CollateralStatus CheckCollateral(const COutPoint& outpoint);
     static CollateralStatus CheckCollateral(const COutPoint& outpoint, int& nHeightRet);
 
-    int64_t SecondsSincePayment() const;
+    int64_t SecondsSincePayment(int nEnabledCount = -1) const;
     bool UpdateFromNewBroadcast(CSystemnodeBroadcast& snb, CConnman& connman);
     void Check(bool forceCheck = false);
     bool IsBroadcastedWithin(int seconds) const
     {
         return (GetAdjustedTime() - sigTime) < seconds;
     }
+    /// Hash of CSystemnodeBroadcast(*this), recomputed only after sigTime changed
+    uint256 GetBroadcastHash() const;
+
     bool IsEnabled() const
     {
         return activeState == SYSTEMNODE_ENABLED;
@@ -240,8 +255,11 @@ public:
 
         return strStatus;
     }
-    int64_t GetLastPaid() const;
+    int64_t GetLastPaid(int nEnabledCount = -1) const;
 
+    //! Lowest height at which a payment can still be used as a stake pointer
+    static int GetPaymentWindowStart(int nTipHeight);
+    bool GetRecentPayments(std::vector<NodePayment>& vPayments, bool limitMostRecent = false) const;
     bool GetRecentPaymentBlocks(std::vector<const CBlockIndex*>& vPaymentBlocks, bool limitMostRecent = false) const;
 };
 
@@ -261,6 +279,8 @@ public:
 
     bool CheckAndUpdate(int& nDoS, CConnman& connman);
     bool CheckInputsAndAdd(int& nDos, CConnman& connman);
+    //! The message covered by the signature, see CLegacySigner::GetMessageHash
+    std::string GetSignatureMessage() const;
     bool Sign(const CKey& keyCollateralAddress);
     bool VerifySignature() const;
     void Relay(CConnman& connman) const;
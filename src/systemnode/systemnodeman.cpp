@@ -21,30 +21,32 @@ CSystemnodeMan snodeman;
 
 struct CompareLastPaid
 {
-    bool operator()(const std::pair<int64_t, CTxIn>& t1,
-                    const std::pair<int64_t, CTxIn>& t2) const
+    bool operator()(const std::pair<int64_t, CSystemnode*>& t1,
+                    const std::pair<int64_t, CSystemnode*>& t2) const
     {
         return t1.first < t2.first;
     }
 };
 
-struct CompareScoreTxIn
+struct CompareScoreOutPoint
 {
-    bool operator()(const std::pair<int64_t, CTxIn>& t1,
-                    const std::pair<int64_t, CTxIn>& t2) const
+    bool operator()(const std::pair<int64_t, COutPoint>& t1,
+                    const std::pair<int64_t, COutPoint>& t2) const
     {
         return t1.first < t2.first;
     }
 };
 
-struct CompareScoreSN
+// byte keys for the lookup indexes
+static std::vector<unsigned char> IndexKey(const CPubKey& pubkey)
 {
-    bool operator()(const std::pair<int64_t, CSystemnode>& t1,
-                    const std::pair<int64_t, CSystemnode>& t2) const
-    {
-        return t1.first < t2.first;
-    }
-};
+    return std::vector<unsigned char>(pubkey.begin(), pubkey.end());
+}
+
+static std::vector<unsigned char> IndexKey(const CService& addr)
+{
+    return addr.GetKey();
+}
 
 int CSystemnodeMan::CountSystemnodes(bool fEnabled)
 {
@@ -62,37 +64,100 @@ int CSystemnodeMan::CountSystemnodes(bool fEnabled)
     return nCount;
 }
 
-std::vector<std::pair<int, CSystemnode> > CSystemnodeMan::GetSystemnodeRanks(int64_t nBlockHeight, int minProtocol)
+const CSystemnodeMan::CSystemnodeScores* CSystemnodeMan::GetScores(int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
 {
-    std::vector<std::pair<int64_t, CSystemnode>> vecSystemnodeScores;
-    std::vector<std::pair<int, CSystemnode>> vecSystemnodeRanks;
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs);
 
     //make sure we know about this block
     uint256 hash = uint256();
     if (!GetBlockHash(hash, nBlockHeight))
-        return vecSystemnodeRanks;
+        return nullptr;
 
-    // scan for winner
-    for (auto& sn : vSystemnodes) {
-        sn.Check();
+    // scores depend on the tip through the collateral age, so the cache only lives for one tip and list version
+    const CBlockIndex* pindexTip = ::ChainActive().Tip();
+    uint256 hashTip = pindexTip ? pindexTip->GetBlockHash() : uint256();
+    if (hashTip != hashRankCacheTip || nListVersion != nRankCacheVersion) {
+        mapRankCache.clear();
+        hashRankCacheTip = hashTip;
+        nRankCacheVersion = nListVersion;
+    }
+
+    const auto key = std::make_tuple(nBlockHeight, minProtocol, fOnlyActive);
+    auto it = mapRankCache.find(key);
+    if (it != mapRankCache.end())
+        return &it->second;
+
+    if (fOnlyActive) {
+        for (auto& sn : vSystemnodes)
+            sn.Check();
+        // state changes found by the checks above invalidate what is cached
+        if (nListVersion != nRankCacheVersion) {
+            mapRankCache.clear();
+            nRankCacheVersion = nListVersion;
+        }
+    }
+
+    if (mapRankCache.size() >= SYSTEMNODE_RANK_CACHE_SIZE)
+        mapRankCache.clear();
+
+    CSystemnodeScores& scores = mapRankCache[key];
+    scores.vecScores.reserve(vSystemnodes.size());
+    for (const auto& sn : vSystemnodes) {
         if (sn.protocolVersion < minProtocol)
             continue;
-        if (!sn.IsEnabled())
+        if (fOnlyActive && !sn.IsEnabled())
             continue;
         int64_t n2 = sn.CalculateScore(nBlockHeight).GetCompact(false);
-        vecSystemnodeScores.push_back(std::make_pair(n2, sn));
+        scores.vecScores.emplace_back(n2, sn.vin.prevout);
     }
-    sort(vecSystemnodeScores.rbegin(), vecSystemnodeScores.rend(), CompareScoreSN());
 
+    std::sort(scores.vecScores.rbegin(), scores.vecScores.rend(), CompareScoreOutPoint());
+
+    scores.mapRanks.reserve(scores.vecScores.size());
     int rank = 0;
-    for (const auto& s : vecSystemnodeScores) {
-        rank++;
-        vecSystemnodeRanks.push_back(std::make_pair(rank, s.second));
+    for (const auto& s : scores.vecScores) {
+        scores.mapRanks.emplace(s.second, ++rank);
+    }
+
+    return &scores;
+}
+
+std::vector<std::pair<int, CSystemnode> > CSystemnodeMan::GetSystemnodeRanks(int64_t nBlockHeight, int minProtocol)
+{
+    std::vector<std::pair<int, CSystemnode>> vecSystemnodeRanks;
+
+    LOCK2(cs_main, cs);
+
+    const CSystemnodeScores* pscores = GetScores(nBlockHeight, minProtocol, true);
+    if (!pscores)
+        return vecSystemnodeRanks;
+
+    vecSystemnodeRanks.resize(pscores->vecScores.size());
+    for (const auto& sn : vSystemnodes) {
+        auto it = pscores->mapRanks.find(sn.vin.prevout);
+        if (it != pscores->mapRanks.end())
+            vecSystemnodeRanks[it->second - 1] = std::make_pair(it->second, sn);
     }
 
     return vecSystemnodeRanks;
 }
 
+int CSystemnodeMan::GetSystemnodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
+{
+    LOCK2(cs_main, cs);
+
+    const CSystemnodeScores* pscores = GetScores(nBlockHeight, minProtocol, fOnlyActive);
+    if (!pscores)
+        return -1;
+
+    auto it = pscores->mapRanks.find(vin.prevout);
+    if (it == pscores->mapRanks.end())
+        return -1;
+
+    return it->second;
+}
+
 void CSystemnodeMan::ProcessSystemnodeConnections(CConnman& connman)
 {
     for (const auto& pnode : connman.CopyNodeVector()) {
@@ -125,7 +190,7 @@ void CSystemnodeMan::AskForSN(CNode* pnode, CTxIn& vin, CConnman& connman)
 
 void CSystemnodeMan::Check()
 {
-    LOCK(cs);
+    LOCK2(cs_main, cs);
 
     for (auto& sn : vSystemnodes) {
         sn.Check();
@@ -207,37 +272,55 @@ void CSystemnodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
             }
         } //else, asking for a specific node which is ok
 
-        int nInvCount = 0;
-        for (const auto& sn : vSystemnodes) {
-            if (sn.IsEnabled()) {
-                LogPrint(BCLog::SYSTEMNODE, "sndseg - Sending Systemnode entry - %s \n", sn.addr.ToString());
-                if (vin == CTxIn() || vin == sn.vin) {
-                    CSystemnodeBroadcast snb = CSystemnodeBroadcast(sn);
-                    uint256 hash = snb.GetHash();
-                    pfrom->PushInventory(CInv(MSG_SYSTEMNODE_ANNOUNCE, hash));
-                    nInvCount++;
-                    if (!mapSeenSystemnodeBroadcast.count(hash))
-                        mapSeenSystemnodeBroadcast.insert(std::make_pair(hash, snb));
-                    if (vin == sn.vin) {
-                        LogPrint(BCLog::SYSTEMNODE, "sndseg - Sent 1 Systemnode entries to %s\n", pfrom->addr.ToString());
-                        return;
-                    }
-                }
+        LOCK(cs);
+        if (vin == CTxIn()) {
+            UpdateDsegInventory();
+            for (const auto& inv : vecDsegInventory) {
+                pfrom->PushInventory(CInv(MSG_SYSTEMNODE_ANNOUNCE, inv.first));
+                if (!mapSeenSystemnodeBroadcast.count(inv.first))
+                    mapSeenSystemnodeBroadcast.insert(std::make_pair(inv.first, CSystemnodeBroadcast(vSystemnodes[inv.second])));
             }
-        }
 
-        if (vin == CTxIn()) {
+            int nInvCount = vecDsegInventory.size();
             const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
             connman->PushMessage(pfrom, msgMaker.Make("snssc", SYSTEMNODE_SYNC_LIST, nInvCount));
             LogPrint(BCLog::SYSTEMNODE, "sndseg - Sent %d Systemnode entries to %s\n", nInvCount, pfrom->addr.ToString());
+        } else {
+            CSystemnode* psn = Find(vin);
+            if (psn && psn->IsEnabled()) {
+                uint256 hash = psn->GetBroadcastHash();
+                pfrom->PushInventory(CInv(MSG_SYSTEMNODE_ANNOUNCE, hash));
+                if (!mapSeenSystemnodeBroadcast.count(hash))
+                    mapSeenSystemnodeBroadcast.insert(std::make_pair(hash, CSystemnodeBroadcast(*psn)));
+                LogPrint(BCLog::SYSTEMNODE, "sndseg - Sent 1 Systemnode entries to %s\n", pfrom->addr.ToString());
+            }
         }
     }
 }
 
+void CSystemnodeMan::UpdateDsegInventory()
+{
+    AssertLockHeld(cs);
+
+    int64_t nVersion = nListVersion;
+    if (nDsegInventoryVersion == nVersion)
+        return;
+
+    vecDsegInventory.clear();
+    for (size_t i = 0; i < vSystemnodes.size(); i++) {
+        if (vSystemnodes[i].IsEnabled())
+            vecDsegInventory.emplace_back(vSystemnodes[i].GetBroadcastHash(), i);
+    }
+    nDsegInventoryVersion = nVersion;
+}
+
 void CSystemnodeMan::CheckAndRemove(bool forceExpiredRemoval)
 {
     Check();
 
+    if (fPingsUnpublished.exchange(false))
+        ++nPingVersion;
+
     LOCK(cs);
 
     //remove inactive and outdated
@@ -271,6 +354,7 @@ void CSystemnodeMan::CheckAndRemove(bool forceExpiredRemoval)
             }
 
             it = vSystemnodes.erase(it);
+            NotifySystemnodeUpdates(true);
         } else {
             ++it;
         }
@@ -333,6 +417,7 @@ void CSystemnodeMan::Clear()
 {
     LOCK(cs);
     vSystemnodes.clear();
+    NotifySystemnodeUpdates(true);
     mAskedUsForSystemnodeList.clear();
     mWeAskedForSystemnodeList.clear();
     mWeAskedForSystemnodeListEntry.clear();
@@ -340,6 +425,70 @@ void CSystemnodeMan::Clear()
     mapSeenSystemnodePing.clear();
 }
 
+void CSystemnodeMan::GetSnapshot(CSystemnodeMan& snapshot) const
+{
+    LOCK2(cs, snapshot.cs);
+    snapshot.vSystemnodes = vSystemnodes;
+    snapshot.mAskedUsForSystemnodeList = mAskedUsForSystemnodeList;
+    snapshot.mWeAskedForSystemnodeList = mWeAskedForSystemnodeList;
+    snapshot.mWeAskedForSystemnodeListEntry = mWeAskedForSystemnodeListEntry;
+    snapshot.mapSeenSystemnodeBroadcast = mapSeenSystemnodeBroadcast;
+    snapshot.mapSeenSystemnodePing = mapSeenSystemnodePing;
+}
+
+void CSystemnodeMan::CheckCollaterals()
+{
+    LOCK2(cs_main, cs);
+    for (auto& sn : vSystemnodes) {
+        sn.fCollateralSpent = CSystemnode::CheckCollateral(sn.vin.prevout) == CSystemnode::COLLATERAL_UTXO_NOT_FOUND;
+        if (sn.fCollateralSpent)
+            LogPrint(BCLog::SYSTEMNODE, "CSystemnodeMan::CheckCollaterals -- Failed to find Systemnode UTXO, systemnode=%s\n", sn.vin.prevout.ToString());
+    }
+}
+
+void CSystemnodeMan::UpdateCollaterals(const std::vector<COutPoint>& vRestored, const std::vector<COutPoint>& vSpent)
+{
+    LOCK(cs);
+    if (fIndexesDirty)
+        RebuildIndexes();
+
+    auto update = [this](const COutPoint& outpoint, bool fSpent) {
+        auto it = mapIndexByOutpoint.find(outpoint);
+        if (it == mapIndexByOutpoint.end())
+            return;
+        CSystemnode& sn = vSystemnodes[it->second];
+        if (sn.fCollateralSpent == fSpent)
+            return;
+        sn.fCollateralSpent = fSpent;
+        LogPrint(BCLog::SYSTEMNODE, "CSystemnodeMan::UpdateCollaterals -- Systemnode UTXO %s, systemnode=%s\n", fSpent ? "spent" : "restored", outpoint.ToString());
+        sn.Check(true);
+    };
+
+    // an output created and spent within the same block ends up spent
+    for (const COutPoint& outpoint : vRestored)
+        update(outpoint, false);
+    for (const COutPoint& outpoint : vSpent)
+        update(outpoint, true);
+}
+
+std::shared_ptr<const SystemnodeListSnapshot> CSystemnodeMan::GetListSnapshot()
+{
+    if (nListSnapshotVersion != GetListVersion()) {
+        LOCK(cs);
+        int64_t nVersion = GetListVersion();
+        if (nListSnapshotVersion != nVersion) {
+            auto pSnapshot = std::make_shared<SystemnodeListSnapshot>();
+            pSnapshot->nVersion = nVersion;
+            pSnapshot->vSystemnodes = vSystemnodes;
+            for (size_t i = 0; i < pSnapshot->vSystemnodes.size(); i++)
+                pSnapshot->mapIndexByOutpoint.emplace(pSnapshot->vSystemnodes[i].vin.prevout, i);
+            std::atomic_store(&pListSnapshot, std::shared_ptr<const SystemnodeListSnapshot>(std::move(pSnapshot)));
+            nListSnapshotVersion = nVersion;
+        }
+    }
+    return std::atomic_load(&pListSnapshot);
+}
+
 int CSystemnodeMan::CountEnabled(int protocolVersion)
 {
     int i = 0;
@@ -378,34 +527,54 @@ void CSystemnodeMan::DsegUpdate(CNode* pnode, CConnman& connman)
 CSystemnode* CSystemnodeMan::Find(const CTxIn& vin)
 {
     LOCK(cs);
+    if (fIndexesDirty)
+        RebuildIndexes();
 
-    for (auto& sn : vSystemnodes) {
-        if (sn.vin.prevout == vin.prevout)
-            return &sn;
-    }
-    return nullptr;
+    auto it = mapIndexByOutpoint.find(vin.prevout);
+    return it != mapIndexByOutpoint.end() ? &vSystemnodes[it->second] : nullptr;
 }
 
 CSystemnode* CSystemnodeMan::Find(const CPubKey& pubKeySystemnode)
 {
     LOCK(cs);
+    if (fIndexesDirty)
+        RebuildIndexes();
 
-    for (auto& sn : vSystemnodes) {
-        if (sn.pubkey2 == pubKeySystemnode)
-            return &sn;
-    }
-    return nullptr;
+    auto it = mapIndexByPubKey.find(IndexKey(pubKeySystemnode));
+    return it != mapIndexByPubKey.end() ? &vSystemnodes[it->second] : nullptr;
 }
 
 CSystemnode* CSystemnodeMan::Find(const CService& addr)
 {
     LOCK(cs);
+    if (fIndexesDirty)
+        RebuildIndexes();
 
-    for (auto& sn : vSystemnodes) {
-        if (sn.addr == addr)
-            return &sn;
+    auto it = mapIndexByService.find(IndexKey(addr));
+    return it != mapIndexByService.end() ? &vSystemnodes[it->second] : nullptr;
+}
+
+void CSystemnodeMan::IndexSystemnode(size_t nPos)
+{
+    AssertLockHeld(cs);
+
+    const CSystemnode& sn = vSystemnodes[nPos];
+    mapIndexByOutpoint.emplace(sn.vin.prevout, nPos);
+    mapIndexByPubKey.emplace(IndexKey(sn.pubkey2), nPos);
+    mapIndexByService.emplace(IndexKey(sn.addr), nPos);
+}
+
+void CSystemnodeMan::RebuildIndexes()
+{
+    AssertLockHeld(cs);
+
+    fIndexesDirty = false;
+    mapIndexByOutpoint.clear();
+    mapIndexByPubKey.clear();
+    mapIndexByService.clear();
+    for (size_t i = 0; i < vSystemnodes.size(); i++) {
+        IndexSystemnode(i);
     }
-    return nullptr;
 }
 
 //
@@ -413,23 +582,28 @@ CSystemnode* CSystemnodeMan::Find(const CService& addr)
 //
 CSystemnode* CSystemnodeMan::GetNextSystemnodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCount)
 {
-    LOCK(cs);
+    LOCK2(cs_main, cs);
 
     CSystemnode* pBestSystemnode = nullptr;
-    std::vector<std::pair<int64_t, CTxIn>> vecSystemnodeLastPaid;
+    std::vector<std::pair<int64_t, CSystemnode*>> vecSystemnodeLastPaid;
 
     /*
         Make a vector with all of the last paid times
     */
 
     int nSnCount = CountEnabled();
+
+    // collect everyone scheduled in the next blocks once instead of probing the payment votes per node
+    std::set<CScript> setScheduledPayees;
+    systemnodePayments.GetScheduledPayees(nBlockHeight, setScheduledPayees);
+
     for (auto& sn : vSystemnodes) {
         sn.Check();
         if (!sn.IsEnabled())
             continue;
 
         //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
-        if (systemnodePayments.IsScheduled(sn, nBlockHeight))
+        if (setScheduledPayees.count(GetScriptForDestination(PKHash(sn.pubkey))))
             continue;
 
         // For security reasons and for network stability there is a delay to get the first reward.
@@ -441,7 +615,7 @@ CSystemnode* CSystemnodeMan::GetNextSystemnodeInQueueForPayment(int nBlockHeight
         if (sn.GetSystemnodeInputAge() < nSnCount)
             continue;
 
-        vecSystemnodeLastPaid.push_back(std::make_pair(sn.SecondsSincePayment(), sn.vin));
+        vecSystemnodeLastPaid.push_back(std::make_pair(sn.SecondsSincePayment(nSnCount), &sn));
     }
 
     nCount = (int)vecSystemnodeLastPaid.size();
@@ -457,13 +631,11 @@ CSystemnode* CSystemnodeMan::GetNextSystemnodeInQueueForPayment(int nBlockHeight
     //  -- This doesn't look at who is being paid in the +8-10 blocks, allowing for double payments very rarely
     //  -- 1/100 payments should be a double payment on mainnet - (1/(3000/10))*2
     //  -- (chance per block * chances before IsScheduled will fire)
-    int nTenthNetwork = CountEnabled() / 10;
+    int nTenthNetwork = nSnCount / 10;
     int nCountTenth = 0;
     arith_uint256 nHigh = 0;
     for (auto& s : vecSystemnodeLastPaid) {
-        CSystemnode* pmn = Find(s.second);
-        if (!pmn)
-            break;
+        CSystemnode* pmn = s.second;
 
         arith_uint256 n = pmn->CalculateScore(nBlockHeight - 100);
         if (n > nHigh) {
@@ -488,6 +660,9 @@ bool CSystemnodeMan::Add(CSystemnode& sn)
     if (!psn) {
         LogPrint(BCLog::SYSTEMNODE, "CSystemnodeMan: Adding new Systemnode %s - %i now\n", sn.addr.ToString(), size() + 1);
         vSystemnodes.push_back(sn);
+        if (!fIndexesDirty)
+            IndexSystemnode(vSystemnodes.size() - 1);
+        NotifySystemnodeUpdates();
         return true;
     }
 
@@ -521,6 +696,7 @@ void CSystemnodeMan::Remove(CTxIn vin)
         if ((*it).vin == vin) {
             LogPrint(BCLog::SYSTEMNODE, "CSystemnodeMan: Removing Systemnode %s - %i now\n", (*it).addr.ToString(), size() - 1);
             vSystemnodes.erase(it);
+            NotifySystemnodeUpdates(true);
             break;
         }
         ++it;
@@ -538,6 +714,8 @@ std::string CSystemnodeMan::ToString() const
 
 CSystemnode* CSystemnodeMan::GetCurrentSystemNode(int mod, int64_t nBlockHeight, int minProtocol)
 {
+    LOCK2(cs_main, cs);
+
     int64_t score = 0;
     CSystemnode* winner = nullptr;
 
@@ -561,43 +739,6 @@ CSystemnode* CSystemnodeMan::GetCurrentSystemNode(int mod, int64_t nBlockHeight,
     return winner;
 }
 
-int CSystemnodeMan::GetSystemnodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
-{
-    std::vector<std::pair<int64_t, CTxIn> > vecSystemnodeScores;
-
-    //make sure we know about this block
-    uint256 hash = uint256();
-    if (!GetBlockHash(hash, nBlockHeight))
-        return -1;
-
-    // scan for winner
-    for (auto& sn : vSystemnodes) {
-        if (sn.protocolVersion < minProtocol)
-            continue;
-        if (fOnlyActive) {
-            sn.Check();
-            if (!sn.IsEnabled())
-                continue;
-        }
-        arith_uint256 n = sn.CalculateScore(nBlockHeight);
-        int64_t n2 = n.GetCompact(false);
-
-        vecSystemnodeScores.push_back(std::make_pair(n2, sn.vin));
-    }
-
-    sort(vecSystemnodeScores.rbegin(), vecSystemnodeScores.rend(), CompareScoreTxIn());
-
-    int rank = 0;
-    for (auto& s : vecSystemnodeScores) {
-        rank++;
-        if (s.second.prevout == vin.prevout) {
-            return rank;
-        }
-    }
-
-    return -1;
-}
-
 bool CSystemnodeMan::CheckSnbAndUpdateSystemnodeList(CSystemnodeBroadcast snb, int& nDos, CConnman& connman)
 {
     nDos = 0;
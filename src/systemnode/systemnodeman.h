@@ -10,20 +10,41 @@
 #include <key.h>
 #include <util/system.h>
 #include <base58.h>
+#include <util/bytevectorhash.h>
 #include <validation.h>
 #include <systemnode/systemnode.h>
 
+#include <atomic>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+
 #define SYSTEMNODES_DUMP_SECONDS (15 * 60)
 #define SYSTEMNODES_DSEG_SECONDS (3 * 60 * 60)
+#define SYSTEMNODE_RANK_CACHE_SIZE 64
 
 
 class CSystemnodeMan;
 
+/** Immutable copy of the systemnode list handed to readers, replaced as a whole when the list changes */
+struct SystemnodeListSnapshot {
+    int64_t nVersion;
+    std::vector<CSystemnode> vSystemnodes;
+    // positions in vSystemnodes by collateral outpoint, the first entry wins on duplicates
+    std::unordered_map<COutPoint, size_t, SaltedOutpointHasher> mapIndexByOutpoint;
+
+    const CSystemnode* Find(const COutPoint& outpoint) const
+    {
+        auto it = mapIndexByOutpoint.find(outpoint);
+        return it != mapIndexByOutpoint.end() ? &vSystemnodes[it->second] : nullptr;
+    }
+};
+
 extern CSystemnodeMan snodeman;
 
 class CSystemnodeMan {
 private:
-    // critical section to protect the inner data structures
+    // critical section to protect the inner data structures, taken after cs_main when both are needed
     mutable RecursiveMutex cs;
 
     // critical section to protect the inner data structures specifically on messaging
@@ -49,6 +70,49 @@ private:
     /// Set when Systemnodes are removed, cleared when CGovernanceManager is notified
     bool fSystemnodesRemoved;
 
+    // scores of the systemnode list at one height, sorted from the highest to the lowest
+    struct CSystemnodeScores {
+        std::vector<std::pair<int64_t, COutPoint>> vecScores;
+        std::unordered_map<COutPoint, int, SaltedOutpointHasher> mapRanks;
+    };
+
+    // (height, min protocol, only active) => scores, valid for hashRankCacheTip and nRankCacheVersion only
+    std::map<std::tuple<int64_t, int, bool>, CSystemnodeScores> mapRankCache;
+    uint256 hashRankCacheTip;
+    int64_t nRankCacheVersion{-1};
+
+    /// Bumped whenever an entry is added, removed or changes its state
+    std::atomic<int64_t> nListVersion{0};
+    /// Bumped by CheckAndRemove when entries received pings since its last pass, so the
+    /// snapshot shows recent last-seen times without being copied again for every ping
+    std::atomic<int64_t> nPingVersion{0};
+    std::atomic<bool> fPingsUnpublished{false};
+
+    // list published to readers by GetListSnapshot and the list version it was taken at
+    std::shared_ptr<const SystemnodeListSnapshot> pListSnapshot;
+    std::atomic<int64_t> nListSnapshotVersion{-1};
+
+    // positions in vSystemnodes by collateral outpoint, pubkey2 and service, the first entry wins on duplicates
+    std::unordered_map<COutPoint, size_t, SaltedOutpointHasher> mapIndexByOutpoint;
+    std::unordered_map<std::vector<unsigned char>, size_t, ByteVectorHash> mapIndexByPubKey;
+    std::unordered_map<std::vector<unsigned char>, size_t, ByteVectorHash> mapIndexByService;
+    /// Set when entries were removed or their keys changed, the indexes are rebuilt on the next lookup
+    std::atomic<bool> fIndexesDirty{true};
+
+    // broadcast hashes of the enabled entries and their positions in vSystemnodes, announced to peers
+    // asking for the whole list, valid for nDsegInventoryVersion only
+    std::vector<std::pair<uint256, size_t>> vecDsegInventory;
+    int64_t nDsegInventoryVersion{-1};
+
+    /// Rebuild the list announced to SNDSEG requests if the list changed since it was built
+    void UpdateDsegInventory();
+
+    void IndexSystemnode(size_t nPos);
+    void RebuildIndexes();
+
+    /// Return the cached scores for this height, nullptr if the block is unknown
+    const CSystemnodeScores* GetScores(int64_t nBlockHeight, int minProtocol, bool fOnlyActive);
+
 public:
     // Keep track of all broadcasts I've seen
     std::map<uint256, CSystemnodeBroadcast> mapSeenSystemnodeBroadcast;
@@ -65,6 +129,7 @@ public:
         READWRITE(obj.mWeAskedForSystemnodeListEntry);
         READWRITE(obj.mapSeenSystemnodeBroadcast);
         READWRITE(obj.mapSeenSystemnodePing);
+        SER_READ(obj, obj.NotifySystemnodeUpdates(true));
     }
 
     //CSystemnodeMan();
@@ -88,6 +153,14 @@ public:
     /// Clear Systemnode vector
     void Clear();
 
+    /// Copy the state stored in sncache.dat into an empty manager, so it can be written without holding cs
+    void GetSnapshot(CSystemnodeMan& snapshot) const;
+
+    /// Look up every collateral in the UTXO set, done once after the cache is loaded
+    void CheckCollaterals();
+    /// Flag the systemnodes whose collateral was restored or spent by a connected or disconnected block
+    void UpdateCollaterals(const std::vector<COutPoint>& vRestored, const std::vector<COutPoint>& vSpent);
+
     int CountEnabled(int protocolVersion = -1);
 
     void DsegUpdate(CNode* pnode, CConnman& connman);
@@ -103,17 +176,32 @@ public:
     /// Get the current winner for this block
     CSystemnode* GetCurrentSystemNode(int mod = 1, int64_t nBlockHeight = 0, int minProtocol = 0);
 
-    std::vector<CSystemnode> GetFullSystemnodeVector()
-    {
-        Check();
-        return vSystemnodes;
-    }
+    /// Return the current list without copying it, it is only copied again once the list version changed
+    std::shared_ptr<const SystemnodeListSnapshot> GetListSnapshot();
 
     std::vector<std::pair<int, CSystemnode>> GetSystemnodeRanks(int64_t nBlockHeight, int minProtocol = 0);
     int GetSystemnodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol = 0, bool fOnlyActive = true);
 
     void ProcessSystemnodeConnections(CConnman& connman);
 
+    /// Invalidate the cached ranks after an entry changed its state or protocol, and the lookup indexes if its keys changed
+    void NotifySystemnodeUpdates(bool fKeysChanged = false)
+    {
+        ++nListVersion;
+        if (fKeysChanged)
+            fIndexesDirty = true;
+    }
+
+    /// Record a new ping of an entry, published to the list snapshot on the next CheckAndRemove
+    void NotifySystemnodePing() { fPingsUnpublished = true; }
+
+    /// Changes whenever the list or the state of an entry changed, and at most once per CheckAndRemove for pings
+    int64_t GetListVersion() const { return nListVersion + nPingVersion; }
+
+    /// Whether this broadcast or ping was seen already, safe to call from other threads
+    bool HasSeenBroadcast(const uint256& hash) const { LOCK(cs); return mapSeenSystemnodeBroadcast.count(hash); }
+    bool HasSeenPing(const uint256& hash) const { LOCK(cs); return mapSeenSystemnodePing.count(hash); }
+
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman);
 
     /// Return the number of (unique) Systemnodes
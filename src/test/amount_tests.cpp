@@ -4,8 +4,12 @@
 
 #include <amount.h>
 #include <policy/feerate.h>
+#include <primitives/asset.h>
+#include <streams.h>
 #include <test/util/setup_common.h>
 
+#include <map>
+
 #include <boost/test/unit_test.hpp>
 
 BOOST_FIXTURE_TEST_SUITE(amount_tests, BasicTestingSetup)
@@ -112,4 +116,177 @@ BOOST_AUTO_TEST_CASE(ToStringTest)
     BOOST_CHECK_EQUAL(feeRate.ToString(FeeEstimateMode::SAT_VB), "0.001 sat/vB");
 }
 
+static CAsset MakeAsset(unsigned char n)
+{
+    CAsset asset;
+    *asset.assetID.begin() = n;
+    return asset;
+}
+
+static bool IsSorted(const CAmountMap& map)
+{
+    return std::is_sorted(map.begin(), map.end(), [](const CAmountMapEntry& a, const CAmountMapEntry& b) { return a.first < b.first; });
+}
+
+BOOST_AUTO_TEST_CASE(AmountMapInsertOrderTest)
+{
+    // more assets than are stored inline, inserted out of order
+    const unsigned char order[] = {5, 1, 4, 2, 3};
+    static_assert(sizeof(order) > CAmountMap::INLINE_ASSETS, "the map must spill to the heap");
+
+    CAmountMap map;
+    for (unsigned char n : order) {
+        map[MakeAsset(n)] = n * 10;
+        BOOST_CHECK(IsSorted(map));
+    }
+    BOOST_CHECK_EQUAL(map.size(), 5U);
+    for (unsigned char n = 1; n <= 5; n++) {
+        BOOST_CHECK_EQUAL(map.count(MakeAsset(n)), 1U);
+        BOOST_CHECK_EQUAL(map.at(MakeAsset(n)), n * 10);
+    }
+    BOOST_CHECK(map.find(MakeAsset(6)) == map.end());
+    BOOST_CHECK_THROW(map.at(MakeAsset(6)), std::out_of_range);
+
+    // insert and emplace keep an existing amount, like std::map
+    BOOST_CHECK(!map.insert(CAmountMapEntry(MakeAsset(3), 1)).second);
+    BOOST_CHECK(!map.emplace(MakeAsset(4), 1).second);
+    BOOST_CHECK_EQUAL(map.at(MakeAsset(3)), 30);
+    BOOST_CHECK_EQUAL(map.at(MakeAsset(4)), 40);
+    BOOST_CHECK(map.emplace(MakeAsset(0), 1).second);
+    BOOST_CHECK(map.begin()->first == MakeAsset(0));
+
+    BOOST_CHECK_EQUAL(map.erase(MakeAsset(3)), 1U);
+    BOOST_CHECK_EQUAL(map.erase(MakeAsset(3)), 0U);
+    map.erase(map.find(MakeAsset(0)));
+    BOOST_CHECK_EQUAL(map.size(), 4U);
+    BOOST_CHECK(IsSorted(map));
+
+    // copies of a spilled map are independent
+    CAmountMap copy(map);
+    copy[MakeAsset(1)] = 0;
+    BOOST_CHECK_EQUAL(map.at(MakeAsset(1)), 10);
+
+    // the initializer list sorts its entries too and keeps the first amount of an asset
+    CAmountMap init{{MakeAsset(2), 2}, {MakeAsset(1), 1}, {MakeAsset(2), 3}};
+    BOOST_CHECK_EQUAL(init.size(), 2U);
+    BOOST_CHECK(IsSorted(init));
+    BOOST_CHECK_EQUAL(init.at(MakeAsset(2)), 2);
+}
+
+BOOST_AUTO_TEST_CASE(AmountMapMergeTest)
+{
+    const CAsset a = MakeAsset(1), b = MakeAsset(2), c = MakeAsset(3), d = MakeAsset(4);
+
+    CAmountMap x{{a, 10}, {c, 30}};
+    CAmountMap y{{b, 2}, {c, 3}, {d, 4}};
+
+    CAmountMap sum = x + y;
+    BOOST_CHECK_EQUAL(sum.size(), 4U);
+    BOOST_CHECK(IsSorted(sum));
+    BOOST_CHECK_EQUAL(valueFor(sum, a), 10);
+    BOOST_CHECK_EQUAL(valueFor(sum, b), 2);
+    BOOST_CHECK_EQUAL(valueFor(sum, c), 33);
+    BOOST_CHECK_EQUAL(valueFor(sum, d), 4);
+
+    CAmountMap diff = x - y;
+    BOOST_CHECK_EQUAL(diff.size(), 4U);
+    BOOST_CHECK(IsSorted(diff));
+    BOOST_CHECK_EQUAL(valueFor(diff, b), -2);
+    BOOST_CHECK_EQUAL(valueFor(diff, c), 27);
+
+    // subtracting everything back leaves zero amounts, which compare equal to an empty map
+    CAmountMap acc(x);
+    acc += y;
+    acc -= y;
+    BOOST_CHECK(acc == x);
+    acc -= x;
+    BOOST_CHECK(!acc);
+    BOOST_CHECK(acc == CAmountMap());
+
+    // scalar operators apply to each asset and keep the key set
+    CAmountMap scaled = x * 3;
+    BOOST_CHECK_EQUAL(valueFor(scaled, a), 30);
+    BOOST_CHECK_EQUAL(valueFor(scaled, c), 90);
+    BOOST_CHECK_EQUAL(valueFor(scaled / 3, c), 30);
+    BOOST_CHECK_EQUAL(valueFor(x % 7, c), 2);
+    BOOST_CHECK_EQUAL(valueFor(x - 5, a), 5);
+
+    // map by map multiplication and division only keep the assets of both maps
+    CAmountMap product = x * y;
+    BOOST_CHECK_EQUAL(product.size(), 1U);
+    BOOST_CHECK_EQUAL(valueFor(product, c), 90);
+    CAmountMap quotient = x / y;
+    BOOST_CHECK_EQUAL(quotient.size(), 1U);
+    BOOST_CHECK_EQUAL(valueFor(quotient, c), 10);
+}
+
+BOOST_AUTO_TEST_CASE(AmountMapCompareTest)
+{
+    const CAsset a = MakeAsset(1), b = MakeAsset(2), c = MakeAsset(3);
+
+    // a missing asset counts as zero
+    CAmountMap ab{{a, 1}, {b, 2}};
+    CAmountMap abc{{a, 1}, {b, 2}, {c, 1}};
+    BOOST_CHECK(ab <= abc);
+    BOOST_CHECK(ab < abc);
+    BOOST_CHECK(!(ab == abc));
+    BOOST_CHECK(abc > ab);
+    BOOST_CHECK(abc >= ab);
+    BOOST_CHECK(!(abc < ab));
+
+    BOOST_CHECK(ab == ab);
+    BOOST_CHECK(ab <= ab);
+    BOOST_CHECK(!(ab < ab));
+    BOOST_CHECK(!(ab > ab));
+
+    CAmountMap abZero{{a, 1}, {b, 2}, {c, 0}};
+    BOOST_CHECK(ab == abZero);
+    BOOST_CHECK(!(ab < abZero));
+    BOOST_CHECK(ab <= abZero && ab >= abZero);
+
+    // maps with different key sets that are not ordered either way
+    CAmountMap bc{{b, 2}, {c, 1}};
+    BOOST_CHECK(ab != bc);
+    BOOST_CHECK(!(ab < bc));
+    BOOST_CHECK(!(ab <= bc));
+    BOOST_CHECK(!(ab > bc));
+    BOOST_CHECK(!(ab >= bc));
+
+    CAmountMap a2{{a, 2}};
+    CAmountMap bOnly{{b, 1}};
+    BOOST_CHECK(!(a2 < bOnly));
+    BOOST_CHECK(!(a2 <= bOnly));
+    BOOST_CHECK(!(bOnly <= a2));
+
+    // comparing with an empty map checks the sign of every amount
+    CAmountMap negative{{b, 2}, {c, -1}};
+    BOOST_CHECK(CAmountMap() < ab);
+    BOOST_CHECK(!(CAmountMap() < negative));
+    BOOST_CHECK(!(CAmountMap() <= negative));
+    BOOST_CHECK(ab > negative);
+}
+
+BOOST_AUTO_TEST_CASE(AmountMapSerializeTest)
+{
+    // the flat map serializes exactly like the std::map it replaced
+    CAmountMap map;
+    std::map<CAsset, CAmount> stdMap;
+    for (unsigned char n : {4, 2, 7, 1}) {
+        map[MakeAsset(n)] = 1000 * n;
+        stdMap[MakeAsset(n)] = 1000 * n;
+    }
+
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    CDataStream ssStd(SER_DISK, PROTOCOL_VERSION);
+    ss << map;
+    ssStd << stdMap;
+    BOOST_CHECK(ss.str() == ssStd.str());
+
+    CAmountMap read;
+    ssStd >> read;
+    BOOST_CHECK(read == map);
+    BOOST_CHECK_EQUAL(read.size(), map.size());
+    BOOST_CHECK(IsSorted(read));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,152 @@
+// Copyright (c) 2017-2020 The Crown Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <assetdb.h>
+#include <test/util/setup_common.h>
+#include <util/string.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+//! Names and short names differing only by case, so lookups must fold it
+const std::vector<std::string> ASSET_NAMES = {"Gold", "GOLD", "silver", "Crown", "crown", "Oil"};
+const std::vector<std::string> SHORT_NAMES = {"GLD", "gld", "SLV", "CRW", "OIL"};
+
+CAssetData MakeAssetData(const std::string& strName, const std::string& strShortName, CAmount nInputAmount = 0)
+{
+    AssetMetadata meta;
+    meta.nVersion = AssetMetadata::CURRENT_VERSION;
+    meta.setName(strName);
+    meta.setShortName(strShortName);
+    CAssetData data;
+    data.asset = CAsset(meta);
+    data.inputAmount = nInputAmount;
+    return data;
+}
+
+//! Whether the cache holds pdata under any key, as opposed to a dangling or evicted entry
+bool IsCached(const CAssetsCache& cache, const CAssetData* pdata)
+{
+    for (const auto& item : cache.GetItemsList()) {
+        if (&item.second == pdata)
+            return true;
+    }
+    return false;
+}
+
+//! Compare every index lookup with a scan over the cached assets
+void CheckIndexes(const CAssetsCache& cache)
+{
+    for (const std::string& strName : ASSET_NAMES) {
+        bool fName = false, fNameOrShort = false;
+        for (const auto& item : cache.GetItemsList()) {
+            fName |= iequals(strName, item.second.asset.getAssetName());
+            fNameOrShort |= iequals(strName, item.second.asset.getAssetName()) || iequals(strName, item.second.asset.getShortName());
+        }
+        const CAssetData* pdata = cache.FindByName(strName);
+        BOOST_CHECK_EQUAL(pdata != nullptr, fName);
+        if (pdata) {
+            BOOST_CHECK(IsCached(cache, pdata));
+            BOOST_CHECK(iequals(strName, pdata->asset.getAssetName()));
+        }
+        BOOST_CHECK_EQUAL(cache.FindByNameOrShortName(strName) != nullptr, fNameOrShort);
+    }
+
+    for (const std::string& strShortName : SHORT_NAMES) {
+        bool fShort = false;
+        for (const auto& item : cache.GetItemsList())
+            fShort |= iequals(strShortName, item.second.asset.getShortName()) || iequals(strShortName, item.second.asset.getAssetName());
+        const CAssetData* pdata = cache.FindByNameOrShortName(strShortName);
+        BOOST_CHECK_EQUAL(pdata != nullptr, fShort);
+        if (pdata) {
+            BOOST_CHECK(IsCached(cache, pdata));
+            BOOST_CHECK(iequals(strShortName, pdata->asset.getShortName()) || iequals(strShortName, pdata->asset.getAssetName()));
+        }
+    }
+
+    std::map<CAsset, CAmount> mapAmounts;
+    for (const auto& item : cache.GetItemsList())
+        mapAmounts[item.second.asset] += item.second.inputAmount;
+    for (const auto& entry : mapAmounts) {
+        const CAssetData* pdata = cache.FindByAsset(entry.first);
+        BOOST_REQUIRE(pdata != nullptr);
+        BOOST_CHECK(IsCached(cache, pdata));
+        BOOST_CHECK(pdata->asset == entry.first);
+        BOOST_CHECK_EQUAL(cache.GetInputAmount(entry.first), entry.second);
+    }
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(assetdb_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(assetscache_indexes)
+{
+    FastRandomContext rand(true);
+    CAssetsCache cache(8);
+
+    const CAssetData gold = MakeAssetData("Gold", "GLD");
+    cache.Put("Gold", gold);
+    BOOST_CHECK(cache.FindByName("gOLD") != nullptr);
+    BOOST_CHECK(cache.FindByNameOrShortName("gld") != nullptr);
+    BOOST_CHECK(cache.FindByName("gld") == nullptr);
+    BOOST_CHECK(cache.FindByAsset(gold.asset) != nullptr);
+
+    // replacing a key drops the names of its previous asset
+    const CAssetData oil = MakeAssetData("Oil", "OIL");
+    cache.Put("Gold", oil);
+    BOOST_CHECK(cache.FindByName("Gold") == nullptr);
+    BOOST_CHECK(cache.FindByAsset(gold.asset) == nullptr);
+    BOOST_CHECK(cache.FindByName("oil") != nullptr);
+
+    cache.Erase("Gold");
+    BOOST_CHECK(cache.FindByNameOrShortName("OIL") == nullptr);
+    BOOST_CHECK(cache.FindByAsset(oil.asset) == nullptr);
+    CheckIndexes(cache);
+
+    // evicting the least recently used asset drops its names too, a touched one is kept
+    cache.Put("KEY0", gold);
+    cache.Put("KEY1", MakeAssetData("silver", "SLV"));
+    for (size_t i = 2; i < cache.MaxSize(); i++)
+        cache.Put(strprintf("KEY%d", i), oil);
+    cache.Get("KEY0");
+    cache.Put("KEY8", oil);
+    BOOST_CHECK(cache.FindByName("Gold") != nullptr);
+    BOOST_CHECK(cache.FindByNameOrShortName("slv") == nullptr);
+    cache.Put("KEY9", oil);
+    BOOST_CHECK(cache.FindByName("Oil") != nullptr);
+    BOOST_CHECK(cache.FindByName("Gold") != nullptr);
+    CheckIndexes(cache);
+    cache.Clear();
+
+    // random puts, replacements, touches and erases over more keys than the cache holds, so
+    // the least recently used asset keeps being evicted
+    for (int i = 0; i < 2000; i++) {
+        const std::string key = strprintf("KEY%d", rand.randrange(20));
+        switch (rand.randrange(4)) {
+        case 0:
+        case 1:
+            cache.Put(key, MakeAssetData(ASSET_NAMES[rand.randrange(ASSET_NAMES.size())], SHORT_NAMES[rand.randrange(SHORT_NAMES.size())], rand.randrange(1000)));
+            break;
+        case 2:
+            if (cache.Exists(key))
+                cache.Get(key);
+            break;
+        case 3:
+            cache.Erase(key);
+            break;
+        }
+        BOOST_CHECK_LE(cache.Size(), cache.MaxSize());
+        CheckIndexes(cache);
+    }
+
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.Size(), 0U);
+    CheckIndexes(cache);
+    for (const std::string& strName : ASSET_NAMES)
+        BOOST_CHECK(cache.FindByNameOrShortName(strName) == nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
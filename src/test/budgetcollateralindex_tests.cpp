@@ -0,0 +1,191 @@
+// Copyright (c) 2014-2020 The Crown developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <index/budgetcollateralindex.h>
+#include <index/txindex.h>
+#include <masternode/masternode-budget.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+//! Wait for an index to catch up with the active chain
+void SyncIndex(BaseIndex& index)
+{
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+}
+
+struct CollateralResult {
+    bool fValid;
+    std::string strError;
+    int64_t nTime{0};
+    int nConf{0};
+};
+
+//! IsBudgetCollateralValid with the budget collateral index, or with only the -txindex fallback
+CollateralResult CheckCollateral(const uint256& txid, const uint256& expected, bool fUseIndex)
+{
+    std::unique_ptr<BudgetCollateralIndex> index;
+    if (!fUseIndex)
+        index = std::move(g_budget_collateral_index);
+
+    CollateralResult result;
+    result.fValid = IsBudgetCollateralValid(txid, expected, result.strError, result.nTime, result.nConf);
+
+    if (!fUseIndex)
+        g_budget_collateral_index = std::move(index);
+    return result;
+}
+
+void CheckSameResult(const uint256& txid, const uint256& expected)
+{
+    const CollateralResult indexed = CheckCollateral(txid, expected, true);
+    const CollateralResult scanned = CheckCollateral(txid, expected, false);
+    BOOST_CHECK_EQUAL(indexed.fValid, scanned.fValid);
+    BOOST_CHECK_EQUAL(indexed.strError, scanned.strError);
+    BOOST_CHECK_EQUAL(indexed.nTime, scanned.nTime);
+    BOOST_CHECK_EQUAL(indexed.nConf, scanned.nConf);
+}
+
+//! The index entry of txid must be what GetBudgetFeeOutput reads from the transaction in the block it names
+void CheckCollateralEntry(const uint256& txid)
+{
+    CBudgetCollateral collateral;
+    BOOST_REQUIRE(g_budget_collateral_index->FindCollateral(txid, collateral));
+
+    const CBlockIndex* pindex = WITH_LOCK(cs_main, return LookupBlockIndex(collateral.blockHash));
+    BOOST_REQUIRE(pindex != nullptr);
+    BOOST_CHECK_EQUAL(collateral.nHeight, pindex->nHeight);
+
+    uint256 hashBlock;
+    CTransactionRef tx = GetTransaction(pindex, nullptr, txid, Params().GetConsensus(), hashBlock);
+    BOOST_REQUIRE(tx);
+    CAmount nAmount = 0;
+    std::vector<unsigned char> vchPayload;
+    bool fStandardOutputs = false;
+    BOOST_CHECK(GetBudgetFeeOutput(*tx, nAmount, vchPayload, fStandardOutputs));
+    BOOST_CHECK_EQUAL(collateral.nAmount, nAmount);
+    BOOST_CHECK(collateral.vchPayload == vchPayload);
+    BOOST_CHECK_EQUAL(collateral.fStandardOutputs, fStandardOutputs);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(budgetcollateralindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(budgetcollateralindex_sync_and_reorg, TestChain100Setup)
+{
+    const CScript scriptCoinbase = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const CScript scriptChange = GetScriptForDestination(PKHash(coinbaseKey.GetPubKey()));
+
+    // spend mature coinbases to an OP_RETURN fee output, a block reward alone is below BUDGET_FEE_TX
+    auto createCollateral = [&](size_t nFirstCoinbase, const uint256& hashProposal, CAmount nFee, const CScript& scriptExtra) {
+        CMutableTransaction tx;
+        tx.nVersion = 1;
+        CAmount nValueIn = 0;
+        for (size_t i = nFirstCoinbase; i < nFirstCoinbase + 3; i++) {
+            tx.vin.emplace_back(COutPoint(m_coinbase_txns[i]->GetHash(), 0));
+            nValueIn += m_coinbase_txns[i]->vout[0].nValue;
+        }
+        tx.vout.emplace_back(nFee, CScript() << OP_RETURN << ToByteVector(hashProposal));
+        tx.vout.emplace_back(1 * COIN, scriptExtra);
+        tx.vout.emplace_back(nValueIn - nFee - 1 * COIN - 1 * CENT, scriptChange);
+        for (size_t i = 0; i < tx.vin.size(); i++) {
+            std::vector<unsigned char> vchSig;
+            uint256 hash = SignatureHash(scriptCoinbase, tx, i, SIGHASH_ALL, 0, SigVersion::BASE);
+            BOOST_REQUIRE(coinbaseKey.Sign(hash, vchSig));
+            vchSig.push_back((unsigned char)SIGHASH_ALL);
+            tx.vin[i].scriptSig << vchSig;
+        }
+        return tx;
+    };
+
+    // let the coinbases spent below mature
+    for (int i = 0; i < 10; i++)
+        CreateAndProcessBlock({}, scriptCoinbase);
+
+    const uint256 hashProposal = InsecureRand256();
+    const CMutableTransaction txCollateral = createCollateral(0, hashProposal, BUDGET_FEE_TX, scriptChange);
+    // a fee output paying too little is not a collateral, one next to a non standard output is indexed but invalid
+    const CMutableTransaction txLowFee = createCollateral(3, hashProposal, BUDGET_FEE_TX - 1, scriptChange);
+    const CMutableTransaction txNonStandard = createCollateral(6, hashProposal, BUDGET_FEE_TX, CScript() << OP_TRUE);
+
+    // mined before the indexes start, so the initial sync has to pick them up
+    const CBlock blockCollateral = CreateAndProcessBlock({txCollateral, txLowFee, txNonStandard}, scriptCoinbase);
+    BOOST_REQUIRE_EQUAL(blockCollateral.vtx.size(), 4U);
+    for (int i = 0; i < BUDGET_FEE_CONFIRMATIONS; i++)
+        CreateAndProcessBlock({}, scriptCoinbase);
+
+    g_txindex = std::make_unique<TxIndex>(1 << 20, true);
+    g_budget_collateral_index = std::make_unique<BudgetCollateralIndex>(1 << 20, true);
+    CBudgetCollateral collateral;
+    BOOST_CHECK(!g_budget_collateral_index->FindCollateral(txCollateral.GetHash(), collateral));
+    g_txindex->Start();
+    g_budget_collateral_index->Start();
+    SyncIndex(*g_txindex);
+    SyncIndex(*g_budget_collateral_index);
+
+    BOOST_CHECK(!g_budget_collateral_index->FindCollateral(txLowFee.GetHash(), collateral));
+    CheckCollateralEntry(txCollateral.GetHash());
+    CheckCollateralEntry(txNonStandard.GetHash());
+    BOOST_CHECK(CheckCollateral(txCollateral.GetHash(), hashProposal, true).fValid);
+    for (const auto& tx : {txCollateral, txLowFee, txNonStandard})
+        CheckSameResult(tx.GetHash(), hashProposal);
+    // a collateral for another proposal is accepted the same way by both paths
+    CheckSameResult(txCollateral.GetHash(), InsecureRand256());
+
+    // reorg the collateral out: the stale entry is kept but no longer confirms anything
+    const CBlockIndex* pindexStale = WITH_LOCK(cs_main, return LookupBlockIndex(blockCollateral.GetHash()));
+    BOOST_REQUIRE(pindexStale != nullptr);
+    BlockValidationState state;
+    BOOST_REQUIRE(ChainstateActive().InvalidateBlock(state, Params(), const_cast<CBlockIndex*>(pindexStale)));
+    for (int i = 0; i < BUDGET_FEE_CONFIRMATIONS + 2; i++)
+        CreateAndProcessBlock({}, scriptCoinbase);
+    SyncIndex(*g_txindex);
+    SyncIndex(*g_budget_collateral_index);
+
+    BOOST_REQUIRE(g_budget_collateral_index->FindCollateral(txCollateral.GetHash(), collateral));
+    BOOST_CHECK(collateral.blockHash == blockCollateral.GetHash());
+    BOOST_CHECK(WITH_LOCK(cs_main, return !::ChainActive().Contains(pindexStale)));
+    const CollateralResult stale = CheckCollateral(txCollateral.GetHash(), hashProposal, true);
+    BOOST_CHECK(!stale.fValid);
+    BOOST_CHECK_EQUAL(stale.nConf, 0);
+    CheckSameResult(txCollateral.GetHash(), hashProposal);
+
+    // mined again on the new chain, the entry moves to the new block
+    const CBlock blockRemined = CreateAndProcessBlock({txCollateral}, scriptCoinbase);
+    BOOST_REQUIRE_EQUAL(blockRemined.vtx.size(), 2U);
+    for (int i = 0; i < BUDGET_FEE_CONFIRMATIONS; i++)
+        CreateAndProcessBlock({}, scriptCoinbase);
+    SyncIndex(*g_txindex);
+    SyncIndex(*g_budget_collateral_index);
+
+    BOOST_REQUIRE(g_budget_collateral_index->FindCollateral(txCollateral.GetHash(), collateral));
+    BOOST_CHECK(collateral.blockHash == blockRemined.GetHash());
+    CheckCollateralEntry(txCollateral.GetHash());
+    BOOST_CHECK(CheckCollateral(txCollateral.GetHash(), hashProposal, true).fValid);
+    CheckSameResult(txCollateral.GetHash(), hashProposal);
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    g_budget_collateral_index->Stop();
+    g_txindex->Stop();
+
+    // Let scheduler events finish running to avoid accessing any memory related to the indexes after they are destructed
+    SyncWithValidationInterfaceQueue();
+    g_budget_collateral_index.reset();
+    g_txindex.reset();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -6,6 +6,7 @@
 #include <clientversion.h>
 #include <coins.h>
 #include <script/standard.h>
+#include <shutdown.h>
 #include <streams.h>
 #include <test/util/setup_common.h>
 #include <txdb.h>
@@ -878,4 +879,159 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+static CAsset MakeAsset(unsigned char n)
+{
+    CAsset asset;
+    *asset.assetID.begin() = n;
+    asset.setName(strprintf("asset%d", n));
+    return asset;
+}
+
+static std::map<COutPoint, Coin> MakeAssetCoins()
+{
+    std::map<COutPoint, Coin> coins;
+    for (int i = 0; i < 20; i++) {
+        CTxOutAsset out(MakeAsset(i % 3), 1 + (CAmount)InsecureRandBits(40), CScript() << i);
+        coins.emplace(COutPoint(InsecureRand256(), i), Coin(out, i, i == 0, false));
+    }
+    return coins;
+}
+
+static void WriteCoins(CCoinsViewDB& db, const std::map<COutPoint, Coin>& coins)
+{
+    CCoinsMap map;
+    for (const auto& coin : coins) {
+        CCoinsCacheEntry& entry = map[coin.first];
+        entry.coin = coin.second;
+        entry.flags = CCoinsCacheEntry::DIRTY;
+    }
+    BOOST_CHECK(db.BatchWrite(map, InsecureRand256()));
+}
+
+static void CheckCoins(const CCoinsViewDB& db, const std::map<COutPoint, Coin>& coins)
+{
+    for (const auto& coin : coins) {
+        Coin read;
+        BOOST_CHECK(db.GetCoin(coin.first, read));
+        BOOST_CHECK(read == coin.second);
+        BOOST_CHECK(read.out.nAsset.getAssetName() == coin.second.out.nAsset.getAssetName());
+    }
+    size_t found = 0;
+    std::unique_ptr<CCoinsViewCursor> cursor(db.Cursor());
+    for (; cursor->Valid(); cursor->Next()) {
+        COutPoint outpoint;
+        Coin read;
+        BOOST_CHECK(cursor->GetKey(outpoint));
+        BOOST_CHECK(cursor->GetValue(read));
+        auto it = coins.find(outpoint);
+        BOOST_CHECK(it != coins.end() && read == it->second);
+        found++;
+    }
+    BOOST_CHECK_EQUAL(found, coins.size());
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_asset_refs)
+{
+    const fs::path path = GetDataDir() / "coins_asset_refs";
+    const std::map<COutPoint, Coin> coins = MakeAssetCoins();
+    {
+        CCoinsViewDB db{path, 1 << 20, /*fMemory*/ false, /*fWipe*/ true};
+        BOOST_CHECK(db.Upgrade());
+        WriteCoins(db, coins);
+        CheckCoins(db, coins);
+    }
+    CCoinsViewDB db{path, 1 << 20, /*fMemory*/ false, /*fWipe*/ false};
+    CheckCoins(db, coins);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_asset_refs_upgrade)
+{
+    const fs::path path = GetDataDir() / "coins_asset_refs_upgrade";
+    const std::map<COutPoint, Coin> coins = MakeAssetCoins();
+    {
+        // written in the full asset format, then rewritten with references
+        CCoinsViewDB db{path, 1 << 20, /*fMemory*/ false, /*fWipe*/ true};
+        WriteCoins(db, coins);
+        CheckCoins(db, coins);
+        BOOST_CHECK(db.Upgrade());
+        CheckCoins(db, coins);
+    }
+    CCoinsViewDB db{path, 1 << 20, /*fMemory*/ false, /*fWipe*/ false};
+    CheckCoins(db, coins);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_asset_refs_upgrade_resume)
+{
+    const fs::path path = GetDataDir() / "coins_asset_refs_upgrade_resume";
+    const std::map<COutPoint, Coin> coins = MakeAssetCoins();
+    {
+        CCoinsViewDB db{path, 1 << 20, /*fMemory*/ false, /*fWipe*/ true};
+        WriteCoins(db, coins);
+
+        // write a batch per coin and stop after the first one
+        gArgs.ForceSetArg("-dbbatchsize", "1");
+        StartShutdown();
+        BOOST_CHECK(!db.Upgrade());
+        AbortShutdown();
+        gArgs.ForceSetArg("-dbbatchsize", ToString(nDefaultDbBatchSize));
+    }
+    {
+        // the coins rewritten before the interruption are skipped
+        CCoinsViewDB db{path, 1 << 20, /*fMemory*/ false, /*fWipe*/ false};
+        BOOST_CHECK(db.Upgrade());
+        CheckCoins(db, coins);
+    }
+    CCoinsViewDB db{path, 1 << 20, /*fMemory*/ false, /*fWipe*/ false};
+    CheckCoins(db, coins);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_asset_refs_newer_format)
+{
+    const fs::path path = GetDataDir() / "coins_asset_refs_newer_format";
+    {
+        CCoinsViewDB db{path, 1 << 20, /*fMemory*/ false, /*fWipe*/ true};
+        BOOST_CHECK(db.Upgrade());
+    }
+    {
+        CDBWrapper raw(path, 1 << 20, false, false, true);
+        raw.Write('V', uint8_t{2});
+    }
+    BOOST_CHECK_THROW(CCoinsViewDB(path, 1 << 20, false, false), dbwrapper_error);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_asset_refs_corrupted)
+{
+    const fs::path path = GetDataDir() / "coins_asset_refs_corrupted";
+    std::map<COutPoint, Coin> coins;
+    coins.emplace(COutPoint(InsecureRand256(), 0), Coin(CTxOutAsset(MakeAsset(1), 1, CScript()), 1, false, false));
+    {
+        CCoinsViewDB db{path, 1 << 20, /*fMemory*/ false, /*fWipe*/ true};
+        BOOST_CHECK(db.Upgrade());
+        WriteCoins(db, coins);
+    }
+    {
+        CDBWrapper raw(path, 1 << 20, false, false, true);
+        raw.Erase(std::make_pair('T', uint32_t{0}));
+    }
+    {
+        // a coin referring to an asset missing from the table is an error, not a missing coin
+        CCoinsViewDB db{path, 1 << 20, /*fMemory*/ false, /*fWipe*/ false};
+        Coin read;
+        BOOST_CHECK_THROW(db.GetCoin(coins.begin()->first, read), std::runtime_error);
+    }
+
+    coins.emplace(COutPoint(InsecureRand256(), 0), Coin(CTxOutAsset(MakeAsset(2), 1, CScript()), 1, false, false));
+    {
+        CCoinsViewDB db{path, 1 << 20, /*fMemory*/ false, /*fWipe*/ true};
+        BOOST_CHECK(db.Upgrade());
+        WriteCoins(db, coins);
+    }
+    {
+        CDBWrapper raw(path, 1 << 20, false, false, true);
+        raw.Erase(std::make_pair('T', uint32_t{0}));
+    }
+    // the table cannot be loaded with a gap
+    BOOST_CHECK_THROW(CCoinsViewDB(path, 1 << 20, false, false), dbwrapper_error);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,171 @@
+// Copyright (c) 2014-2020 The Crown developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <flat-database.h>
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+//! Minimal object with the interface CFlatDB expects from the managers it stores
+struct TestCache {
+    std::vector<unsigned char> vchData;
+    int nCleaned{0};
+
+    SERIALIZE_METHODS(TestCache, obj) { READWRITE(obj.vchData); }
+
+    void Clear() { vchData.clear(); }
+    void CheckAndRemove() { nCleaned++; }
+    std::string ToString() const { return strprintf("TestCache: %u bytes", vchData.size()); }
+};
+
+TestCache MakeCache(size_t nSize)
+{
+    TestCache cache;
+    cache.vchData.resize(nSize);
+    for (size_t i = 0; i < nSize; i++)
+        cache.vchData[i] = InsecureRand32();
+    return cache;
+}
+
+void FlipByte(const fs::path& path, size_t nPos)
+{
+    FILE* file = fsbridge::fopen(path, "rb+");
+    BOOST_REQUIRE(file != nullptr);
+    BOOST_REQUIRE(fseek(file, nPos, SEEK_SET) == 0);
+    int c = fgetc(file);
+    BOOST_REQUIRE(c != EOF);
+    BOOST_REQUIRE(fseek(file, nPos, SEEK_SET) == 0);
+    fputc(c ^ 0xff, file);
+    fclose(file);
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(flatdb_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(flatdb_chunked_roundtrip)
+{
+    // spans three chunks
+    const TestCache cache = MakeCache(2 * FLATDB_CHUNK_SIZE + 1000);
+    CFlatDB<TestCache> flatdb(fs::PathFromString("roundtrip2.dat"), "magicTestCache");
+    TestCache saved = cache;
+    BOOST_REQUIRE(flatdb.Dump(saved));
+
+    unsigned char pchSignature[sizeof(FLATDB_SIGNATURE)];
+    CAutoFile file(fsbridge::fopen(GetDataDir() / "roundtrip2.dat", "rb"), SER_DISK, CLIENT_VERSION);
+    file.read((char*)pchSignature, sizeof(pchSignature));
+    BOOST_CHECK(memcmp(pchSignature, FLATDB_SIGNATURE, sizeof(pchSignature)) == 0);
+    file.fclose();
+
+    TestCache loaded;
+    BOOST_CHECK(flatdb.Load(loaded));
+    BOOST_CHECK(loaded.vchData == cache.vchData);
+    BOOST_CHECK_EQUAL(loaded.nCleaned, 1);
+
+    // loading without cleaning leaves it to the caller
+    TestCache unclean;
+    BOOST_CHECK(flatdb.Load(unclean, false));
+    BOOST_CHECK(unclean.vchData == cache.vchData);
+    BOOST_CHECK_EQUAL(unclean.nCleaned, 0);
+
+    // an object of another type is not read, and its file is not overwritten
+    CFlatDB<TestCache> other(fs::PathFromString("roundtrip2.dat"), "magicOtherCache");
+    TestCache wrong;
+    BOOST_CHECK(!other.Load(wrong));
+    BOOST_CHECK(!other.Dump(saved));
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_corrupt_chunk)
+{
+    const TestCache cache = MakeCache(2 * FLATDB_CHUNK_SIZE);
+    CFlatDB<TestCache> flatdb1(fs::PathFromString("corrupt2.dat"), "magicTestCache");
+    CFlatDB<TestCache> flatdb2(fs::PathFromString("intact2.dat"), "magicTestCache");
+    TestCache saved = cache;
+    BOOST_REQUIRE(flatdb1.Dump(saved));
+    BOOST_REQUIRE(flatdb2.Dump(saved));
+
+    // a byte in the data of the second chunk
+    FlipByte(GetDataDir() / "corrupt2.dat", fs::file_size(GetDataDir() / "corrupt2.dat") - FLATDB_CHUNK_SIZE / 2);
+
+    // the corrupted cache is cleared to be recreated from the network, the other one is unaffected
+    TestCache loaded1 = MakeCache(10);
+    BOOST_CHECK(flatdb1.Load(loaded1));
+    BOOST_CHECK(loaded1.vchData.empty());
+
+    TestCache loaded2;
+    BOOST_CHECK(flatdb2.Load(loaded2));
+    BOOST_CHECK(loaded2.vchData == cache.vchData);
+
+    // a new dump replaces the corrupted file
+    BOOST_CHECK(flatdb1.Dump(saved));
+    BOOST_CHECK(flatdb1.Load(loaded1));
+    BOOST_CHECK(loaded1.vchData == cache.vchData);
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_truncated)
+{
+    const TestCache cache = MakeCache(FLATDB_CHUNK_SIZE + 1000);
+    CFlatDB<TestCache> flatdb(fs::PathFromString("truncated2.dat"), "magicTestCache");
+    TestCache saved = cache;
+    BOOST_REQUIRE(flatdb.Dump(saved));
+
+    const fs::path path = GetDataDir() / "truncated2.dat";
+    const uintmax_t nSize = fs::file_size(path);
+    // without the terminating chunk, inside the last chunk, and inside the first one
+    for (uintmax_t nTruncated : {nSize - 4, nSize - 500, uintmax_t{100}}) {
+        BOOST_REQUIRE(flatdb.Dump(saved));
+        fs::resize_file(path, nTruncated);
+        TestCache loaded = MakeCache(10);
+        BOOST_CHECK(flatdb.Load(loaded));
+        BOOST_CHECK(loaded.vchData.empty());
+    }
+
+    // no temporary file is left behind by the dumps
+    BOOST_CHECK(!fs::exists(GetDataDir() / "truncated2.dat.new"));
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_legacy_file)
+{
+    const TestCache cache = MakeCache(1000);
+
+    // magic message, network magic, object and the hash of all of it, as written by older versions
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << std::string("magicTestCache");
+    ss << Params().MessageStart();
+    ss << cache;
+    uint256 hash = Hash(ss);
+    ss << hash;
+    const fs::path pathLegacy = GetDataDir() / "legacy.dat";
+    {
+        CAutoFile file(fsbridge::fopen(pathLegacy, "wb"), SER_DISK, CLIENT_VERSION);
+        file.write((const char*)ss.data(), ss.size());
+    }
+
+    CFlatDB<TestCache> flatdb(fs::PathFromString("legacy2.dat"), "magicTestCache", fs::PathFromString("legacy.dat"));
+    TestCache loaded;
+    BOOST_CHECK(flatdb.Load(loaded));
+    BOOST_CHECK(loaded.vchData == cache.vchData);
+
+    // the dump goes to the new file, older versions keep reading theirs
+    const uintmax_t nLegacySize = fs::file_size(pathLegacy);
+    TestCache changed = MakeCache(2000);
+    BOOST_CHECK(flatdb.Dump(changed));
+    BOOST_CHECK(fs::exists(GetDataDir() / "legacy2.dat"));
+    BOOST_CHECK_EQUAL(fs::file_size(pathLegacy), nLegacySize);
+
+    // once written, the new file wins over the legacy one
+    BOOST_CHECK(flatdb.Load(loaded));
+    BOOST_CHECK(loaded.vchData == changed.vchData);
+
+    // a corrupted legacy file is cleared like a chunked one
+    FlipByte(pathLegacy, 40);
+    CFlatDB<TestCache> legacyOnly(fs::PathFromString("legacyonly2.dat"), "magicTestCache", fs::PathFromString("legacy.dat"));
+    TestCache corrupted = MakeCache(10);
+    BOOST_CHECK(legacyOnly.Load(corrupted));
+    BOOST_CHECK(corrupted.vchData.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
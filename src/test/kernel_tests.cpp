@@ -0,0 +1,62 @@
+// Copyright (c) 2014-2020 The Crown developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <pos/kernel.h>
+#include <test/util/setup_common.h>
+
+#include <limits>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(kernel_tests, BasicTestingSetup)
+
+// KernelSearch builds the serialization of Kernel::GetStakeHash by hand, both must give the same hash
+BOOST_AUTO_TEST_CASE(kernel_search_stake_hash)
+{
+    const uint256 nTarget = uint256S("00000000ffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+
+    for (int i = 0; i < 32; i++) {
+        COutPoint outpoint(InsecureRand256(), i < 2 ? (i == 0 ? 0 : 0xffffffff) : InsecureRand32());
+        uint256 nStakeModifier = InsecureRand256();
+        uint64_t nTimeBlockFrom = i == 0 ? 0 : InsecureRandBits(63);
+        uint64_t nAmount = 1 + InsecureRandBits(40);
+
+        KernelSearch search(outpoint, nAmount, nStakeModifier, nTimeBlockFrom, nTarget);
+        for (uint64_t nTimeStake : {uint64_t{0}, uint64_t{1}, uint64_t{1600000000}, std::numeric_limits<uint64_t>::max(), InsecureRandBits(64)}) {
+            Kernel kernel(outpoint, nAmount, nStakeModifier, nTimeBlockFrom, nTimeStake);
+            BOOST_CHECK(search.GetStakeHash(nTimeStake) == kernel.GetStakeHash());
+            BOOST_CHECK_EQUAL(search.IsValidProof(nTimeStake), kernel.IsValidProof(nTarget));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(kernel_search_first_valid_time)
+{
+    // one valid proof in about every sixteen stake times
+    const uint256 nTarget = uint256S("0fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+    const COutPoint outpoint(InsecureRand256(), 1);
+    const uint256 nStakeModifier = InsecureRand256();
+    const uint64_t nTimeBlockFrom = 1500000000;
+    const uint64_t nTimeStart = 1600000000;
+    const uint64_t nTimeEnd = nTimeStart + 1000;
+
+    uint64_t nTimeExpected = 0;
+    for (uint64_t nTime = nTimeStart; nTime <= nTimeEnd; nTime++) {
+        if (Kernel(outpoint, 1, nStakeModifier, nTimeBlockFrom, nTime).IsValidProof(nTarget)) {
+            nTimeExpected = nTime;
+            break;
+        }
+    }
+    BOOST_REQUIRE(nTimeExpected != 0);
+
+    Kernel kernel(outpoint, 1, nStakeModifier, nTimeBlockFrom, 0);
+    BOOST_CHECK(kernel.SearchValidProof(nTimeStart, nTimeEnd, nTarget));
+    BOOST_CHECK_EQUAL(kernel.GetTime(), nTimeExpected);
+
+    uint64_t nTimeFound;
+    KernelSearch search(outpoint, 1, nStakeModifier, nTimeBlockFrom, nTarget);
+    BOOST_CHECK(!search.Search(nTimeStart, nTimeExpected - 1, nTimeFound));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
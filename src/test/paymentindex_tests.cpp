@@ -0,0 +1,209 @@
+// Copyright (c) 2014-2020 The Crown developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <masternode/masternode.h>
+#include <masternode/masternode-payments.h>
+#include <pos/paymentindex.h>
+#include <script/standard.h>
+#include <systemnode/systemnode-payments.h>
+#include <test/util/setup_common.h>
+#include <validation.h>
+
+#include <deque>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+//! Blocks and their index entries on top of the genesis block, only the coinbase outputs matter
+struct PaymentChain {
+    std::vector<CPubKey> vPubKeys;
+    std::vector<CScript> vPayees;
+    std::deque<uint256> vHashes;
+    std::deque<CBlockIndex> vIndex;
+    std::map<const CBlockIndex*, CBlock> mapBlocks;
+
+    explicit PaymentChain(size_t nPayees)
+    {
+        for (size_t i = 0; i < nPayees; i++) {
+            CKey key;
+            key.MakeNewKey(true);
+            vPubKeys.push_back(key.GetPubKey());
+            vPayees.push_back(GetScriptForDestination(PKHash(vPubKeys.back())));
+        }
+    }
+
+    //! Add a block paying masternode and systemnode payees chosen from nSalt on top of pprev
+    const CBlockIndex* AddBlock(CBlockIndex* pprev, int nSalt)
+    {
+        const int nHeight = pprev->nHeight + 1;
+        CMutableTransaction coinbase;
+        coinbase.vin.resize(1);
+        coinbase.vin[0].prevout.SetNull();
+        coinbase.vin[0].scriptSig = CScript() << nHeight << nSalt;
+        coinbase.vout.emplace_back(1, CScript() << OP_TRUE);
+        // some blocks pay no node at all
+        if ((nHeight + nSalt) % 11 != 0) {
+            coinbase.vout.emplace_back(1, vPayees[(nHeight * 7 + nSalt) % vPayees.size()]);
+            coinbase.vout.emplace_back(1, vPayees[(nHeight * 3 + nSalt) % vPayees.size()]);
+        }
+        CBlock block;
+        block.vtx.push_back(MakeTransactionRef(coinbase));
+
+        vHashes.push_back(InsecureRand256());
+        vIndex.emplace_back();
+        CBlockIndex* pindex = &vIndex.back();
+        pindex->phashBlock = &vHashes.back();
+        pindex->pprev = pprev;
+        pindex->nHeight = nHeight;
+        pindex->BuildSkip();
+        mapBlocks[pindex] = block;
+        return pindex;
+    }
+
+    const CBlock& GetBlock(const CBlockIndex* pindex) const { return mapBlocks.at(pindex); }
+};
+
+//! The payments to payee in slot nPos found by reading every block of the window, as GetRecentPayments did before the index
+std::vector<int> WalkChain(const PaymentChain& payments, const CChain& chain, const CScript& payee, unsigned int nPos, int nMinHeight, bool limitMostRecent)
+{
+    std::vector<int> vHeights;
+    for (int nHeight = nMinHeight; nHeight < chain.Height(); nHeight++) {
+        const CTransactionRef& tx = payments.GetBlock(chain[nHeight]).vtx[0];
+        if (tx->vout.size() > nPos && tx->vout[nPos].scriptPubKey == payee) {
+            vHeights.push_back(nHeight);
+            if (limitMostRecent)
+                break;
+        }
+    }
+    return vHeights;
+}
+
+std::vector<int> Heights(const std::vector<NodePayment>& vPayments)
+{
+    std::vector<int> vHeights;
+    for (const auto& payment : vPayments)
+        vHeights.push_back(payment.nHeight);
+    return vHeights;
+}
+
+int GetPaymentIndexDepth()
+{
+    return Params().ValidStakePointerDuration() + Params().MaxReorganizationDepth();
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(paymentindex_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(paymentindex_connect_prune)
+{
+    LOCK(cs_main);
+    CBlockIndex* pindexGenesis = ::ChainActive().Genesis();
+    PaymentChain payments(5);
+    NodePaymentIndex index;
+
+    const int nBlocks = GetPaymentIndexDepth() + 300;
+    CBlockIndex* pindex = pindexGenesis;
+    for (int i = 0; i < nBlocks; i++) {
+        pindex = const_cast<CBlockIndex*>(payments.AddBlock(pindex, 0));
+        index.BlockConnected(payments.GetBlock(pindex), pindex);
+    }
+
+    // everything below the stake pointer window and the reorg depth is pruned
+    const int nMinHeight = nBlocks - GetPaymentIndexDepth();
+    size_t nExpected = 0;
+    for (int nHeight = nMinHeight; nHeight <= nBlocks; nHeight++)
+        nExpected += (nHeight % 11 != 0) ? 2 : 0;
+    BOOST_CHECK_EQUAL(index.size(), nExpected);
+
+    std::vector<NodePayment> vPayments;
+    for (const CScript& payee : payments.vPayees) {
+        for (unsigned int nPos : {MN_PMT_SLOT, SN_PMT_SLOT}) {
+            BOOST_CHECK(!index.GetPayments(payee, nPos, 0, nMinHeight - 1, vPayments));
+            BOOST_REQUIRE(index.GetPayments(payee, nPos, 0, nBlocks, vPayments));
+            BOOST_CHECK_GE(vPayments.front().nHeight, nMinHeight);
+            for (const auto& payment : vPayments) {
+                BOOST_CHECK_EQUAL(payment.nPos, nPos);
+                BOOST_CHECK(payments.GetBlock(pindex->GetAncestor(payment.nHeight)).vtx[0]->vout[nPos].scriptPubKey == payee);
+            }
+        }
+    }
+
+    // disconnecting removes the payments of that block only
+    const CBlockIndex* pindexTip = pindex;
+    index.BlockDisconnected(payments.GetBlock(pindexTip), pindexTip);
+    BOOST_CHECK_EQUAL(index.size(), nExpected - (nBlocks % 11 != 0 ? 2 : 0));
+    for (const CScript& payee : payments.vPayees) {
+        index.GetPayments(payee, MN_PMT_SLOT, 0, nBlocks, vPayments);
+        for (const auto& payment : vPayments)
+            BOOST_CHECK(payment.nHeight < nBlocks);
+    }
+
+    index.Clear();
+    BOOST_CHECK_EQUAL(index.size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(paymentindex_recent_payments)
+{
+    LOCK(cs_main);
+    CChain& chain = ::ChainActive();
+    CBlockIndex* pindexGenesis = chain.Genesis();
+    PaymentChain payments(4);
+    g_paymentIndex.Clear();
+
+    // a chain longer than the stake pointer window, so the window start is checked too
+    const int nBlocks = Params().ValidStakePointerDuration() + 50;
+    CBlockIndex* pindex = pindexGenesis;
+    for (int i = 0; i < nBlocks; i++) {
+        pindex = const_cast<CBlockIndex*>(payments.AddBlock(pindex, 0));
+        g_paymentIndex.BlockConnected(payments.GetBlock(pindex), pindex);
+    }
+    chain.SetTip(pindex);
+
+    // the masternode paid by each payee must see exactly what a walk over its window finds
+    auto check = [&]() {
+        const int nMinHeight = CMasternode::GetPaymentWindowStart(chain.Height());
+        for (const CPubKey& pubkey : payments.vPubKeys) {
+            CMasternode mn;
+            mn.pubkey = pubkey;
+            const CScript payee = GetScriptForDestination(PKHash(pubkey));
+            for (bool limitMostRecent : {false, true}) {
+                std::vector<NodePayment> vPayments;
+                const std::vector<int> vExpected = WalkChain(payments, chain, payee, MN_PMT_SLOT, nMinHeight, limitMostRecent);
+                BOOST_CHECK_EQUAL(mn.GetRecentPayments(vPayments, limitMostRecent), !vExpected.empty());
+                BOOST_CHECK(Heights(vPayments) == vExpected);
+                for (const auto& payment : vPayments)
+                    BOOST_CHECK(payment.hashBlock == chain[payment.nHeight]->GetBlockHash());
+            }
+        }
+    };
+    check();
+
+    // reorg the last blocks to a branch paying other nodes
+    const int nReorg = 20;
+    CBlockIndex* pindexFork = pindex->GetAncestor(nBlocks - nReorg);
+    for (const CBlockIndex* pindexDisconnect = pindex; pindexDisconnect != pindexFork; pindexDisconnect = pindexDisconnect->pprev)
+        g_paymentIndex.BlockDisconnected(payments.GetBlock(pindexDisconnect), pindexDisconnect);
+    pindex = pindexFork;
+    for (int i = 0; i < nReorg + 2; i++) {
+        pindex = const_cast<CBlockIndex*>(payments.AddBlock(pindex, 1));
+        g_paymentIndex.BlockConnected(payments.GetBlock(pindex), pindex);
+    }
+    chain.SetTip(pindex);
+    check();
+
+    // a block replaced without being disconnected from the index is overwritten, a stale entry is never returned
+    CBlockIndex* pindexReplaced = const_cast<CBlockIndex*>(payments.AddBlock(pindex->pprev, 2));
+    g_paymentIndex.BlockConnected(payments.GetBlock(pindexReplaced), pindexReplaced);
+    chain.SetTip(pindexReplaced);
+    check();
+
+    chain.SetTip(pindexGenesis);
+    g_paymentIndex.Clear();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
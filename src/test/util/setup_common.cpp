@@ -16,6 +16,7 @@
 #include <net.h>
 #include <net_processing.h>
 #include <noui.h>
+#include <platform/platform-db.h>
 #include <pow.h>
 #include <rpc/blockchain.h>
 #include <rpc/register.h>
@@ -140,6 +141,7 @@ TestingSetup::TestingSetup(const std::string& chainName, const std::vector<const
     GetMainSignals().RegisterBackgroundSignalScheduler(*m_node.scheduler);
 
     pblocktree.reset(new CBlockTreeDB(1 << 20, true));
+    Platform::PlatformDb::CreateInstance(1 << 20, Platform::PlatformOpt::OptSpeed, true, true);
 
     m_node.mempool = MakeUnique<CTxMemPool>(&::feeEstimator);
     m_node.mempool->setSanityCheck(1.0);
@@ -193,6 +195,7 @@ TestingSetup::~TestingSetup()
     m_node.chainman->Reset();
     m_node.chainman = nullptr;
     pblocktree.reset();
+    Platform::PlatformDb::DestroyInstance();
 }
 
 TestChain100Setup::TestChain100Setup()
@@ -21,6 +21,9 @@
 
 static const char DB_COIN = 'C';
 static const char DB_COINS = 'c';
+static const char DB_ASSET_REF = 'T';
+static const char DB_ASSET_REFS = 'V';
+static const char DB_ASSET_REFS_UPGRADE = 'v';
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_ADDRESSINDEX = 'a';
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
@@ -30,6 +33,9 @@ static const char DB_SPENTINDEX = 'p';
 static const char DB_BALANCESINDEX = 'i';
 static const char DB_BLOCK_INDEX = 'b';
 
+//! Version of the interned coin format stored under DB_ASSET_REFS, a database written in a newer one is refused
+static const uint8_t ASSET_REFS_FORMAT = 1;
+
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_FLAG = 'F';
@@ -46,12 +52,116 @@ struct CoinEntry {
     SERIALIZE_METHODS(CoinEntry, obj) { READWRITE(obj.key, obj.outpoint->hash, VARINT(obj.outpoint->n)); }
 };
 
+struct AssetRefEntry {
+    uint32_t* index;
+    char key;
+    explicit AssetRefEntry(const uint32_t* ptr) : index(const_cast<uint32_t*>(ptr)), key(DB_ASSET_REF) {}
+
+    // big endian, so the table is read back in index order
+    SERIALIZE_METHODS(AssetRefEntry, obj) { READWRITE(obj.key, Using<BigEndianFormatter<4>>(*obj.index)); }
+};
+
+/**
+ * A Coin as stored with an interned asset: the same format as Coin with
+ * the asset replaced by VARINT(index in the asset table). A reference the
+ * table does not hold is reported through fUnknownRef instead of an
+ * exception, which CDBWrapper::Read would turn into a missing coin.
+ */
+struct CoinAssetRef {
+    Coin* coin;
+    uint32_t asset_ref;
+    const CAssetTable* table;
+    bool fUnknownRef{false};
+
+    CoinAssetRef(const Coin* ptr, uint32_t asset_ref_in) : coin(const_cast<Coin*>(ptr)), asset_ref(asset_ref_in), table(nullptr) {}
+    CoinAssetRef(Coin* ptr, const CAssetTable* table_in) : coin(ptr), asset_ref(0), table(table_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream &s) const {
+        assert(!coin->IsSpent());
+        uint32_t code = coin->nHeight * uint32_t{2} + coin->fCoinBase;
+        ::Serialize(s, VARINT(code));
+        ::Serialize(s, Using<AmountCompression>(coin->out.nValue));
+        ::Serialize(s, Using<ScriptCompression>(coin->out.scriptPubKey));
+        ::Serialize(s, VARINT(asset_ref));
+        unsigned int nFlag = coin->fCoinStake ? 1 : 0;
+        ::Serialize(s, VARINT(nFlag));
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream &s) {
+        uint32_t code = 0;
+        ::Unserialize(s, VARINT(code));
+        coin->nHeight = code >> 1;
+        coin->fCoinBase = code & 1;
+        ::Unserialize(s, Using<AmountCompression>(coin->out.nValue));
+        ::Unserialize(s, Using<ScriptCompression>(coin->out.scriptPubKey));
+        ::Unserialize(s, VARINT(asset_ref));
+        fUnknownRef = !table->Get(asset_ref, coin->out.nAsset);
+        unsigned int nFlag = 0;
+        ::Unserialize(s, VARINT(nFlag));
+        coin->fCoinStake = nFlag & 1;
+    }
+};
+
+/** Drops the assets interned since the last written batch from the table, unless that batch is written too */
+class AssetTableWriteGuard
+{
+    CAssetTable& table;
+    size_t nWritten;
+
+public:
+    explicit AssetTableWriteGuard(CAssetTable& table_in) : table(table_in), nWritten(table_in.Size()) {}
+    ~AssetTableWriteGuard() { table.Truncate(nWritten); }
+    void Written() { nWritten = table.Size(); }
+};
+
+[[noreturn]] void ThrowUnknownAssetRef(const COutPoint& outpoint, uint32_t asset_ref)
+{
+    throw dbwrapper_error(strprintf("Coin %s refers to unknown interned asset %u, the chainstate database is corrupted. "
+                                    "You will need to rebuild it using -reindex-chainstate.", outpoint.ToString(), asset_ref));
+}
+
 }
 
 CCoinsViewDB::CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe) :
     m_db(std::make_unique<CDBWrapper>(ldb_path, nCacheSize, fMemory, fWipe, true)),
     m_ldb_path(ldb_path),
-    m_is_memory(fMemory) { }
+    m_is_memory(fMemory)
+{
+    uint8_t nFormat = 0;
+    m_asset_refs = m_db->Read(DB_ASSET_REFS, nFormat);
+    if (m_asset_refs && nFormat > ASSET_REFS_FORMAT) {
+        throw dbwrapper_error(strprintf("The chainstate database uses coin format %u, this version only reads up to %u. "
+                                        "Use a newer version, or rebuild it using -reindex-chainstate.", nFormat, ASSET_REFS_FORMAT));
+    }
+    LoadAssetTable();
+}
+
+void CCoinsViewDB::LoadAssetTable()
+{
+    std::unique_ptr<CDBIterator> pcursor(m_db->NewIterator());
+    uint32_t index = 0;
+    AssetRefEntry entry(&index);
+    for (pcursor->Seek(DB_ASSET_REF); pcursor->Valid(); pcursor->Next()) {
+        if (!pcursor->GetKey(entry) || entry.key != DB_ASSET_REF)
+            break;
+        CAsset asset;
+        if (!pcursor->GetValue(asset) || !m_asset_table.Load(index, asset)) {
+            throw dbwrapper_error(strprintf("Cannot load interned asset %u, the chainstate database is corrupted. "
+                                            "You will need to rebuild it using -reindex-chainstate.", index));
+        }
+    }
+}
+
+void CCoinsViewDB::WriteCoinWithAssetRef(CDBBatch& batch, const COutPoint& outpoint, const Coin& coin)
+{
+    bool fNew = false;
+    uint32_t asset_ref = m_asset_table.Intern(coin.out.nAsset, fNew);
+    if (fNew)
+        batch.Write(AssetRefEntry(&asset_ref), coin.out.nAsset);
+    batch.Write(CoinEntry(&outpoint), CoinAssetRef(&coin, asset_ref));
+}
 
 void CCoinsViewDB::ResizeCache(size_t new_cache_size)
 {
@@ -63,7 +173,14 @@ void CCoinsViewDB::ResizeCache(size_t new_cache_size)
 }
 
 bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
-    return m_db->Read(CoinEntry(&outpoint), coin);
+    if (!m_asset_refs)
+        return m_db->Read(CoinEntry(&outpoint), coin);
+    CoinAssetRef value(&coin, &m_asset_table);
+    if (!m_db->Read(CoinEntry(&outpoint), value))
+        return false;
+    if (value.fUnknownRef)
+        ThrowUnknownAssetRef(outpoint, value.asset_ref);
+    return true;
 }
 
 bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
@@ -109,12 +226,15 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     // interrupting after partial writes from multiple independent reorgs.
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, Vector(hashBlock, old_tip));
+    AssetTableWriteGuard assetTableGuard(m_asset_table);
 
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             CoinEntry entry(&it->first);
             if (it->second.coin.IsSpent())
                 batch.Erase(entry);
+            else if (m_asset_refs)
+                WriteCoinWithAssetRef(batch, it->first, it->second.coin);
             else
                 batch.Write(entry, it->second.coin);
             changed++;
@@ -125,6 +245,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             m_db->WriteBatch(batch);
+            assetTableGuard.Written();
             batch.Clear();
             if (crash_simulate) {
                 static FastRandomContext rng;
@@ -142,6 +263,8 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
 
     LogPrint(BCLog::COINDB, "Writing final batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
     bool ret = m_db->WriteBatch(batch);
+    if (ret)
+        assetTableGuard.Written();
     LogPrint(BCLog::COINDB, "Committed %u changed transaction outputs (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
     return ret;
 }
@@ -175,7 +298,7 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
 
 CCoinsViewCursor *CCoinsViewDB::Cursor() const
 {
-    CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper&>(*m_db).NewIterator(), GetBestBlock());
+    CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper&>(*m_db).NewIterator(), GetBestBlock(), m_asset_refs ? &m_asset_table : nullptr);
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
@@ -203,7 +326,14 @@ bool CCoinsViewDBCursor::GetKey(COutPoint &key) const
 
 bool CCoinsViewDBCursor::GetValue(Coin &coin) const
 {
-    return pcursor->GetValue(coin);
+    if (!pAssetTable)
+        return pcursor->GetValue(coin);
+    CoinAssetRef value(&coin, pAssetTable);
+    if (!pcursor->GetValue(value))
+        return false;
+    if (value.fUnknownRef)
+        ThrowUnknownAssetRef(keyTmp.second, value.asset_ref);
+    return true;
 }
 
 unsigned int CCoinsViewDBCursor::GetValueSize() const
@@ -529,13 +659,14 @@ public:
 
 /** Upgrade the database from older formats.
  *
- * Currently implemented: from the per-tx utxo model (0.8..0.14.x) to per-txout.
+ * Currently implemented: from the per-tx utxo model (0.8..0.14.x) to per-txout,
+ * then from coins with their full asset to interned asset references.
  */
 bool CCoinsViewDB::Upgrade() {
     std::unique_ptr<CDBIterator> pcursor(m_db->NewIterator());
     pcursor->Seek(std::make_pair(DB_COINS, uint256()));
     if (!pcursor->Valid()) {
-        return true;
+        return UpgradeAssetRefs();
     }
 
     int64_t count = 0;
@@ -591,5 +722,76 @@ bool CCoinsViewDB::Upgrade() {
     m_db->CompactRange({DB_COINS, uint256()}, key);
     uiInterface.ShowProgress("", 100, false);
     LogPrintf("[%s].\n", ShutdownRequested() ? "CANCELLED" : "DONE");
-    return !ShutdownRequested();
+    return !ShutdownRequested() && UpgradeAssetRefs();
+}
+
+/** Rewrite every coin with a reference into the asset table. The last rewritten
+ *  outpoint is stored with each batch, an interrupted upgrade resumes from there. */
+bool CCoinsViewDB::UpgradeAssetRefs() {
+    if (m_asset_refs) {
+        return true;
+    }
+
+    std::unique_ptr<CDBIterator> pcursor(m_db->NewIterator());
+    COutPoint outpoint;
+    CoinEntry entry(&outpoint);
+    if (m_db->Read(DB_ASSET_REFS_UPGRADE, outpoint)) {
+        // the stored outpoint is rewritten already
+        pcursor->Seek(entry);
+        if (pcursor->Valid()) {
+            pcursor->Next();
+        }
+    } else {
+        pcursor->Seek(DB_COIN);
+    }
+
+    if (!pcursor->Valid() || !pcursor->GetKey(entry) || entry.key != DB_COIN) {
+        // nothing left to rewrite, as with a new database
+        CDBBatch batch(*m_db);
+        batch.Erase(DB_ASSET_REFS_UPGRADE);
+        batch.Write(DB_ASSET_REFS, ASSET_REFS_FORMAT);
+        m_db->WriteBatch(batch);
+        m_asset_refs = true;
+        return true;
+    }
+
+    int64_t count = 0;
+    LogPrintf("Upgrading utxo-set database to interned assets...\n");
+    uiInterface.ShowProgress(_("Upgrading UTXO database").translated, 0, true);
+    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    CDBBatch batch(*m_db);
+    AssetTableWriteGuard assetTableGuard(m_asset_table);
+    for (; pcursor->Valid(); pcursor->Next()) {
+        if (!pcursor->GetKey(entry) || entry.key != DB_COIN) {
+            break;
+        }
+        Coin coin;
+        if (!pcursor->GetValue(coin)) {
+            return error("%s: cannot parse coin record", __func__);
+        }
+        WriteCoinWithAssetRef(batch, outpoint, coin);
+        if (++count % 4096 == 0) {
+            uint32_t high = 0x100 * *outpoint.hash.begin() + *(outpoint.hash.begin() + 1);
+            uiInterface.ShowProgress(_("Upgrading UTXO database").translated, (int)(high * 100.0 / 65536.0 + 0.5), true);
+        }
+        if (batch.SizeEstimate() > batch_size) {
+            batch.Write(DB_ASSET_REFS_UPGRADE, outpoint);
+            m_db->WriteBatch(batch);
+            assetTableGuard.Written();
+            batch.Clear();
+            if (ShutdownRequested()) {
+                uiInterface.ShowProgress("", 100, false);
+                LogPrintf("Upgrade to interned assets CANCELLED after %d coins.\n", count);
+                return false;
+            }
+        }
+    }
+    batch.Erase(DB_ASSET_REFS_UPGRADE);
+    batch.Write(DB_ASSET_REFS, ASSET_REFS_FORMAT);
+    m_db->WriteBatch(batch);
+    assetTableGuard.Written();
+    m_asset_refs = true;
+    uiInterface.ShowProgress("", 100, false);
+    LogPrintf("Upgraded %d coins to %u interned assets.\n", count, m_asset_table.Size());
+    return true;
 }
@@ -6,6 +6,7 @@
 #ifndef CROWN_TXDB_H
 #define CROWN_TXDB_H
 
+#include <assettable.h>
 #include <coins.h>
 #include <dbwrapper.h>
 #include <chain.h>
@@ -40,6 +41,8 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxTxIndexCache = 1024;
 //! Max memory allocated to all block filter index caches combined in MiB.
 static const int64_t max_filter_index_cache = 1024;
+//! Max memory allocated to the budget collateral index cache in MiB.
+static const int64_t max_budget_collateral_index_cache = 8;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
 
@@ -53,6 +56,16 @@ protected:
     std::unique_ptr<CDBWrapper> m_db;
     fs::path m_ldb_path;
     bool m_is_memory;
+    //! Whether the coins are stored with references into m_asset_table instead of their full asset.
+    //! This only shrinks the chainstate on disk: the coins cache, nMoneySupply and the undo data still
+    //! hold full assets. Builds without this format cannot read such a database.
+    bool m_asset_refs{false};
+    CAssetTable m_asset_table;
+
+    void LoadAssetTable();
+    void WriteCoinWithAssetRef(CDBBatch& batch, const COutPoint& outpoint, const Coin& coin);
+    //! Rewrite the coins of an older database with interned asset references
+    bool UpgradeAssetRefs();
 public:
     /**
      * @param[in] ldb_path    Location in the filesystem where leveldb data will be stored.
@@ -88,10 +101,12 @@ public:
     void Next() override;
 
 private:
-    CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256 &hashBlockIn):
-        CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn) {}
+    CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256 &hashBlockIn, const CAssetTable* pAssetTableIn):
+        CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn), pAssetTable(pAssetTableIn) {}
     std::unique_ptr<CDBIterator> pcursor;
     std::pair<char, COutPoint> keyTmp;
+    //! Table resolving the asset references of the coins, null if they are stored with their full asset
+    const CAssetTable* pAssetTable;
 
     friend class CCoinsViewDB;
 };
@@ -68,6 +68,7 @@
 #include <boost/algorithm/string/replace.hpp>
 
 #include <pos/blockwitness.h>
+#include <pos/paymentindex.h>
 #include <pos/prooftracker.h>
 #include <pos/stakevalidation.h>
 #include <pos/stakepointer.h>
@@ -2021,6 +2022,9 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
         mapUsedStakePointers.erase(stakeSource.GetHash());
     }
 
+    // Undo node payments
+    g_paymentIndex.BlockDisconnected(block, pindex);
+
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
@@ -2362,13 +2366,8 @@ static CAmount CheckMoneySupply(CBlockIndex *pindex){
     for(auto &a : pindex->nMoneySupply){
         if(a.first == Params().GetConsensus().subsidy_asset)
             actualSupply += a.second;
-        else{
-            for(auto const& x : passetsCache->GetItemsMap()){
-                CAsset checkasset = x.second->second.asset;
-                if(a.first == checkasset)
-                    actualSupply += x.second->second.inputAmount;
-            }
-        }
+        else
+            actualSupply += passetsCache->GetInputAmount(a.first);
     }
 
     return actualSupply;
@@ -2755,6 +2754,8 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
 
     int64_t nTime8_1 = GetTimeMicros();
     if (!ProcessNftTxsInBlock(block, pindex, txState)) {
+        if (txState.IsError())
+            return AbortNode(state, txState.GetRejectReason());
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, strprintf("ProcessNftTxsInBlock for block %s failed with %s", pindex->GetBlockHash().ToString(), txState.ToString()));
     }
     int64_t nTime8_2 = GetTimeMicros(); nTimeProcessNftValid += nTime8_2 - nTime8_1;
@@ -2785,13 +2786,8 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
             if(block.vtx[i]->nVersion >= TX_ELE_VERSION ){
                 for(unsigned int j = 0; j < block.vtx[i]->vpout.size(); j++){
                     CAsset out = block.vtx[i]->vpout[j].nAsset;
-                    bool exists = false;
                     //LogPrintf("%s: FOUND ASSET %s \n", __func__, out.ToString());
-                    for(auto const& x : passetsCache->GetItemsMap()){
-                        CAsset checkasset = x.second->second.asset;
-                        if(iequals(out.getAssetName(), checkasset.getAssetName()) || iequals(out.getAssetName(), checkasset.getShortName()))
-                            exists = true;
-                    }
+                    bool exists = passetsCache->FindByNameOrShortName(out.getAssetName()) != nullptr;
 
                     if (!exists && !passetsCache->Exists(out.getAssetName())){
                         if(!fJustCheck){
@@ -2852,6 +2848,8 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
         mapUsedStakePointers.emplace(stakeSource.GetHash(), block.GetHash());
     }
 
+    g_paymentIndex.BlockConnected(block, pindex);
+
     if (g_txindex) {
 
         if (!pblocktree->WriteAddressIndex(addressIndex)) {
@@ -3173,11 +3171,13 @@ bool CChainState::DisconnectTip(BlockValidationState& state, const CChainParams&
     int64_t nStart = GetTimeMicros();
     {
         CCoinsViewCache view(&CoinsTip());
+        CNftBlockBatch nftBlockBatch;
         assert(view.GetBestBlock() == pindexDelete->GetBlockHash());
         if (DisconnectBlock(block, pindexDelete, view) != DISCONNECT_OK)
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
         bool flushed = view.Flush();
         assert(flushed);
+        nftBlockBatch.Commit();
     }
     LogPrint(BCLog::BENCH, "- Disconnect block: %.2fms\n", (GetTimeMicros() - nStart) * MILLI);
     // Write the chain state to disk, if necessary.
@@ -3282,6 +3282,7 @@ bool CChainState::ConnectTip(BlockValidationState& state, const CChainParams& ch
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
     {
         CCoinsViewCache view(&CoinsTip());
+        CNftBlockBatch nftBlockBatch;
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
@@ -3294,6 +3295,7 @@ bool CChainState::ConnectTip(BlockValidationState& state, const CChainParams& ch
         LogPrint(BCLog::BENCH, "  - Connect total: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime3 - nTime2) * MILLI, nTimeConnectTotal * MICRO, nTimeConnectTotal * MILLI / nBlocksTotal);
         bool flushed = view.Flush();
         assert(flushed);
+        nftBlockBatch.Commit();
     }
     int64_t nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
     LogPrint(BCLog::BENCH, "  - Flush: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime4 - nTime3) * MILLI, nTimeFlush * MICRO, nTimeFlush * MILLI / nBlocksTotal);
@@ -4597,6 +4599,8 @@ bool TestBlockValidity(BlockValidationState& state, const CChainParams& chainpar
     AssertLockHeld(cs_main);
     assert(pindexPrev && pindexPrev == ::ChainActive().Tip());
     CCoinsViewCache viewNew(&::ChainstateActive().CoinsTip());
+    // the NFT changes of the checked block are rolled back with the batch
+    CNftBlockBatch nftBlockBatch;
     uint256 block_hash(block.GetHash());
     CBlockIndex indexDummy(block, block.IsProofOfStake());
     indexDummy.pprev = pindexPrev;
@@ -5012,6 +5016,8 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
     nCheckLevel = std::max(0, std::min(4, nCheckLevel));
     LogPrintf("Verifying last %i blocks at level %i\n", nCheckDepth, nCheckLevel);
     CCoinsViewCache coins(coinsview);
+    // the NFT changes of the disconnected and reconnected blocks are rolled back with the batch, like the coins view
+    CNftBlockBatch nftBlockBatch;
     CBlockIndex* pindex;
     CBlockIndex* pindexFailure = nullptr;
     int nGoodTransactions = 0;
@@ -5157,6 +5163,8 @@ bool CChainState::ReplayBlocks(const CChainParams& params)
         assert(pindexFork != nullptr);
     }
 
+    CNftBlockBatch nftBlockBatch;
+
     // Rollback along the old branch.
     while (pindexOld != pindexFork) {
         if (pindexOld->nHeight > 0) { // Never disconnect the genesis block.
@@ -5188,6 +5196,7 @@ bool CChainState::ReplayBlocks(const CChainParams& params)
 
     cache.SetBestBlock(pindexNew->GetBlockHash());
     cache.Flush();
+    nftBlockBatch.Commit();
     uiInterface.ShowProgress("", 100, false);
     return true;
 }
@@ -997,6 +997,7 @@ int32_t ComputeBlockVersion(const CBlockIndex* pindexPrev, const Consensus::Para
 /**
  * Return true if hash can be found in chainActive at nBlockHeight height.
  * Fills hashRet with found hash, if no nBlockHeight is specified - chainActive.Height() is used.
+ * Takes cs_main and indexes the active chain directly, so the result always follows the current tip.
  */
 bool GetBlockHash(uint256& hashRet, int nBlockHeight = -1);
 
@@ -223,7 +223,7 @@ bool KnapsackSolver(const CAmountMap& mapTargetValue, std::vector<OutputGroup>&
     std::vector<OutputGroup> inner_groups;
     std::set<CInputCoin> inner_coinsret;
     // Perform the standard Knapsack solver for every asset individually.
-    for(std::map<CAsset, CAmount>::const_iterator it = mapTargetValue.begin(); it != mapTargetValue.end(); ++it) {
+    for(CAmountMap::const_iterator it = mapTargetValue.begin(); it != mapTargetValue.end(); ++it) {
         inner_groups.clear();
         inner_coinsret.clear();
 